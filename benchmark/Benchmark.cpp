@@ -0,0 +1,510 @@
+// Headless benchmarks for the wrapper's hot paths. Needs no window or GPU: it runs against a null
+// backend that drops every draw call, which times the wrapper and nanovg alone, or with --sw
+// against the CPU rasterizer, which includes rasterization in endFrame(). Results are written to
+// stdout as JSON so runs of different builds can be compared.
+//
+//   Benchmark [--sw] [--frames N] [--assets DIR]
+//
+// DIR is the directory holding rainbow_dash.svg and Roboto-Regular.ttf, samples/HelloSvg/assets
+// by default. benchmark/CMakeLists.txt builds it as a console program from this file, the
+// library's sources (minus ci_nanovg_gl.cpp), nanovg.c and Cinder.
+
+#include "cinder/BSpline.h"
+#include "cinder/DataSource.h"
+#include "cinder/Path2d.h"
+#include "cinder/PolyLine.h"
+#include "cinder/Rand.h"
+#include "cinder/Shape2d.h"
+#include "cinder/svg/Svg.h"
+
+#include "ci_nanovg.hpp"
+#include "ci_nanovg_null.hpp"
+#include "ci_nanovg_sw.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ci;
+using namespace std;
+
+// Allocation Counting //
+
+// Counts operator new calls. nanovg allocates with malloc, so this covers the wrapper and Cinder.
+static atomic<size_t> sNumAllocations(0);
+
+void *operator new(size_t size) {
+  sNumAllocations++;
+  if (void *p = malloc(size ? size : 1)) return p;
+  throw bad_alloc();
+}
+void operator delete(void *p) throw() {
+  free(p);
+}
+
+namespace {
+
+const int kWidth = 1280, kHeight = 720;
+const float kPi = 3.14159265358979323846264338327f;
+
+// Scene Generation //
+
+// Closed BSpline shapes, generated like the RenderToTexture sample's.
+Path2d bsplinePath(Rand &rnd, float radius, int numPoints) {
+  vector<vec2> points(numPoints);
+  for (int i = 0; i < numPoints; ++i) {
+    float angle = kPi * 2.0f * i / numPoints;
+    float r = rnd.nextFloat(radius * 0.5f, radius);
+    points[i] = vec2(cos(angle), sin(angle)) * r;
+  }
+  return Path2d(BSpline2f(points, 3, true, false));
+}
+
+vector<Path2d> bsplinePaths(size_t count) {
+  Rand rnd(1);
+  vector<Path2d> paths;
+  for (size_t i = 0; i < count; ++i) {
+    paths.push_back(bsplinePath(rnd, rnd.nextFloat(100.0f, 300.0f), rnd.nextInt(4, 12)));
+  }
+  return paths;
+}
+
+// A random walk across the window.
+PolyLine2f randomPolyLine(size_t count) {
+  Rand rnd(2);
+  PolyLine2f line;
+  vec2 p(kWidth * 0.5f, kHeight * 0.5f);
+  for (size_t i = 0; i < count; ++i) {
+    p += vec2(rnd.nextFloat(-4.0f, 4.0f), rnd.nextFloat(-4.0f, 4.0f));
+    p = glm::clamp(p, vec2(0), vec2(kWidth, kHeight));
+    line.push_back(p);
+  }
+  return line;
+}
+
+// An SVG of filled and stroked cubic blobs in nested groups, written to a temporary file.
+svg::DocRef syntheticSvg(size_t numPaths) {
+  Rand rnd(3);
+  ostringstream svg;
+  svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << kWidth << "\" height=\""
+      << kHeight << "\">\n";
+  for (size_t i = 0; i < numPaths; ++i) {
+    if (i % 10 == 0) {
+      if (i > 0) svg << "</g>\n";
+      svg << "<g transform=\"translate(" << rnd.nextFloat(-20.0f, 20.0f) << ","
+          << rnd.nextFloat(-20.0f, 20.0f) << ")\" opacity=\"0.9\">\n";
+    }
+    vec2 c(rnd.nextFloat(0.0f, float(kWidth)), rnd.nextFloat(0.0f, float(kHeight)));
+    float r = rnd.nextFloat(10.0f, 60.0f);
+    svg << "<path fill=\"#" << hex << (rnd.nextUint() & 0xffffff) << dec
+        << "\" stroke=\"#000\" stroke-width=\"1.5\" d=\"M" << c.x + r << "," << c.y;
+    for (int j = 1; j <= 4; ++j) {
+      float a0 = kPi * 0.5f * (j - 1), a1 = kPi * 0.5f * j;
+      float r1 = r * rnd.nextFloat(0.7f, 1.3f);
+      svg << " C" << c.x + cos(a0 + 0.5f) * r1 << "," << c.y + sin(a0 + 0.5f) * r1 << " "
+          << c.x + cos(a1 - 0.5f) * r1 << "," << c.y + sin(a1 - 0.5f) * r1 << " "
+          << c.x + cos(a1) * r << "," << c.y + sin(a1) * r;
+    }
+    svg << " Z\"/>\n";
+  }
+  svg << "</g>\n</svg>\n";
+
+  fs::path path = fs::temp_directory_path() / ("nanovg_benchmark_" + to_string(numPaths) + ".svg");
+  ofstream(path.string()) << svg.str();
+  return svg::Doc::create(loadFile(path));
+}
+
+const char *kParagraph =
+    "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs. "
+    "How vexingly quick daft zebras jump! Sphinx of black quartz, judge my vow. The five "
+    "boxing wizards jump quickly.";
+
+// Harness //
+
+struct Result {
+  string name;
+  size_t opsPerFrame;
+  double nsPerOp, allocationsPerFrame, verticesPerSecond;
+  // Fill, stroke and triangle calls that reached the backend, and how many of them were merged
+  // by batching.
+  double backendCallsPerFrame, batchesPerFrame;
+};
+
+class Benchmark {
+  nvg::Context &mCtx;
+  int mNumFrames;
+  vector<Result> mResults;
+
+  void frame(const function<void(nvg::Context &)> &draw) {
+    mCtx.beginFrame(kWidth, kHeight, 1.0f);
+    draw(mCtx);
+    mCtx.endFrame();
+  }
+
+public:
+  Benchmark(nvg::Context &ctx, int numFrames) : mCtx(ctx), mNumFrames{ numFrames } {}
+
+  // Times whole frames of draw, and reports per op where draw does opsPerFrame operations.
+  void run(const string &name, size_t opsPerFrame, const function<void(nvg::Context &)> &draw) {
+    for (int i = 0; i < 3; ++i) frame(draw);
+
+    double seconds = 0.0;
+    size_t allocations = 0, vertices = 0, calls = 0, batches = 0;
+    for (int i = 0; i < mNumFrames; ++i) {
+      sNumAllocations = 0;
+      auto start = chrono::high_resolution_clock::now();
+      frame(draw);
+      seconds += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+      allocations += sNumAllocations;
+      const auto &stats = mCtx.getFrameStats();
+      vertices += stats.numVertices;
+      calls += stats.numFills + stats.numStrokes + stats.numTriangles;
+      batches += stats.numBatches;
+    }
+
+    Result result;
+    result.name = name;
+    result.opsPerFrame = opsPerFrame;
+    result.nsPerOp = seconds * 1e9 / (double(mNumFrames) * opsPerFrame);
+    result.allocationsPerFrame = double(allocations) / mNumFrames;
+    result.verticesPerSecond = seconds > 0.0 ? vertices / seconds : 0.0;
+    result.backendCallsPerFrame = double(calls) / mNumFrames;
+    result.batchesPerFrame = double(batches) / mNumFrames;
+    mResults.push_back(result);
+
+    fprintf(stderr, "%-32s %12.1f ns/op\n", name.c_str(), result.nsPerOp);
+  }
+
+  void writeJson(const string &backendName) const {
+    printf("{\n  \"backend\": \"%s\",\n  \"frames\": %d,\n  \"results\": [\n",
+           backendName.c_str(), mNumFrames);
+    for (size_t i = 0; i < mResults.size(); ++i) {
+      const auto &r = mResults[i];
+      printf("    { \"name\": \"%s\", \"opsPerFrame\": %zu, \"nsPerOp\": %.3f, "
+             "\"allocationsPerFrame\": %.2f, \"verticesPerSecond\": %.0f, "
+             "\"backendCallsPerFrame\": %.1f, \"batchesPerFrame\": %.1f }%s\n",
+             r.name.c_str(), r.opsPerFrame, r.nsPerOp, r.allocationsPerFrame,
+             r.verticesPerSecond, r.backendCallsPerFrame, r.batchesPerFrame,
+             i + 1 < mResults.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+  }
+};
+
+// Benchmarks //
+
+void pathBenchmarks(Benchmark &bench) {
+  auto paths = bsplinePaths(32);
+
+  bench.run("path2d/bspline", paths.size(), [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(1.0f, 0.5f, 0.2f, 1.0f));
+    for (auto &path : paths) {
+      vg.beginPath();
+      vg.path2d(path);
+      vg.fill();
+    }
+  });
+
+  Shape2d shape;
+  for (auto &path : paths) shape.appendContour(path);
+  bench.run("shape2d/bspline", paths.size(), [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(1.0f, 0.5f, 0.2f, 1.0f));
+    vg.beginPath();
+    vg.shape2d(shape);
+    vg.fill();
+  });
+
+  vector<nvg::PathRef> refs;
+  for (auto &path : paths) refs.emplace_back(path);
+  bench.run("pathRef/bspline", refs.size(), [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(1.0f, 0.5f, 0.2f, 1.0f));
+    for (auto &ref : refs) {
+      vg.beginPath();
+      vg.appendPath(ref);
+      vg.fill();
+    }
+  });
+
+  bench.run("pathRef/bspline/cached", refs.size(), [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(1.0f, 0.5f, 0.2f, 1.0f));
+    for (auto &ref : refs) {
+      vg.beginPath();
+      vg.appendPath(ref);
+      vg.cachePath(ref.getId());
+      vg.fill();
+    }
+  });
+
+  // HelloWorld's hue wheel, with and without batching.
+  auto hueWheel = [](nvg::Context &vg) {
+    vg.save();
+    vg.translate(kWidth * 0.5f, kHeight * 0.5f);
+    for (int n = 64, i = 0; i < n; ++i) {
+      float u1 = float(i) / n, u2 = float(i + 1) / n;
+      float t1 = u1 * kPi * 2.0f, t2 = u2 * kPi * 2.0f;
+      vg.beginPath();
+      vg.moveTo(0.0f, 0.0f);
+      vg.lineTo(cos(t1) * 200.0f, sin(t1) * 200.0f);
+      vg.lineTo(cos(t2) * 200.0f, sin(t2) * 200.0f);
+      vg.closePath();
+      vg.fillColor(ColorAf(CM_HSV, u1, 1.0f, 1.0f));
+      vg.fill();
+    }
+    vg.restore();
+  };
+  bench.run("hueWheel", 64, hueWheel);
+  bench.run("hueWheel/batched", 64, [&](nvg::Context &vg) {
+    vg.setBatching(true);
+    hueWheel(vg);
+    vg.setBatching(false);
+  });
+
+  // Map markers: one path at many positions and colors.
+  const size_t numMarkers = 5000;
+  Rand rnd(7);
+  vector<mat3> transforms;
+  vector<ColorAf> colors;
+  for (size_t i = 0; i < numMarkers; ++i) {
+    mat3 m(1);
+    m[2][0] = rnd.nextFloat(0.0f, float(kWidth));
+    m[2][1] = rnd.nextFloat(0.0f, float(kHeight));
+    m[0][0] = m[1][1] = 0.05f;
+    transforms.push_back(m);
+    colors.emplace_back(rnd.nextFloat(), rnd.nextFloat(), rnd.nextFloat(), 1.0f);
+  }
+  bench.run("pathRef/markers", numMarkers, [&](nvg::Context &vg) {
+    for (size_t i = 0; i < numMarkers; ++i) {
+      vg.save();
+      vg.transform(transforms[i]);
+      vg.beginPath();
+      vg.appendPath(refs[0]);
+      vg.fillColor(colors[i]);
+      vg.fill();
+      vg.restore();
+    }
+  });
+  bench.run("pathRef/markers/instanced", numMarkers, [&](nvg::Context &vg) {
+    vg.drawInstances(refs[0], transforms, colors);
+  });
+
+  // Scatter plot dots, one path each and in bulk.
+  const size_t numDots = 100000;
+  vector<vec2> dots;
+  for (size_t i = 0; i < numDots; ++i) {
+    dots.emplace_back(rnd.nextFloat(0.0f, float(kWidth)), rnd.nextFloat(0.0f, float(kHeight)));
+  }
+  bench.run("scatter/circle", numDots, [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(0.2f, 0.5f, 1.0f, 1.0f));
+    for (auto &dot : dots) {
+      vg.beginPath();
+      vg.circle(dot, 2.0f);
+      vg.fill();
+    }
+  });
+  bench.run("scatter/fillCircles", numDots, [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(0.2f, 0.5f, 1.0f, 1.0f));
+    vg.fillCircles(dots, 2.0f);
+  });
+
+  for (size_t count : { 1000, 10000, 100000, 1000000 }) {
+    auto line = randomPolyLine(count);
+    bench.run("polyLine/" + to_string(count), count, [&](nvg::Context &vg) {
+      vg.strokeColor(ColorAf(0.2f, 0.5f, 1.0f, 1.0f));
+      vg.strokeWidth(1.5f);
+      vg.beginPath();
+      vg.polyLine(line);
+      vg.stroke();
+    });
+  }
+
+  // A live plot scrolling through a 50k point window, 10 new points per frame.
+  const size_t numLive = 50000, numNew = 10;
+  auto livePoint = [](size_t i) {
+    float x = float(i) * 0.02f;
+    return vec2(x, kHeight * 0.5f + sin(x * 0.7f) * 100.0f + sin(x * 13.0f) * 10.0f);
+  };
+  auto liveTransform = [](nvg::Context &vg, size_t end) {
+    vg.translate(kWidth - float(end) * 0.02f, 0.0f);
+    vg.strokeColor(ColorAf(0.2f, 0.5f, 1.0f, 1.0f));
+    vg.strokeWidth(1.5f);
+  };
+  vector<vec2> livePoints;
+  size_t numPlotted = 0;
+  for (; numPlotted < numLive; ++numPlotted) livePoints.push_back(livePoint(numPlotted));
+  bench.run("livePlot/polyLine", numNew, [&](nvg::Context &vg) {
+    livePoints.erase(livePoints.begin(), livePoints.begin() + numNew);
+    for (size_t i = 0; i < numNew; ++i) livePoints.push_back(livePoint(numPlotted++));
+    vg.save();
+    liveTransform(vg, numPlotted);
+    vg.beginPath();
+    vg.moveToLines(livePoints.data(), livePoints.size());
+    vg.stroke();
+    vg.restore();
+  });
+  nvg::StreamingPolyline live(numLive);
+  size_t numStreamed = 0;
+  for (; numStreamed < numLive; ++numStreamed) live.append(livePoint(numStreamed));
+  bench.run("livePlot/streaming", numNew, [&](nvg::Context &vg) {
+    for (size_t i = 0; i < numNew; ++i) live.append(livePoint(numStreamed++));
+    vg.save();
+    liveTransform(vg, numStreamed);
+    vg.stroke(live);
+    vg.restore();
+  });
+
+  // A 1M sample random walk in a plot as wide as the frame, every sample and decimated.
+  const size_t numSamples = 1000000;
+  vector<float> samples(numSamples);
+  vector<vec2> samplePoints(numSamples);
+  Rectf plotRect(0.0f, 0.0f, float(kWidth), float(kHeight));
+  float value = 0.0f;
+  for (size_t i = 0; i < numSamples; ++i) {
+    value += rnd.nextFloat(-1.0f, 1.0f);
+    samples[i] = value;
+  }
+  auto range = minmax_element(samples.begin(), samples.end());
+  for (size_t i = 0; i < numSamples; ++i) {
+    float y = (samples[i] - *range.first) / (*range.second - *range.first);
+    samplePoints[i] = vec2(float(i) / (numSamples - 1) * kWidth, (1.0f - y) * kHeight);
+  }
+  bench.run("timeSeries/polyLine", numSamples, [&](nvg::Context &vg) {
+    vg.strokeColor(ColorAf(0.2f, 0.5f, 1.0f, 1.0f));
+    vg.beginPath();
+    vg.moveToLines(samplePoints.data(), samplePoints.size());
+    vg.stroke();
+  });
+  bench.run("timeSeries/decimated", numSamples, [&](nvg::Context &vg) {
+    vg.strokeColor(ColorAf(0.2f, 0.5f, 1.0f, 1.0f));
+    vg.beginPath();
+    vg.timeSeries(samples.data(), samples.size(), plotRect, *range.first, *range.second);
+    vg.stroke();
+  });
+}
+
+void svgBenchmarks(Benchmark &bench, const fs::path &assets) {
+  vector<pair<string, svg::DocRef>> docs;
+  docs.emplace_back("rainbow_dash", svg::Doc::create(loadFile(assets / "rainbow_dash.svg")));
+  for (size_t count : { 100, 1000, 10000 }) {
+    docs.emplace_back("synthetic_" + to_string(count), syntheticSvg(count));
+  }
+
+  for (auto &doc : docs) {
+    bench.run("svg/" + doc.first, 1, [&](nvg::Context &vg) {
+      vg.draw(*doc.second);
+    });
+
+    nvg::CompiledSvg compiled(*doc.second);
+    bench.run("compiledSvg/" + doc.first, 1, [&](nvg::Context &vg) {
+      vg.draw(compiled);
+    });
+
+    // Zoomed in on the center, where culling skips most of the document.
+    bench.run("compiledSvg/" + doc.first + "/zoomed", 1, [&](nvg::Context &vg) {
+      vg.translate(kWidth * 0.5f, kHeight * 0.5f);
+      vg.scale(8.0f, 8.0f);
+      vg.translate(-kWidth * 0.5f, -kHeight * 0.5f);
+      vg.draw(compiled);
+    });
+
+    // Zoomed out, where level of detail skips small elements and draws simplified paths.
+    compiled.setLevelOfDetail(2.0f, 0.5f);
+    bench.run("compiledSvg/" + doc.first + "/lod", 1, [&](nvg::Context &vg) {
+      vg.scale(0.25f, 0.25f);
+      vg.draw(compiled);
+    });
+  }
+}
+
+void textBenchmarks(Benchmark &bench, nvg::Context &ctx, const fs::path &assets) {
+  nvg::FontHandle font = ctx.createFont("roboto", assets / "Roboto-Regular.ttf");
+  if (!font.isValid()) {
+    fprintf(stderr, "Skipping text benchmarks, Roboto-Regular.ttf not found\n");
+    return;
+  }
+
+  const size_t numLabels = 200;
+  auto setFont = [&](nvg::Context &vg) {
+    vg.fontFace(font);
+    vg.fontSize(16.0f);
+    vg.fillColor(ColorAf(1.0f, 1.0f, 1.0f, 1.0f));
+  };
+
+  bench.run("text/label", numLabels, [&](nvg::Context &vg) {
+    setFont(vg);
+    for (size_t i = 0; i < numLabels; ++i) {
+      vg.text(10.0f, 10.0f + (i % 40) * 18.0f, "Frame time 16.67 ms");
+    }
+  });
+
+  bench.run("textBounds/label", numLabels, [&](nvg::Context &vg) {
+    setFont(vg);
+    for (size_t i = 0; i < numLabels; ++i) {
+      vg.textBounds(10.0f, 10.0f, "Frame time 16.67 ms");
+    }
+  });
+
+  const size_t numBoxes = 20;
+  bench.run("textBox/paragraph", numBoxes, [&](nvg::Context &vg) {
+    setFont(vg);
+    for (size_t i = 0; i < numBoxes; ++i) {
+      vg.textBox(10.0f, 10.0f + (i % 5) * 120.0f, 300.0f, kParagraph);
+    }
+  });
+
+  nvg::TextLayout layout(ctx, nvg::TextLayout::Style(font, 16.0f), kParagraph, 300.0f);
+  bench.run("textLayout/paragraph", numBoxes, [&](nvg::Context &vg) {
+    vg.fillColor(ColorAf(1.0f, 1.0f, 1.0f, 1.0f));
+    for (size_t i = 0; i < numBoxes; ++i) {
+      vg.text(layout, vec2(10.0f, 10.0f + (i % 5) * 120.0f));
+    }
+  });
+}
+
+} // anon
+
+int main(int argc, char **argv) {
+  bool sw = false;
+  int numFrames = 50;
+  fs::path assets = "samples/HelloSvg/assets";
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--sw") == 0) {
+      sw = true;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      numFrames = max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) {
+      assets = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--sw] [--frames N] [--assets DIR]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  auto run = [&](nvg::Context &ctx) {
+    Benchmark bench(ctx, numFrames);
+    pathBenchmarks(bench);
+    svgBenchmarks(bench, assets);
+    textBenchmarks(bench, ctx, assets);
+    bench.writeJson(sw ? "sw" : "null");
+  };
+
+  if (sw) {
+    auto ctx = nvg::createContextSW();
+    ctx.setTarget(Surface8u::create(kWidth, kHeight, true));
+    run(ctx);
+  } else {
+    auto ctx = nvg::createContextNull();
+    run(ctx);
+  }
+  return 0;
+}
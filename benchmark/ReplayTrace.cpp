@@ -0,0 +1,108 @@
+// Replays a trace recorded with nvg::TraceCapture into a backend in a timed loop, to profile
+// frames captured elsewhere and compare backend performance between builds.
+//
+//   ReplayTrace TRACE [--sw] [--loops N] [--frame I]
+//
+// By default the trace is played into the null backend, which measures replay overhead only;
+// --sw rasterizes it with the software backend. --frame loops over a single frame instead of the
+// whole trace. Per-frame times are written to stdout as JSON. benchmark/CMakeLists.txt builds
+// it along with the benchmark.
+
+#include "ci_nanovg.hpp"
+#include "ci_nanovg_null.hpp"
+#include "ci_nanovg_sw.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace ci;
+using namespace std;
+
+namespace {
+
+// Times every play of every frame, and prints the per-frame minimum, median and maximum.
+void replay(nvg::Context &ctx, nvg::TraceReplay &trace, int numLoops, int onlyFrame,
+            const char *backendName) {
+  size_t first = onlyFrame < 0 ? 0 : size_t(onlyFrame);
+  size_t last = onlyFrame < 0 ? trace.getNumFrames() : first + 1;
+
+  // One untimed pass creates the trace's textures. A single frame may use textures created or
+  // updated by the frames before it, so those are played first.
+  for (size_t i = 0; i < last; ++i) trace.playFrame(ctx, i);
+
+  vector<vector<double>> times(last - first);
+  for (int loop = 0; loop < numLoops; ++loop) {
+    for (size_t i = first; i < last; ++i) {
+      auto start = chrono::high_resolution_clock::now();
+      trace.playFrame(ctx, i);
+      auto end = chrono::high_resolution_clock::now();
+      times[i - first].push_back(chrono::duration<double, milli>(end - start).count());
+    }
+  }
+  trace.releaseTextures(ctx);
+
+  printf("{\n  \"backend\": \"%s\",\n  \"loops\": %d,\n  \"frames\": [\n", backendName, numLoops);
+  double total = 0.0;
+  for (size_t i = 0; i < times.size(); ++i) {
+    auto &t = times[i];
+    sort(t.begin(), t.end());
+    for (double ms : t) total += ms;
+    printf("    { \"frame\": %zu, \"minMs\": %.4f, \"medianMs\": %.4f, \"maxMs\": %.4f }%s\n",
+           first + i, t.front(), t[t.size() / 2], t.back(), i + 1 < times.size() ? "," : "");
+  }
+  printf("  ],\n  \"averageFrameMs\": %.4f\n}\n", total / (double(numLoops) * times.size()));
+}
+
+} // anon
+
+int main(int argc, char **argv) {
+  const char *path = nullptr;
+  bool sw = false;
+  int numLoops = 10, onlyFrame = -1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--sw") == 0) {
+      sw = true;
+    } else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+      numLoops = max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc) {
+      onlyFrame = atoi(argv[++i]);
+    } else if (!path && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      path = nullptr;
+      break;
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "Usage: %s TRACE [--sw] [--loops N] [--frame I]\n", argv[0]);
+    return 1;
+  }
+
+  nvg::TraceReplay trace(path);
+  if (trace.empty()) {
+    fprintf(stderr, "%s holds no complete frames\n", path);
+    return 1;
+  }
+  if (onlyFrame >= int(trace.getNumFrames())) {
+    fprintf(stderr, "The trace has %zu frames\n", trace.getNumFrames());
+    return 1;
+  }
+
+  if (sw) {
+    vec2 size = trace.getFrameSize(0) * trace.getDevicePixelRatio(0);
+    auto ctx = nvg::createContextSW();
+    ctx.setTarget(Surface8u::create(int(size.x), int(size.y), true));
+    replay(ctx, trace, numLoops, onlyFrame, "sw");
+  } else {
+    auto ctx = nvg::createContextNull();
+    replay(ctx, trace, numLoops, onlyFrame, "null");
+  }
+  return 0;
+}
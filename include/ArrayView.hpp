@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// A read-only pointer and size, for arrays that may live in a vector or in memory owned by
+// something else, such as a mapped file.
+template <typename T>
+class ArrayView {
+  const T *mData = nullptr;
+  size_t mSize = 0;
+
+public:
+  ArrayView() = default;
+  ArrayView(const T *data, size_t size) : mData{ data }, mSize{ size } {}
+  ArrayView(const std::vector<T> &vec) : mData{ vec.data() }, mSize{ vec.size() } {}
+
+  const T *data() const { return mData; }
+  size_t size() const { return mSize; }
+  bool empty() const { return mSize == 0; }
+
+  const T &operator[](size_t i) const { return mData[i]; }
+  const T &front() const { return mData[0]; }
+  const T &back() const { return mData[mSize - 1]; }
+
+  const T *begin() const { return mData; }
+  const T *end() const { return mData + mSize; }
+};
+
+}} // cinder::nvg
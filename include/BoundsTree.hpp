@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cinder/Rect.h"
+
+#include "ArrayView.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// A bounding volume hierarchy over a fixed set of rectangles, for finding the ones that overlap a
+// query rectangle without testing each. Items are split at the median of their centers along the
+// longer axis, so the tree stays balanced and queries visit O(log n + k) nodes.
+class BoundsTree {
+public:
+  struct Node {
+    Rectf bounds;
+    // Leaves hold items [first, first + count) of getItems(). Inner nodes have a count of 0 and
+    // their children at first and first + 1.
+    uint32_t first, count;
+  };
+
+protected:
+  std::vector<Node> mNodes;
+  // Item indices in leaf order, and their bounds in the same order.
+  std::vector<uint32_t> mItems;
+  std::vector<Rectf> mItemBounds;
+
+  // Set for trees wrapped around arrays stored elsewhere, in which case the vectors are empty.
+  ArrayView<Node> mNodeData;
+  ArrayView<uint32_t> mItemData;
+  ArrayView<Rectf> mItemBoundsData;
+  bool mWrapped = false;
+
+  void build(const std::vector<Rectf> &bounds, uint32_t index, uint32_t begin, uint32_t end);
+
+public:
+  BoundsTree() = default;
+  explicit BoundsTree(const std::vector<Rectf> &bounds);
+
+  // A tree over arrays in the layout getNodes(), getItems() and getItemBounds() return, such as
+  // ones saved to a file and mapped back in. They are not copied, and must outlive the tree.
+  static BoundsTree wrap(ArrayView<Node> nodes, ArrayView<uint32_t> items,
+                         ArrayView<Rectf> itemBounds);
+
+  bool empty() const { return getNodes().empty(); }
+  Rectf getBounds() const { return empty() ? Rectf() : getNodes()[0].bounds; }
+
+  ArrayView<Node> getNodes() const { return mWrapped ? mNodeData : mNodes; }
+  ArrayView<uint32_t> getItems() const { return mWrapped ? mItemData : mItems; }
+  ArrayView<Rectf> getItemBounds() const { return mWrapped ? mItemBoundsData : mItemBounds; }
+
+  // Appends the indices of the rectangles that overlap rect to result, in no particular order.
+  void query(const Rectf &rect, std::vector<uint32_t> &result) const;
+};
+
+}} // cinder::nvg
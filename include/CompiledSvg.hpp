@@ -0,0 +1,185 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Matrix.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+#include "nanovg.h"
+#include "ArrayView.hpp"
+#include "BoundsTree.hpp"
+#include "FontHandle.hpp"
+#include "FontRegistry.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cinder {
+
+namespace svg {
+  class Doc;
+  typedef std::shared_ptr<Doc> DocRef;
+} // svg
+
+namespace nvg {
+
+class Context;
+
+// An svg::Doc flattened into a draw program. The document tree is walked once on construction,
+// and every shape is stored as a range of path commands plus indices into tables of resolved
+// transforms and paints (with fill, stroke and group opacity already applied). Drawing is then a
+// single linear scan over those arrays with no allocations, instead of a full DOM traversal.
+//
+// Path commands use nanovg's float encoding (MOVETO, LINETO, BEZIERTO, CLOSE). Quadratic curves,
+// rects, circles and ellipses are converted to those on construction.
+//
+// A compiled document can be saved to a binary file with save() and mapped back in with load(),
+// which skips parsing the SVG. The file stores the arrays in the native layout of the build that
+// wrote it, so it is meant to be built alongside the app rather than exchanged between builds.
+class CompiledSvg {
+public:
+  enum Command { MOVETO, LINETO, BEZIERTO, CLOSE };
+
+  struct Element {
+    enum Type : uint8_t { SHAPE, TEXT };
+
+    Type type;
+    uint8_t lineCap, lineJoin;
+    uint32_t transform;
+    // Shapes index into the commands, text into the text spans.
+    uint32_t begin, end;
+    // Indices into the paints, or -1 for none.
+    int32_t fill, stroke;
+    float strokeWidth;
+  };
+
+  struct TextSpan {
+    std::string str;
+    std::vector<std::string> fontFamilies;
+    vec2 pen;
+    float rotation, fontSize;
+  };
+
+protected:
+  std::vector<Element> mElements;
+  std::vector<float> mCommands;
+  std::vector<mat3> mTransforms;
+  std::vector<NVGpaint> mPaints;
+  std::vector<TextSpan> mTextSpans;
+  Rectf mBounds;
+
+  // Document space bounds of the elements, for skipping the ones outside the visible part of the
+  // window. Strokes are padded for miter joins up to nanovg's default limit, and text is given an
+  // estimated box of one em per byte.
+  std::vector<Rectf> mElementBounds;
+  BoundsTree mBoundsTree;
+  mutable std::vector<uint32_t> mVisible;
+
+  // Set for documents mapped in by load(). The arrays above then stay empty, except for the text
+  // spans, and these point into the mapping instead.
+  FontRegistry::BlobRef mFile;
+  ArrayView<Element> mFileElements;
+  ArrayView<float> mFileCommands;
+  ArrayView<mat3> mFileTransforms;
+  ArrayView<NVGpaint> mFilePaints;
+  ArrayView<Rectf> mFileElementBounds;
+
+  // Checks that every index and command range in a loaded document is in bounds.
+  bool validate() const;
+
+  Rectf calcElementBounds(const Element &el) const;
+
+  // Simplified copies of the path commands, keyed by the power of two at or above the scale they
+  // are drawn at. Ranges hold each element's [begin, end) in the level's commands. Levels that
+  // remove too little to be worth it are kept empty and draw the original commands.
+  struct LodLevel {
+    std::vector<float> commands;
+    std::vector<uint32_t> ranges;
+  };
+
+  float mLodMinPixelSize = 0.0f, mLodTolerance = 0.0f;
+  mutable std::map<int, LodLevel> mLodLevels;
+
+  const LodLevel &getLodLevel(int level) const;
+
+  // Span faces, resolved from the font families the first time the document is drawn into a
+  // context. Spans whose families the context doesn't have use its current face.
+  mutable NVGcontext *mFontContext = nullptr;
+  mutable std::vector<FontHandle> mFonts;
+
+  void resolveFonts(Context &ctx) const;
+
+  friend class SvgCompiler;
+
+public:
+  CompiledSvg() = default;
+  explicit CompiledSvg(const svg::Doc &doc);
+
+  // Maps a document written by save(). Returns an empty CompiledSvg if the file can't be read, or
+  // was written by another version or build. Nothing but the text spans is copied out of the
+  // file, and the pages are shared with any other process mapping it.
+  static CompiledSvg load(const fs::path &path);
+  // Returns false if the file couldn't be written.
+  bool save(const fs::path &path) const;
+
+  bool empty() const { return getElements().empty(); }
+  const Rectf &getBounds() const { return mBounds; }
+
+  ArrayView<Element> getElements() const { return mFile ? mFileElements : mElements; }
+  ArrayView<float> getCommands() const { return mFile ? mFileCommands : mCommands; }
+  ArrayView<mat3> getTransforms() const { return mFile ? mFileTransforms : mTransforms; }
+  ArrayView<NVGpaint> getPaints() const { return mFile ? mFilePaints : mPaints; }
+  const std::vector<TextSpan> &getTextSpans() const { return mTextSpans; }
+  ArrayView<Rectf> getElementBounds() const { return mFile ? mFileElementBounds : mElementBounds; }
+
+  // Draws the document on top of the context's current transform. The context's state is saved
+  // before and restored after. Elements outside Context::getVisibleBounds() are skipped, so
+  // zoomed in views of large documents only pay for what is on screen.
+  void draw(Context &ctx) const;
+
+  const BoundsTree &getBoundsTree() const { return mBoundsTree; }
+
+  // Level of detail, off by default. Elements whose bounds project to less than minPixelSize
+  // device pixels in both directions are skipped. With a tolerance above 0, paths are drawn from
+  // copies simplified to stay within that many device pixels of the original, which are built the
+  // first time each zoom level is drawn and then cached.
+  void setLevelOfDetail(float minPixelSize, float tolerance = 0.0f);
+  float getLodMinPixelSize() const { return mLodMinPixelSize; }
+  float getLodTolerance() const { return mLodTolerance; }
+};
+
+typedef std::shared_ptr<CompiledSvg> CompiledSvgRef;
+
+// A CompiledSvg being built on a worker thread, returned by prepareSvgAsync(). Copies share the
+// same result.
+class PreparedSvg {
+protected:
+  std::shared_future<CompiledSvgRef> mFuture;
+
+public:
+  PreparedSvg() = default;
+  explicit PreparedSvg(std::shared_future<CompiledSvgRef> future) : mFuture{ std::move(future) } {}
+
+  // False for a default constructed PreparedSvg.
+  bool valid() const { return mFuture.valid(); }
+  bool isReady() const;
+
+  // The compiled document, or null if it isn't ready yet. Never blocks, so the render thread can
+  // keep drawing a placeholder or the previous version until it returns non-null. Rethrows any
+  // exception thrown while compiling.
+  CompiledSvgRef get() const { return isReady() ? mFuture.get() : nullptr; }
+  // Blocks until the document is ready.
+  CompiledSvgRef wait() const { return mFuture.valid() ? mFuture.get() : nullptr; }
+};
+
+// Compiles doc on a pool thread: the tree walk, shape conversion, paint conversion, path encoding
+// and bounds hierarchy are all built there. Only the font lookup is left for the first draw,
+// since it needs the context. The doc must not be modified until the result is ready.
+PreparedSvg prepareSvgAsync(svg::DocRef doc, ThreadPool &pool = ThreadPool::shared());
+
+}} // cinder::nvg
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "cinder/Color.h"
+#include "cinder/Matrix.h"
+#include "cinder/Path2d.h"
+#include "cinder/PolyLine.h"
+#include "cinder/Rect.h"
+#include "cinder/Shape2d.h"
+#include "cinder/Vector.h"
+
+#include "nanovg.h"
+#include "FontHandle.hpp"
+#include "PathRef.hpp"
+
+#include <string>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+class Context;
+
+// A recorded sequence of path, style, transform, state and text calls that can be replayed into
+// a context any number of times. Like nanovg's own path cache, commands live in one flat float
+// array with the command id first and its arguments after, so replaying is a single linear scan
+// with no allocation per call. Consecutive moveTo / lineTo / bezierTo / closePath / pathWinding
+// calls are stored as one PATH run in Tessellator's encoding, which replays with a single
+// transform-and-copy into the context's path. Paints and strings are kept in side tables.
+//
+// A display list is usually filled through Context::beginRecording() / endRecording(), but it
+// can also be built directly with the methods below. Building one touches no context or GL
+// state, so lists can be filled on worker threads (one per thread) and handed to
+// Context::submit() on the render thread, which is what the CommandBuffer name is for.
+class DisplayList {
+public:
+  enum Command {
+    BEGINPATH,
+    PATH,
+    QUADTO,
+    ARCTO,
+    ARC,
+    RECT,
+    ROUNDEDRECT,
+    ELLIPSE,
+    CIRCLE,
+    FILL,
+    STROKE,
+    FILLCOLOR,
+    STROKECOLOR,
+    FILLPAINT,
+    STROKEPAINT,
+    MITERLIMIT,
+    STROKEWIDTH,
+    LINECAP,
+    LINEJOIN,
+    COMPOSITEOPERATION,
+    COMPOSITEBLENDFUNC,
+    GLOBALALPHA,
+    SHAPEANTIALIAS,
+    SAVE,
+    RESTORE,
+    RESET,
+    RESETTRANSFORM,
+    TRANSFORM,
+    TRANSLATE,
+    ROTATE,
+    SKEWX,
+    SKEWY,
+    SCALE,
+    SCISSOR,
+    RESETSCISSOR,
+    FONTSIZE,
+    FONTBLUR,
+    FONTFACEID,
+    FONTFACE,
+    LETTERSPACING,
+    LINEHEIGHT,
+    TEXTALIGN,
+    TEXT,
+    TEXTBOX
+  };
+
+protected:
+  std::vector<float> mCommands;
+  std::vector<NVGpaint> mPaints;
+  std::string mStrings;
+  // Offset of the PATH run still being appended to, and the point quadTo() continues from when
+  // the list itself knows it.
+  size_t mPathRun = size_t(-1);
+  vec2 mPathPos;
+  bool mHasPathPos = false;
+
+  void push(Command cmd) {
+    mCommands.push_back(float(cmd));
+  }
+  template <typename... Args>
+  void push(Command cmd, Args... args) {
+    const float data[] = { float(cmd), float(args)... };
+    mCommands.insert(mCommands.end(), data, data + sizeof...(Args) + 1);
+  }
+
+  // Stores a null terminated copy of the string and returns its offset.
+  size_t pushString(const char *str, const char *end);
+  // Makes room for count floats of path commands at the end of the current PATH run, starting
+  // a new run if anything else was pushed since.
+  float *pushPath(size_t count);
+
+public:
+  DisplayList() = default;
+  DisplayList(DisplayList &&other);
+  DisplayList &operator=(DisplayList &&other);
+  DisplayList(const DisplayList &) = default;
+  DisplayList &operator=(const DisplayList &) = default;
+
+  bool empty() const { return mCommands.empty(); }
+  void clear();
+
+  // Size of the encoded commands and side tables in bytes.
+  size_t getNumBytes() const;
+
+  // Plays the list back into ctx with transform applied on top of its current transform. The
+  // context's state is saved before and restored after, and resetTransform() inside the list
+  // resets to the replay transform rather than to identity.
+  void replay(Context &ctx, const mat3 &transform = mat3(1)) const;
+
+  // Global Compositing //
+
+  void globalCompositeOperation(int op);
+  void globalCompositeBlendFuncSeparate(int srcRGB, int dstRGB, int srcAlpha, int dstAlpha);
+
+  // State Handling //
+
+  void save();
+  void restore();
+  void reset();
+
+  // Render Styles //
+
+  void strokeColor(const NVGcolor &color);
+  void strokeColor(const ColorAf &color);
+  void strokePaint(const NVGpaint &paint);
+  void fillColor(const NVGcolor &color);
+  void fillColor(const ColorAf &color);
+  void fillPaint(const NVGpaint &paint);
+
+  void miterLimit(float limit);
+  void strokeWidth(float size);
+  void lineCap(int cap);
+  void lineJoin(int join);
+  void globalAlpha(float alpha);
+  void shapeAntiAlias(bool enabled);
+
+  // Transform //
+
+  void resetTransform();
+  void transform(const mat3 &mtx);
+  void setTransform(const mat3 &mtx);
+  void translate(float x, float y);
+  void translate(const vec2 &translation);
+  void rotate(float angle);
+  void skewX(float angle);
+  void skewY(float angle);
+  void scale(float x, float y);
+  void scale(const vec2 &s);
+
+  // Scissoring //
+
+  void scissor(float x, float y, float w, float h);
+  void resetScissor();
+
+  // Paths //
+
+  void beginPath();
+  void moveTo(float x, float y);
+  void moveTo(const vec2 &p);
+  void lineTo(float x, float y);
+  void lineTo(const vec2 &p);
+  void quadTo(float cx, float cy, float x, float y);
+  void quadTo(const vec2 &p1, const vec2 &p2);
+  void bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y);
+  void bezierTo(const vec2 &p1, const vec2 &p2, const vec2 &p3);
+  void arcTo(float x1, float y1, float x2, float y2, float radius);
+  void arcTo(const vec2 &p1, const vec2 &p2, float radius);
+  void closePath();
+  void pathWinding(int dir);
+  void arc(float cx, float cy, float r, float a0, float a1, int dir);
+  void arc(const vec2 &center, float r, float a0, float a1, int dir);
+  void rect(float x, float y, float w, float h);
+  void rect(const Rectf &r);
+  void roundedRect(float x, float y, float w, float h, float r);
+  void roundedRect(const Rectf &rect, float r);
+  void ellipse(float cx, float cy, float rx, float ry);
+  void ellipse(const vec2 &center, float rx, float ry);
+  void circle(float cx, float cy, float r);
+  void circle(const vec2 &center, float radius);
+
+  void moveToLines(const vec2 *pts, size_t count, bool closed = false);
+  void polyLines(const vec2 *pts, const size_t *counts, size_t numLines, bool closed = false);
+  void appendPath(const PathRef &path);
+  void appendPath(const float *commands, size_t count);
+
+  void fill();
+  void stroke();
+
+  // Cinder Types //
+
+  void polyLine(const PolyLine2f &polyline);
+  void polyLines(const std::vector<PolyLine2f> &polylines);
+  void path2d(const Path2d &path);
+  void shape2d(const Shape2d &shape);
+
+  // Text //
+
+  void fontSize(float size);
+  void fontBlur(float blur);
+  void fontFaceId(int font);
+  void fontFace(const std::string &font);
+  void fontFace(const char *font);
+  void fontFace(FontHandle font);
+
+  void textLetterSpacing(float spacing);
+  void textLineHeight(float lineHeight);
+  void textAlign(int align);
+
+  void text(float x, float y, const std::string &str);
+  void text(const vec2 &p, const std::string &str);
+  void textBox(float x, float y, float breakRowWidth, const std::string &str);
+  void textBox(const vec2 &p, float breakRowWidth, const std::string &str);
+
+  // A null end reads str up to its terminator.
+  void text(float x, float y, const char *str, const char *end = nullptr);
+  void text(const vec2 &p, const char *str, const char *end = nullptr);
+  void textBox(float x, float y, float breakRowWidth, const char *str, const char *end = nullptr);
+  void textBox(const vec2 &p, float breakRowWidth, const char *str, const char *end = nullptr);
+};
+
+// A display list filled off the render thread and handed to Context::submit().
+typedef DisplayList CommandBuffer;
+
+}} // cinder::nvg
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace cinder { namespace nvg {
+
+// A font face resolved to its id in one context. Selecting a face by handle skips the name lookup
+// fontFace(name) does on every call, so resolve names once with Context::getFontHandle() and keep
+// the handle. Font ids returned by createFont() convert to handles.
+struct FontHandle {
+  int id;
+
+  FontHandle(int id = -1) : id{ id } {}
+
+  bool isValid() const { return id >= 0; }
+
+  bool operator==(const FontHandle &other) const { return id == other.id; }
+  bool operator!=(const FontHandle &other) const { return id != other.id; }
+};
+
+}} // cinder::nvg
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace cinder { namespace nvg {
+
+// Process-wide table of font files that contexts can share. Registering a face only records its
+// file. The file is memory mapped the first time a context uses the face, and the mapping is
+// shared by every context using it until the last one is destroyed. Contexts hand the mapped
+// bytes to nanovg without copying them, see Context::createFontFromRegistry().
+class FontRegistry {
+public:
+  // A read-only mapping of a whole file. Also used for CompiledSvg files.
+  class Blob {
+    const unsigned char *mData = nullptr;
+    size_t mSize = 0;
+#if defined(_WIN32)
+    void *mFile = nullptr, *mMapping = nullptr;
+#endif
+
+    Blob(const Blob &) = delete;
+    Blob &operator=(const Blob &) = delete;
+
+  public:
+    explicit Blob(const fs::path &path);
+    ~Blob();
+
+    bool empty() const { return mData == nullptr; }
+    const unsigned char *getData() const { return mData; }
+    size_t getSize() const { return mSize; }
+  };
+
+  using BlobRef = std::shared_ptr<const Blob>;
+
+protected:
+  struct Entry {
+    fs::path path;
+    std::weak_ptr<const Blob> blob;
+  };
+
+  mutable std::mutex mMutex;
+  std::unordered_map<std::string, Entry> mEntries;
+
+public:
+  FontRegistry() = default;
+
+  // Adds or replaces a face. Nothing is read until the face is acquired.
+  void registerFont(const std::string &name, const fs::path &path);
+  bool contains(const std::string &name) const;
+
+  // Returns the mapped file of a face, mapping it if no one holds it yet. Returns nullptr if the
+  // name isn't registered or the file can't be mapped.
+  BlobRef acquire(const std::string &name);
+
+  // The process-wide registry, created on first use.
+  static FontRegistry &shared();
+};
+
+}} // cinder::nvg
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// What one frame cost, see Context::getFrameStats(). Backend counts include everything that
+// reached the backend, whether it came from the wrapper, text or a display list replay.
+struct FrameStats {
+  // Path command values built by the wrapper, in floats like nanovg's command buffer.
+  size_t numCommands = 0;
+  // Points produced by flattening curves. Paths served from the tessellation cache add none.
+  size_t numPoints = 0;
+  // Subpaths and vertices handed to the backend by fill and stroke calls.
+  size_t numPaths = 0, numVertices = 0;
+  size_t numFills = 0, numStrokes = 0, numTriangles = 0;
+  // Glyph quads drawn and glyph atlas uploads.
+  size_t numGlyphs = 0, numAtlasUploads = 0;
+  // Backend calls whose paint samples an image, including the glyph atlas.
+  size_t numImageBinds = 0;
+  // Fills and strokes merged by batching (see Context::setBatching()), and the backend calls
+  // they were merged into. Those calls are also counted as triangles or strokes above.
+  size_t numBatchedDraws = 0, numBatches = 0;
+  // CPU time spent tessellating paths, and in endFrame() flushing the backend.
+  double tessellationMs = 0.0, flushMs = 0.0;
+};
+
+// The stats of the last frames in a ring buffer, with per-field summaries.
+class FrameStatsHistory {
+protected:
+  std::vector<FrameStats> mFrames;
+  size_t mCapacity, mNext = 0;
+
+public:
+  explicit FrameStatsHistory(size_t capacity = 120) : mCapacity{ capacity } {}
+
+  void add(const FrameStats &stats);
+  void clear();
+
+  size_t size() const { return mFrames.size(); }
+  size_t getCapacity() const { return mCapacity; }
+
+  // Each field of the result is computed over that field alone, so the fields of one result
+  // don't necessarily come from the same frame.
+  FrameStats getMin() const;
+  FrameStats getMax() const;
+  FrameStats getAverage() const;
+  // Nearest-rank percentile, with percentile in [0, 100].
+  FrameStats getPercentile(float percentile) const;
+};
+
+}} // cinder::nvg
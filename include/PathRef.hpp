@@ -0,0 +1,61 @@
+#pragma once
+
+#include "cinder/Path2d.h"
+#include "cinder/PolyLine.h"
+#include "cinder/Rect.h"
+#include "cinder/Shape2d.h"
+#include "cinder/Vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// Immutable path geometry encoded once in nanovg's command format (MOVETO, LINETO, BEZIERTO,
+// CLOSE), with quadratics raised to cubics and closes kept as real close commands. Appending one
+// to a context is a single transformed copy, instead of walking Path2d segments on every draw.
+//
+// Every PathRef gets a unique id on construction, which copies share. Since the geometry can't
+// change, the id can be passed to Context::cachePath() as is.
+class PathRef {
+public:
+  enum Command { MOVETO, LINETO, BEZIERTO, CLOSE };
+
+protected:
+  std::vector<float> mCommands;
+  Rectf mBounds;
+  vec2 mEndPoint;
+  uint64_t mId = 0;
+
+  void encode(const Path2d &path);
+  void encode(const PolyLine2f &polyline);
+  void finish();
+
+public:
+  PathRef() = default;
+  explicit PathRef(const Path2d &path);
+  explicit PathRef(const Shape2d &shape);
+  explicit PathRef(const PolyLine2f &polyline);
+
+  PathRef(PathRef &&other);
+  PathRef &operator=(PathRef &&other);
+  PathRef(const PathRef &) = default;
+  PathRef &operator=(const PathRef &) = default;
+
+  // Appends the commands for path, and sets endPoint unless the path is empty. For encoding into a
+  // reused buffer without building a PathRef.
+  static void encode(const Path2d &path, std::vector<float> &commands, vec2 &endPoint);
+
+  bool empty() const { return mCommands.empty(); }
+  const std::vector<float> &getCommands() const { return mCommands; }
+  // Bounds of the points, including bezier control points.
+  const Rectf &getBounds() const { return mBounds; }
+  // The current point after the path, which quadTo() and arcTo() continue from.
+  const vec2 &getEndPoint() const { return mEndPoint; }
+
+  // Non-zero for paths with geometry. Ids have the top bit set, so they don't collide with
+  // small user chosen cache keys.
+  uint64_t getId() const { return mId; }
+};
+
+}} // cinder::nvg
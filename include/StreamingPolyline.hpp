@@ -0,0 +1,68 @@
+#pragma once
+
+#include "cinder/Vector.h"
+
+#include "nanovg.h"
+#include "ArrayView.hpp"
+#include "TessellationCache.hpp"
+#include "Tessellator.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+class Context;
+
+// A polyline that grows at its end, such as a live plot, and keeps its stroke between frames.
+// Context::stroke(StreamingPolyline &) only expands the joins of points appended since the last
+// stroke and a new end cap, so the work per frame follows the number of new points rather than
+// the length of the line. With a capacity set, the oldest points are dropped as new ones come in
+// and the stroke slides along with them.
+//
+// Like cached paths, the stroke is expanded under the scale bucket of the transform it is drawn
+// with. It is expanded again from the start when that, the stroke style or the fringe changes.
+class StreamingPolyline {
+protected:
+  friend class Context;
+
+  // The line is mPoints from mFirst on. Dropped points are erased in bulk.
+  std::vector<vec2> mPoints;
+  size_t mFirst = 0, mCapacity = 0;
+
+  // The stroke without its start cap: the joins of points mFirst + 1 up to mNumJoined, which
+  // begin at the offsets in mJoinBegins (indexed like mPoints), then the end cap from mCapBegin.
+  // mHead is the start cap, ending in the first pair of vertices of the rest.
+  bool mExpanded = false;
+  TessellationCache::Key mKey;
+  float mCanonical[6];
+  int mLineCap = NVG_BUTT, mLineJoin = NVG_MITER;
+  std::vector<NVGvertex> mVerts, mHead;
+  std::vector<size_t> mJoinBegins;
+  size_t mNumJoined = 0, mCapBegin = 0;
+
+  size_t getStrokeBegin() const;
+  // Erases the dropped points and their vertices.
+  void compact();
+  // Brings the stroke up to date for the key and canonical transform from
+  // TessellationCache::splitTransform(), and returns the number of points expanded.
+  size_t expand(const Tessellator &tess, const TessellationCache::Key &key,
+                const float *canonical, float fringe, int lineCap, int lineJoin);
+
+public:
+  explicit StreamingPolyline(size_t capacity = 0);
+
+  void append(const vec2 &point);
+  void append(ArrayView<vec2> points);
+  void clear();
+
+  // Keeps at most capacity points, dropping the oldest ones first. 0 keeps every point.
+  void setCapacity(size_t capacity);
+  size_t getCapacity() const { return mCapacity; }
+
+  size_t size() const { return mPoints.size() - mFirst; }
+  bool empty() const { return size() == 0; }
+  ArrayView<vec2> getPoints() const { return ArrayView<vec2>(mPoints.data() + mFirst, size()); }
+};
+
+}} // cinder::nvg
@@ -1,12 +1,31 @@
 #pragma once
 
 #include "cinder/svg/Svg.h"
+
+#include "nanovg.h"
+#include "FontHandle.hpp"
+
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace cinder { namespace nvg {
 
 class Context;
 
+NVGcolor toNVGcolor(const ColorAf &color);
+// Same as the paint nanovg builds internally for fillColor / strokeColor.
+NVGpaint colorPaint(const NVGcolor &color);
+
+// Conversions from Cinder's SVG model, shared by SvgRenderer and CompiledSvg so a document looks
+// the same drawn either way.
+int convertLineCap(svg::LineCap lineCap);
+int convertLineJoin(svg::LineJoin lineJoin);
+float convertFontSize(const svg::TextSpan &span);
+// Sets result to paint with opacity applied. Returns false for no paint and for radial
+// gradients, which aren't supported yet.
+bool convertPaint(const svg::Paint &paint, float opacity, NVGpaint &result);
+
 class SvgRenderer : public svg::Renderer {
   Context &mCtx; // TODO(ryan): This should probably be a managed pointer..
 
@@ -20,6 +39,25 @@ class SvgRenderer : public svg::Renderer {
   std::vector<vec2> mTextPenStack;
   std::vector<float> mTextRotationStack;
 
+  // Font families resolved so far, so each is looked up once per document, and the face the
+  // context had at construction, which spans in other families use.
+  std::vector<std::pair<std::string, FontHandle>> mFonts;
+  int mDefaultFont;
+
+  // The state last sent to the context. Pushes and pops only change the stacks, and a shape sends
+  // the fields that differ when it is drawn, so deep group hierarchies cost nothing until they
+  // hold something visible.
+  mat3 mAppliedTransform;
+  float mAppliedStrokeWidth = -1.0f;
+  int mAppliedLineCap = -1, mAppliedLineJoin = -1;
+  bool mTextAlignApplied = false;
+
+  void applyTransform(const mat3 &transform);
+  void applyStrokeState();
+  void beginShape();
+
+  FontHandle resolveFont(const std::vector<std::string> &families);
+
 public:
   SvgRenderer(Context &ctx);
 
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Tessellator.hpp"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+namespace cinder { namespace nvg {
+
+// Keeps the tessellated vertices of static paths between frames. Entries are keyed by a path key
+// chosen by the caller, the fill or stroke parameters, and the part of the transform that affects
+// tessellation. Paths are tessellated in a canonical space: for transforms made of translation,
+// rotation, uniform scale and mirroring that is the path scaled by a bucketed scale (and mirrored),
+// so a path that only moves and rotates, or scales within a bucket, keeps hitting the same entry.
+// Other transforms keep their full linear part. Only the remaining transform is applied to the
+// cached vertices on a hit.
+//
+// The least recently used entries are evicted once the byte budget is exceeded.
+class TessellationCache {
+public:
+  struct Key {
+    uint64_t path;
+    // Fill or stroke, anti-aliasing, line cap and join.
+    uint32_t flags;
+    // Scale bucket for similarity transforms, or kGeneral when linear holds the full 2x2 part.
+    int32_t scale;
+    float linear[4];
+    float fringe, strokeWidth, miterLimit;
+
+    bool operator==(const Key &other) const;
+  };
+
+  static const int32_t kGeneral = INT32_MIN;
+
+  // Splits a nanovg transform into the canonical transform paths are tessellated under and the
+  // remaining transform to apply to cached vertices (xform = remaining * canonical). Fills in the
+  // key's scale and linear fields.
+  static void splitTransform(const float *xform, Key &key, float *canonical, float *remaining);
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+protected:
+
+  struct Entry {
+    Tessellation tessellation;
+    std::list<Key>::iterator lru;
+
+    Entry() = default;
+    Entry(Entry &&other) : tessellation{ std::move(other.tessellation) }, lru{ other.lru } {}
+  };
+
+  std::unordered_map<Key, Entry, KeyHash> mEntries;
+  std::list<Key> mLru; // Most recently used first.
+
+  size_t mNumBytes = 0, mByteBudget = 64 * 1024 * 1024;
+  size_t mHits = 0, mMisses = 0;
+
+  void evict();
+
+public:
+  TessellationCache() = default;
+  TessellationCache(TessellationCache &&other);
+
+  // Returns the cached tessellation for key, or nullptr on a miss.
+  const Tessellation *find(const Key &key);
+  // Stores a tessellation for key and returns the cached copy, which stays valid until the next
+  // insert.
+  const Tessellation *insert(const Key &key, Tessellation &&tessellation);
+
+  // Drops every entry for a path key, for example when its geometry changed.
+  void invalidate(uint64_t path);
+  void clear();
+
+  size_t getNumEntries() const { return mEntries.size(); }
+  size_t getNumBytes() const { return mNumBytes; }
+
+  size_t getByteBudget() const { return mByteBudget; }
+  void setByteBudget(size_t bytes);
+
+  size_t getHits() const { return mHits; }
+  size_t getMisses() const { return mMisses; }
+  void resetCounters() { mHits = mMisses = 0; }
+};
+
+}} // cinder::nvg
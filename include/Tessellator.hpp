@@ -0,0 +1,133 @@
+#pragma once
+
+#include "nanovg.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+class Tessellator;
+
+// Vertices and paths for one fill or stroke, detached from the tessellator that produced them.
+// The paths point into verts, so a tessellation can be moved but not copied.
+struct Tessellation {
+  std::vector<NVGvertex> verts;
+  std::vector<NVGpath> paths;
+  float bounds[4];
+
+  Tessellation() = default;
+  Tessellation(Tessellation &&other);
+  Tessellation &operator=(Tessellation &&other);
+
+  Tessellation(const Tessellation &) = delete;
+  Tessellation &operator=(const Tessellation &) = delete;
+
+  // Copies the tessellator's current output.
+  void assign(const Tessellator &tess);
+  // Copies another tessellation with xform applied to its vertices and bounds.
+  void assign(const Tessellation &src, const float *xform);
+
+  size_t getNumBytes() const;
+};
+
+// A port of the path flattening and fill / stroke expansion that nanovg does inside nvgFill and
+// nvgStroke. Paths in nanovg's command encoding go in and the NVGpath arrays that backends'
+// renderFill / renderStroke take come out, so tessellation can happen outside of a context,
+// be cached, or run on other threads. Buffers are reused between calls.
+class Tessellator {
+public:
+  // Same values as nanovg's own commands.
+  enum Command { MOVETO, LINETO, BEZIERTO, CLOSE, WINDING };
+
+  enum PointFlags { PT_CORNER = 0x01, PT_LEFT = 0x02, PT_BEVEL = 0x04, PT_INNERBEVEL = 0x08 };
+
+  struct Point {
+    float x, y;
+    float dx, dy;
+    float len;
+    float dmx, dmy;
+    uint8_t flags;
+  };
+
+protected:
+  float mTessTol = 0.25f, mDistTol = 0.01f, mFringeWidth = 1.0f;
+
+  std::vector<Point> mPoints;
+  std::vector<NVGpath> mPaths;
+  std::vector<NVGvertex> mVerts;
+  size_t mNumVerts = 0;
+  float mBounds[4];
+
+  void addPath();
+  void addPoint(float x, float y, int flags);
+  void tessellateBezier(float x1, float y1, float x2, float y2, float x3, float y3, float x4,
+                        float y4, int level, int type);
+  void calculateJoins(float w, int lineJoin, float miterLimit);
+  NVGvertex *allocVerts(size_t count);
+
+public:
+  Tessellator() = default;
+  Tessellator(Tessellator &&other);
+
+  Tessellator(const Tessellator &) = delete;
+  Tessellator &operator=(const Tessellator &) = delete;
+
+  // Sets the curve tolerance, point merge distance and anti-aliasing fringe the same way
+  // nvgBeginFrame does.
+  void setDevicePixelRatio(float ratio);
+  float getFringeWidth() const { return mFringeWidth; }
+  float getTessTol() const { return mTessTol; }
+  float getDistTol() const { return mDistTol; }
+
+  // Flattens a command buffer into polygons, replacing any previous output. Commands need to be
+  // in the space the paths are rendered in, since the tolerances are in pixels.
+  void flatten(const float *commands, size_t count);
+
+  // Expand the flattened polygons into vertices. Pass a fill fringe of 0 to disable
+  // anti-aliasing. Stroke widths are half widths, as in nanovg.
+  void expandFill(float fringe, int lineJoin = NVG_MITER, float miterLimit = 2.4f);
+  void expandStroke(float halfWidth, float fringe, int lineCap, int lineJoin, float miterLimit);
+
+  // Append to out the vertices expandStroke() makes for one cap or join of an open polyline of
+  // line segments, so a long polyline can be extended without expanding all of it again. pts
+  // holds x,y pairs: the first two points of the polyline for its start cap, the last two for
+  // its end cap, or three points for the join at the middle one. Widths as in expandStroke().
+  void appendStrokeCap(const float *pts, bool start, float halfWidth, float fringe, int lineCap,
+                       std::vector<NVGvertex> &out) const;
+  void appendStrokeJoin(const float *pts, float halfWidth, float fringe, int lineJoin,
+                        float miterLimit, std::vector<NVGvertex> &out) const;
+
+  size_t getNumPoints() const { return mPoints.size(); }
+  const NVGpath *getPaths() const { return mPaths.data(); }
+  int getNumPaths() const { return int(mPaths.size()); }
+  const NVGvertex *getVerts() const { return mVerts.data(); }
+  size_t getNumVerts() const { return mNumVerts; }
+  const float *getBounds() const { return mBounds; }
+};
+
+// Returns the average scale of a nanovg transform, as used for stroke widths.
+float getAverageScale(const float *xform);
+
+// Applies a nanovg transform to the points of count floats of encoded commands. src and dst can
+// be the same.
+void transformCommands(float *dst, const float *src, size_t count, const float *xform);
+
+// Returns the last point of count floats of encoded commands, or null if they have none. Only
+// the command ids are read on the way.
+const float *findEndPoint(const float *commands, size_t count);
+
+// Applies a nanovg transform to the positions of count vertices, keeping their uvs. src and dst
+// can be the same. Uses SSE2 where available.
+void transformVertices(NVGvertex *dst, const NVGvertex *src, size_t count, const float *xform);
+
+// Encodes count x,y pairs as LINETO commands (3 floats each) with a nanovg transform applied.
+// Uses SSE2 where available.
+void transformLineCommands(float *dst, const float *pts, size_t count, const float *xform);
+
+// Finds the first lowest and first highest of count values, which must be at least one. Uses
+// SSE2 where available.
+void findMinMax(const float *values, size_t count, size_t &minIndex, size_t &maxIndex);
+
+}} // cinder::nvg
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "cinder/Rect.h"
+
+#include "nanovg.h"
+#include "FontHandle.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+class Context;
+
+// A string measured and broken into rows once, for text that is drawn or measured repeatedly.
+// Building a layout does the line breaking, alignment, bounds and glyph position work that
+// textBox() and textBoxBounds() otherwise redo on every call. Draw it with Context::text().
+//
+// Layouts are measured without the context's transform, so they stay valid under any transform
+// but need rebuilding when the font, style or string changes.
+class TextLayout {
+public:
+  struct Style {
+    FontHandle font;
+    float size;
+    int align;
+    float letterSpacing, lineHeight;
+
+    Style(FontHandle font = FontHandle(), float size = 16.0f,
+          int align = NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE, float letterSpacing = 0.0f,
+          float lineHeight = 1.0f)
+    : font{ font }, size{ size }, align{ align }, letterSpacing{ letterSpacing },
+      lineHeight{ lineHeight } {}
+  };
+
+  // A row of text, drawn left aligned at (x, y) from the layout origin. Byte offsets index into
+  // the layout's text, glyph offsets into its glyphs.
+  struct Row {
+    uint32_t begin, end;
+    uint32_t glyphBegin, glyphEnd;
+    float x, y, width;
+  };
+
+  // Glyph positions relative to the layout origin, for hit testing and carets.
+  struct Glyph {
+    uint32_t offset;
+    float x, minX, maxX;
+  };
+
+protected:
+  Style mStyle;
+  std::string mText;
+  float mBreakWidth = 0.0f;
+  std::vector<Row> mRows;
+  std::vector<Glyph> mGlyphs;
+  Rectf mBounds;
+
+  void addRow(NVGcontext *ctx, const char *begin, const char *end, float x, float y,
+              float width);
+
+public:
+  TextLayout() = default;
+  // A break width of 0 lays the string out on a single line with the style's alignment, like
+  // text(). Otherwise it is broken into rows like textBox().
+  TextLayout(Context &ctx, const Style &style, const std::string &text, float breakWidth = 0.0f);
+
+  TextLayout(TextLayout &&other);
+  TextLayout &operator=(TextLayout &&other);
+  TextLayout(const TextLayout &) = default;
+  TextLayout &operator=(const TextLayout &) = default;
+
+  bool empty() const { return mRows.empty(); }
+
+  const Style &getStyle() const { return mStyle; }
+  const std::string &getText() const { return mText; }
+  float getBreakWidth() const { return mBreakWidth; }
+  const std::vector<Row> &getRows() const { return mRows; }
+  const std::vector<Glyph> &getGlyphs() const { return mGlyphs; }
+  const Rectf &getBounds() const { return mBounds; }
+};
+
+}} // cinder::nvg
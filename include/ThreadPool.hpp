@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// A fixed set of worker threads shared by the CPU-side stages of the wrapper. Work is either
+// queued as independent tasks or split across the pool with parallelFor.
+class ThreadPool {
+  std::vector<std::thread> mThreads;
+  std::deque<std::function<void()>> mQueue;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mStopping = false;
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void workerLoop();
+  void enqueue(std::function<void()> task);
+
+public:
+  // A thread count of 0 uses one thread per hardware core.
+  explicit ThreadPool(size_t numThreads = 0);
+  ~ThreadPool();
+
+  size_t getNumThreads() const { return mThreads.size(); }
+
+  // Calls fn(i) for every i in [0, count) and blocks until all calls have returned. The calling
+  // thread takes part in the work, so this is safe to call from inside a pool task.
+  void parallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+  // Calls fn(worker) once per worker slot in [0, getNumThreads() + 1). Use this when each worker
+  // needs its own scratch memory and pulls work from a shared counter.
+  void parallelWorkers(const std::function<void(size_t)> &fn);
+
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> async(F fn) {
+    using Result = typename std::result_of<F()>::type;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+    auto future = task->get_future();
+    enqueue([task] { (*task)(); });
+    return future;
+  }
+
+  // The process-wide pool, created on first use.
+  static ThreadPool &shared();
+};
+
+}} // cinder::nvg
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+
+#include "ci_nanovg.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// Records every call a context makes to its backend into a binary trace file: viewports, flushes,
+// texture creation and uploads, and fills, strokes and triangles with their paint, scissor,
+// composite operation and vertices. Records are buffered and written out at the end of every
+// frame, so a trace of a process that crashes or is killed still holds all finished frames.
+//
+// The capture hooks the backend functions of the context's nanovg instance, and stops when it is
+// destroyed. It must be destroyed before the context. Textures created before the capture
+// started are recorded by size only.
+class TraceCapture {
+protected:
+  struct Texture {
+    int type, width, height;
+  };
+
+  NVGparams *mParams;
+  // The functions that were installed when the capture started.
+  NVGparams mBackend;
+  std::ofstream mFile;
+  std::vector<uint32_t> mBuffer;
+  std::map<int, Texture> mTextures;
+  size_t mNumFrames = 0, mNumBytes = 0;
+
+  TraceCapture(const TraceCapture &) = delete;
+  TraceCapture &operator=(const TraceCapture &) = delete;
+
+  template <typename T>
+  void write(const T &value) {
+    static_assert(sizeof(T) % 4 == 0, "Trace values are whole words");
+    size_t pos = mBuffer.size();
+    mBuffer.resize(pos + sizeof(T) / 4);
+    std::memcpy(&mBuffer[pos], &value, sizeof(T));
+  }
+  void writeBytes(const void *data, size_t numBytes);
+  void writeState(const NVGpaint *paint, const NVGcompositeOperationState &compositeOperation,
+                  const NVGscissor *scissor, float fringe);
+  void writePaths(const NVGpath *paths, int npaths);
+  void writeToFile();
+
+  // Records a texture that was created before the capture started.
+  void declareTexture(int image, int type);
+
+  static int createTextureHook(void *uptr, int type, int w, int h, int imageFlags,
+                               const unsigned char *data);
+  static int deleteTextureHook(void *uptr, int image);
+  static int updateTextureHook(void *uptr, int image, int x, int y, int w, int h,
+                               const unsigned char *data);
+  static void viewportHook(void *uptr, float width, float height, float devicePixelRatio);
+  static void cancelHook(void *uptr);
+  static void flushHook(void *uptr);
+  static void fillHook(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                       NVGscissor *scissor, float fringe, const float *bounds,
+                       const NVGpath *paths, int npaths);
+  static void strokeHook(void *uptr, NVGpaint *paint,
+                         NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                         float fringe, float strokeWidth, const NVGpath *paths, int npaths);
+  static void trianglesHook(void *uptr, NVGpaint *paint,
+                            NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                            const NVGvertex *verts, int nverts, float fringe);
+
+public:
+  TraceCapture(Context &ctx, const fs::path &path);
+  ~TraceCapture();
+
+  bool isOpen() const { return mFile.is_open(); }
+
+  // Frames finished and bytes written to the file so far.
+  size_t getNumFrames() const { return mNumFrames; }
+  size_t getNumBytes() const { return mNumBytes; }
+};
+
+// A trace file loaded for replaying into a context's backend. Frames are played by calling the
+// backend functions directly with the recorded arguments, so no path building, tessellation or
+// text layout happens and the cost measured is the backend's alone.
+//
+// A truncated trace loads up to its last complete frame.
+class TraceReplay {
+protected:
+  struct Frame {
+    size_t begin, end;
+    vec2 size;
+    float devicePixelRatio;
+  };
+
+  // Trace textures, created in the replaying backend on first use and kept across plays so that
+  // looping over frames doesn't recreate them. Uploads go through a full-size copy of the
+  // texture, since the backend expects the whole image with the updated region in place.
+  struct Texture {
+    int image, type, width, height;
+    std::vector<unsigned char> data;
+  };
+
+  std::vector<uint32_t> mWords;
+  std::vector<Frame> mFrames;
+  std::map<int, Texture> mTextures;
+  std::vector<NVGpath> mPaths;
+
+  // The size in words of the record at pos, or 0 if it is cut off or malformed.
+  size_t recordSize(size_t pos) const;
+
+  int image(int traceImage) const;
+  void readState(size_t &pos, NVGpaint &paint, NVGcompositeOperationState &compositeOperation,
+                 NVGscissor &scissor, float &fringe);
+  void readPaths(size_t &pos, int npaths);
+
+public:
+  explicit TraceReplay(const fs::path &path);
+
+  bool empty() const { return mFrames.empty(); }
+  size_t getNumFrames() const { return mFrames.size(); }
+  // The window size and device pixel ratio the frame was drawn with.
+  vec2 getFrameSize(size_t frame) const { return mFrames[frame].size; }
+  float getDevicePixelRatio(size_t frame) const { return mFrames[frame].devicePixelRatio; }
+
+  // Plays one frame into the backend of ctx, which must not be inside beginFrame / endFrame.
+  void playFrame(Context &ctx, size_t frame);
+  void play(Context &ctx);
+
+  // Deletes the textures the replay created in the backend of ctx.
+  void releaseTextures(Context &ctx);
+};
+
+}} // cinder::nvg
@@ -9,9 +9,25 @@
 #include "cinder/Vector.h"
 
 #include "nanovg.h"
-
+#include "ArrayView.hpp"
+#include "CompiledSvg.hpp"
+#include "DisplayList.hpp"
+#include "FontHandle.hpp"
+#include "FontRegistry.hpp"
+#include "FrameStats.hpp"
+#include "PathRef.hpp"
+#include "StreamingPolyline.hpp"
+#include "TessellationCache.hpp"
+#include "Tessellator.hpp"
+#include "TextLayout.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace cinder {
 
@@ -40,17 +56,227 @@ public:
   Image &operator=(Image &&image);
 };
 
+// Counters for the glyph atlas fontstash rasterizes into, see Context::getGlyphAtlasStats().
+struct GlyphAtlasStats {
+  // Size of the current atlas texture.
+  int width = 0, height = 0;
+  // Fraction of the atlas rows glyphs have been uploaded to. Glyphs are packed row by row from
+  // the top, so this is a close upper bound on how full the atlas is.
+  float occupancy = 0.0f;
+  // Times the atlas filled up mid-frame and was replaced by a larger one, which re-rasterizes
+  // every glyph drawn after it.
+  size_t numResets = 0;
+  size_t numUploads = 0, numUploadedBytes = 0;
+};
+
 class Context {
 protected:
   using Deleter = void (*)(NVGcontext *);
 
+  // Paths are built, tessellated and handed to the backend by the wrapper rather than through
+  // nvgFill / nvgStroke, so the parts of nanovg's state those need are mirrored here. Everything
+  // is still forwarded to nanovg as well, which text rendering relies on. The font face is kept
+  // too, since nanovg has no getter for it.
+  struct State {
+    NVGcompositeOperationState compositeOperation;
+    NVGpaint fill, stroke;
+    float alpha, strokeWidth, miterLimit;
+    bool shapeAntiAlias;
+    int lineJoin, lineCap;
+    float xform[6];
+    NVGscissor scissor;
+    int font;
+  };
+
+  // Font files shared through the FontRegistry. Declared before mPtr so they stay mapped until
+  // the nanovg context is gone.
+  std::vector<FontRegistry::BlobRef> mFontBlobs;
+
   std::unique_ptr<NVGcontext, Deleter> mPtr;
+  std::unique_ptr<DisplayList> mRecording;
+
+  std::vector<State> mStates;
+  std::vector<float> mCommands, mCanonicalCommands;
+  vec2 mCommandPos;
+  uint64_t mPathKey = 0;
+
+  Tessellator mTessellator;
+  TessellationCache mTessellationCache;
+  Tessellation mTransformed;
+  float mDevicePixelRatio = 1.0f;
+  vec2 mViewSize;
+
+  // A fill or stroke with the state it was issued under. Deferred ones keep their commands in
+  // [begin, end) of mDeferredCommands, or are already tessellated when they hit the cache.
+  struct PathDraw {
+    bool stroke, antiAlias, tessellated;
+    NVGpaint paint;
+    NVGcompositeOperationState compositeOperation;
+    NVGscissor scissor;
+    float fringe, strokeWidth, miterLimit;
+    int lineCap, lineJoin;
+    size_t begin, end;
+  };
+
+  // Commands of the path drawn by drawInstances(const Path2d &, ...), and its tessellations, one
+  // per scale bucket its instances fall into, indexed by key. Entries past
+  // mNumInstanceTessellations are kept for their memory.
+  std::vector<float> mInstanceCommands;
+  std::unordered_map<TessellationCache::Key, size_t, TessellationCache::KeyHash> mInstanceIndices;
+  std::vector<Tessellation> mInstanceTessellations;
+  size_t mNumInstanceTessellations = 0;
+
+  // Outlines of the shape being drawn by fillCircles() and friends, the unit directions of their
+  // corners, rebuilt when the number of segments changes, and the path set aside by their
+  // fallback.
+  std::vector<vec2> mShapeInner, mShapeOuter, mCornerDirs;
+  std::vector<float> mStashedCommands;
+  vec2 mStashedCommandPos;
+  uint64_t mStashedPathKey = 0;
+  // Points left of a series by timeSeries().
+  std::vector<vec2> mSeriesPoints;
+
+  ThreadPool *mTessellationPool = nullptr;
+  std::vector<PathDraw> mDeferred;
+  std::vector<Tessellation> mDeferredTessellations;
+  size_t mNumDeferred = 0;
+  std::vector<float> mDeferredCommands;
+  std::vector<Tessellator> mWorkerTessellators;
+
+  // Watches the backend calls made by nanovg and the wrapper, to track the glyph atlas and count
+  // frame stats. Heap allocated so the hooks can find it after the context is moved.
+  struct BackendMonitor {
+    NVGparams *params;
+    // The backend's own functions.
+    NVGparams backend;
+    int atlas = 0, usedHeight = 0;
+    GlyphAtlasStats atlasStats;
+    FrameStats frame;
+
+    // Draw call batching, see setBatching(). Fills become triangles that read their color and
+    // edge coverage from rows of a palette texture: the color at alpha 0 and at full alpha, which
+    // the backend's bilinear filtering blends by the coverage stored in each vertex's u.
+    enum BatchType { BATCH_NONE, BATCH_FILLS, BATCH_STROKES };
+
+    struct Palette {
+      int image, numRows, numUploaded;
+      std::vector<uint8_t> texels;
+    };
+
+    bool batching = false;
+    BatchType batchType = BATCH_NONE;
+    NVGpaint batchPaint;
+    NVGcompositeOperationState batchCompositeOperation;
+    NVGscissor batchScissor;
+    float batchFringe, batchStrokeWidth;
+    std::vector<NVGvertex> batchVerts;
+    std::vector<NVGpath> batchPaths;
+    // Palettes are filled up one after another during a frame, and reused the next frame.
+    std::vector<Palette> palettes;
+    size_t palette = 0;
+    // Palette and row of every color used this frame, keyed by its RGBA8 value.
+    std::unordered_map<uint32_t, std::pair<size_t, int>> paletteRows;
+
+    explicit BackendMonitor(NVGparams *params);
+    ~BackendMonitor();
+
+    // Starts or continues a batch of fill triangles in paint's color, and returns the palette
+    // texture coordinate for it. Returns false if paint isn't a solid color.
+    bool beginCoverageBatch(const NVGpaint &paint,
+                            const NVGcompositeOperationState &compositeOperation,
+                            const NVGscissor &scissor, float fringe, float &paletteV);
+    // Add a draw to the pending batch, or return false if it can't be batched.
+    bool batchFill(const NVGpaint &paint, const NVGcompositeOperationState &compositeOperation,
+                   const NVGscissor &scissor, float fringe, const NVGpath *paths, int npaths);
+    bool batchStroke(const NVGpaint &paint,
+                     const NVGcompositeOperationState &compositeOperation,
+                     const NVGscissor &scissor, float fringe, float strokeWidth,
+                     const NVGpath *paths, int npaths);
+    bool findPaletteRow(const NVGcolor &color, size_t &paletteIndex, int &row);
+    // Hands the pending batch to the backend.
+    void flushBatch();
+    void resetPalettes();
+    void releasePalettes();
+
+    static void flushHook(void *uptr);
+    static void cancelHook(void *uptr);
+
+    static int createTextureHook(void *uptr, int type, int w, int h, int imageFlags,
+                                 const unsigned char *data);
+    static int updateTextureHook(void *uptr, int image, int x, int y, int w, int h,
+                                 const unsigned char *data);
+    static void fillHook(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                         NVGscissor *scissor, float fringe, const float *bounds,
+                         const NVGpath *paths, int npaths);
+    static void strokeHook(void *uptr, NVGpaint *paint,
+                           NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                           float fringe, float strokeWidth, const NVGpath *paths, int npaths);
+    static void trianglesHook(void *uptr, NVGpaint *paint,
+                              NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                              const NVGvertex *verts, int nverts, float fringe);
+  };
+
+  struct GlyphPrewarm {
+    int font;
+    float size;
+    std::string text;
+  };
+
+  std::unique_ptr<BackendMonitor> mBackendMonitor;
+  FrameStats mFrameStats;
+  FrameStatsHistory mFrameStatsHistory;
+  std::vector<GlyphPrewarm> mGlyphPrewarms;
+
+  void prewarmGlyphsNow();
 
   void path2dSegment(Path2d::SegmentType, const vec2 *p1, const vec2 *p2, const vec2 *p3);
 
+  static void resetState(State &state);
+  void appendCommands(float *vals, size_t count);
+  // Looks up or builds the cached tessellation of the current path, and copies it into result
+  // with the remaining transform applied.
+  void tessellateCached(TessellationCache::Key &key, float strokeWidth, Tessellation &result);
+
+  // Returns the stroke paint and sets the stroke width in pixels. Strokes thinner than the
+  // fringe are drawn at its width and faded instead.
+  NVGpaint currentStrokePaint(float &strokeWidth) const;
+  // Returns the fill paint with the global alpha applied.
+  NVGpaint currentFillPaint() const;
+  bool isShapeAntiAliased();
+  void drawPath(bool stroke, const NVGpaint &paint, float strokeWidth);
+  // Returns the number of flattened points.
+  static size_t expandPath(Tessellator &tess, const PathDraw &draw, const float *commands,
+                           size_t count);
+  void renderPath(const PathDraw &draw, const NVGpath *paths, int numPaths, const float *bounds);
+  // Tessellates the deferred paths on the pool and hands them to the backend in order.
+  void flushDeferred();
+  // Returns the fill tessellation of commands under the canonical transform for key, from the
+  // tessellation cache for a non-zero key.path and from mInstanceTessellations otherwise. Keys
+  // outside the scale buckets are rarely drawn twice, and are tessellated without being kept.
+  const Tessellation *tessellateInstance(const float *commands, size_t count,
+                                         TessellationCache::Key &key, const float *canonical);
+  void drawInstances(const float *commands, size_t count, uint64_t pathKey,
+                     ArrayView<mat3> transforms, ArrayView<ColorAf> colors);
+  // Start adding shapes to the backend monitor's fill batch. Return false if the fill paint
+  // isn't a solid color or, for beginShapes(), if the transform isn't a similarity.
+  bool beginShapes(float &scale, float &paletteV);
+  bool beginShapeBatch(float &paletteV);
+  void endShapes(size_t count);
+  // Fills the convex outline in mShapeInner around center, with the fringe out to mShapeOuter
+  // when antialiasing.
+  void emitShape(const vec2 &center, float innerCoverage, bool flip, float &paletteV);
+  void emitRoundedRect(const vec2 &center, const vec2 &axisX, const vec2 &axisY, float ex,
+                       float ey, float radius, bool flip, float &paletteV);
+  // Appends a series, with xs null for samples at x = 0, 1, 2, ...
+  void appendSeries(const float *xs, const float *ys, size_t count, const Rectf &plotRect,
+                    const Rectf &dataBounds);
+  // Set the current path aside while the fallback draws each shape as a path of its own.
+  void stashPath();
+  void restorePath();
+
 public:
   Context(NVGcontext *ptr, Deleter deleter);
-  Context(Context&& ctx) : mPtr{ std::move(ctx.mPtr) } {}
+  Context(Context &&ctx);
 
   // NOTE(ryan): Allow this class to be extended. Backends may want to bundle some associated data.
   // Subclasses will need to provide their own move constructor.
@@ -62,6 +288,60 @@ public:
 
   NVGpaint convert(const svg::Paint &paint);
 
+  // Recording //
+
+  // Between beginRecording() and endRecording() path, style, transform, state, scissor and text
+  // calls are captured into a DisplayList instead of being drawn. Queries like currentTransform()
+  // and textBounds() still read the context's live state.
+  void beginRecording();
+  DisplayList endRecording();
+  bool isRecording() const { return bool(mRecording); }
+
+  // Draws a recorded list with transform applied on top of the current transform. The list is
+  // replayed through this context, so its paths use the tessellator, the tessellation cache and
+  // the tessellation pool like direct calls, and count towards the frame stats.
+  void replay(const DisplayList &list, const mat3 &transform = mat3(1));
+  // Replays a command buffer built on another thread at the current transform. Buffers are drawn
+  // in the order they are submitted. The buffer is cleared but keeps its memory, so it can be
+  // refilled next frame.
+  void submit(CommandBuffer &&buffer);
+
+  // Tessellation Cache //
+
+  // Marks the current path as static geometry identified by a non-zero key. fill() and stroke()
+  // then reuse vertices cached for that key instead of tessellating again, as long as the
+  // transform only differs by translation, rotation or a scale within the same bucket. The mark
+  // is cleared by beginPath(). Invalidate the key in the cache when its geometry changes.
+  void cachePath(uint64_t key);
+
+  TessellationCache &getTessellationCache() { return mTessellationCache; }
+
+  // Frame Stats //
+
+  // Stats of the last frame finished by endFrame(), and of the frames before it.
+  const FrameStats &getFrameStats() const { return mFrameStats; }
+  FrameStatsHistory &getFrameStatsHistory() { return mFrameStatsHistory; }
+
+  // Batching //
+
+  // With batching on, runs of fills and strokes that the backend would draw with separate calls
+  // are merged. Convex fills with a solid color are drawn as one triangle list per run of the
+  // same blend state and scissor, with colors taken from a palette texture. Strokes with the same
+  // paint, width, blend state and scissor are drawn as one stroke call. Anything else ends the run
+  // and is drawn as is. Colors go through 8 bits per channel. With stencil strokes, overlapping
+  // parts of merged strokes are blended once. getFrameStats() counts the merges. Off by default.
+  void setBatching(bool enabled);
+  bool isBatching() const { return mBackendMonitor && mBackendMonitor->batching; }
+
+  // Parallel Tessellation //
+
+  // With a pool set, fill() and stroke() only capture the path and its state. endFrame()
+  // tessellates everything captured on the pool and hands it to the backend in draw order. Text
+  // flushes captured paths first, but drawing through get() directly is not ordered against
+  // them. Pass nullptr to tessellate on the calling thread again (default).
+  void setTessellationPool(ThreadPool *pool);
+  ThreadPool *getTessellationPool() const { return mTessellationPool; }
+
   // Frame //
 
   void beginFrame(int windowWidth, int windowHeight, float devicePixelRatio);
@@ -69,6 +349,8 @@ public:
   void cancelFrame();
   void endFrame();
 
+  float getDevicePixelRatio() const { return mDevicePixelRatio; }
+
   // Global Compositing //
 
   void globalCompositeOperation(int op);
@@ -97,6 +379,8 @@ public:
   void strokeWidth(float size);
   void lineCap(int cap);
   void lineJoin(int join);
+  void globalAlpha(float alpha);
+  void shapeAntiAlias(bool enabled);
 
   // Transform //
 
@@ -112,6 +396,10 @@ public:
   void scale(const vec2 &s);
 
   mat3 currentTransform();
+  // The part of the window inside the current scissor, as a rectangle in the current user space
+  // (its bounds if the transform rotates or skews). Anything outside it can't be seen. Before the
+  // first frame and while recording nothing is known to be hidden, and the rectangle is infinite.
+  Rectf getVisibleBounds();
 
   // Paints //
 
@@ -156,29 +444,97 @@ public:
   void circle(float cx, float cy, float r);
   void circle(const vec2 &center, float radius);
 
+  // Appends a subpath through count points (a moveTo followed by lineTos), transforming the
+  // whole batch at once.
+  void moveToLines(const vec2 *pts, size_t count, bool closed = false);
+  // Appends one subpath per entry of counts, taking consecutive runs of pts.
+  void polyLines(const vec2 *pts, const size_t *counts, size_t numLines, bool closed = false);
+  // Appends a series of samples as a subpath, with dataBounds mapped onto plotRect and y going
+  // up. Samples that fall in the same device pixel column are reduced to the first, lowest,
+  // highest and last of them, which strokes the same as every sample, so the path grows with
+  // the width of the plot rather than the number of samples. The first variant spaces ys evenly
+  // across plotRect, from minY at the bottom to maxY at the top. The second one takes xs in
+  // ascending order.
+  void timeSeries(const float *ys, size_t count, const Rectf &plotRect, float minY, float maxY);
+  void timeSeries(const float *xs, const float *ys, size_t count, const Rectf &plotRect,
+                  const Rectf &dataBounds);
+  // Appends pre-encoded geometry with the current transform applied. The second variant takes
+  // count floats in PathRef's encoding, optionally with Tessellator's WINDING commands mixed in.
+  void appendPath(const PathRef &path);
+  void appendPath(const float *commands, size_t count);
+
+  // Both draw the wrapper's current path with the wrapper's state. Style or path calls made on
+  // get() directly are not seen by them.
   void fill();
   void stroke();
+  // Strokes a streaming polyline with the current stroke style, expanding only what changed
+  // since it was last stroked. The current path is left as is. Under the identity transform the
+  // vertices go to the backend as they are. Other transforms copy them with the part outside
+  // the scale bucket applied, which is O(n) in the length of the line.
+  void stroke(StreamingPolyline &polyline);
+
+  // Instancing //
+
+  // Fills path once per transform, applied on top of the current transform, with the matching
+  // color or with the fill paint if colors is empty. The path is tessellated once per scale
+  // bucket of the tessellation cache, and every instance is a transformed copy of those vertices
+  // rather than a new path. PathRefs also keep their tessellations in the cache between frames.
+  // The current path is left as is.
+  void drawInstances(const PathRef &path, ArrayView<mat3> transforms,
+                     ArrayView<ColorAf> colors = ArrayView<ColorAf>());
+  void drawInstances(const Path2d &path, ArrayView<mat3> transforms,
+                     ArrayView<ColorAf> colors = ArrayView<ColorAf>());
+
+  // Shapes //
+
+  // Fill many shapes with the fill paint, applied on top of the current transform. Solid colors
+  // under a transform without skew or non-uniform scale skip the path pipeline: every shape is
+  // written as antialiased triangles straight into one fill batch, see setBatching(), even when
+  // batching is off. Anything else is filled one path per shape. The current path is left as is,
+  // except while recording, where the shapes are recorded as paths of their own.
+  void fillCircles(ArrayView<vec2> centers, float radius);
+  void fillCircles(ArrayView<vec2> centers, ArrayView<float> radii);
+  void fillRects(ArrayView<Rectf> rects);
+  void fillRoundedRects(ArrayView<Rectf> rects, float radius);
 
   // Cinder Types //
 
   void polyLine(const PolyLine2f &polyline);
+  void polyLines(const std::vector<PolyLine2f> &polylines);
   void path2d(const Path2d &path);
   void shape2d(const Shape2d &shape);
 
   // Cinder SVG //
 
+  // Walks the document tree on every call. For documents drawn more than once, build a
+  // CompiledSvg up front and draw that instead. Both draw on top of the current transform, and
+  // save the context's state before and restore it after.
   void draw(const svg::Doc &svg);
+  void draw(const CompiledSvg &svg);
 
   // Text //
 
   int createFont(const std::string &name, const fs::path &filepath);
   int createFont(const std::string &name, const std::string &filename);
   int findFont(const std::string &name);
+  int findFont(const char *name);
+  // Adds a face from FontRegistry::shared() that points at the registry's mapping of the file,
+  // so contexts share one copy. Returns -1 if the name isn't registered or can't be loaded.
+  // fontFace() calls this for registered names the context doesn't have yet, so faces can also
+  // be left to load on first use.
+  int createFontFromRegistry(const std::string &name);
 
   void fontSize(float size);
   void fontBlur(float blur);
   void fontFaceId(int font);
   void fontFace(const std::string &font);
+  void fontFace(const char *font);
+  void fontFace(FontHandle font);
+  int currentFontFaceId() const { return mStates.back().font; }
+  // Resolves a face name once, loading it from the FontRegistry like fontFace() if needed. The
+  // handle is invalid if the face can't be found.
+  FontHandle getFontHandle(const std::string &name);
+  FontHandle getFontHandle(const char *name);
 
   void textLetterSpacing(float spacing);
   void textLineHeight(float lineHeight);
@@ -191,12 +547,41 @@ public:
   void textBox(const vec2 &p, float breakRowWidth, const std::string &str);
   void textBox(const Rectf &rect, const std::string &str);
 
+  // Overloads for strings that aren't in a std::string, such as literals and slices of a larger
+  // buffer, so they can be drawn without a copy. A null end reads str up to its terminator.
+  float text(float x, float y, const char *str, const char *end = nullptr);
+  float text(const vec2 &p, const char *str, const char *end = nullptr);
+
+  void textBox(float x, float y, float breakRowWidth, const char *str, const char *end = nullptr);
+  void textBox(const vec2 &p, float breakRowWidth, const char *str, const char *end = nullptr);
+  void textBox(const Rectf &rect, const char *str, const char *end = nullptr);
+
+  // Queues glyphs of a font to be rasterized into the atlas at the start of the next frame, so
+  // screens that show new sizes don't stall or reset the atlas mid-frame. Ranges are inclusive
+  // codepoint ranges, and sizes are in pixels at an identity transform.
+  void prewarmGlyphs(FontHandle font, const std::vector<float> &sizes,
+                     const std::vector<std::pair<uint32_t, uint32_t>> &codepointRanges);
+  const GlyphAtlasStats &getGlyphAtlasStats() const;
+
+  // Draws a prebuilt layout with its origin at p. The layout's font and style are used instead
+  // of the current ones.
+  void text(const TextLayout &layout, const vec2 &p);
+
   Rectf textBounds(float x, float y, const std::string &str);
   Rectf textBounds(const vec2 &p, const std::string &str);
 
   Rectf textBoxBounds(float x, float y, float breakRowWidth, const std::string &str);
   Rectf textBoxBounds(const vec2 &p, float breakRowWidth, const std::string &str);
   Rectf textBoxBounds(const Rectf &rect, const std::string &str);
+
+  Rectf textBounds(float x, float y, const char *str, const char *end = nullptr);
+  Rectf textBounds(const vec2 &p, const char *str, const char *end = nullptr);
+
+  Rectf textBoxBounds(float x, float y, float breakRowWidth, const char *str,
+                      const char *end = nullptr);
+  Rectf textBoxBounds(const vec2 &p, float breakRowWidth, const char *str,
+                      const char *end = nullptr);
+  Rectf textBoxBounds(const Rectf &rect, const char *str, const char *end = nullptr);
 };
 
 }} // cinder::nvg
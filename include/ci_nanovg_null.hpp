@@ -0,0 +1,12 @@
+#pragma once
+
+#include "ci_nanovg.hpp"
+
+namespace cinder { namespace nvg {
+
+// A context whose backend draws nothing. Textures are tracked by size only, so fonts and images
+// work, but every fill, stroke and triangle call is dropped. Useful for measuring the wrapper and
+// nanovg on their own, and for replaying traces without a GPU.
+Context createContextNull(bool antiAlias = true);
+
+}} // cinder::nvg
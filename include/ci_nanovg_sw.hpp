@@ -0,0 +1,36 @@
+#pragma once
+
+#include "cinder/Surface.h"
+#include "ci_nanovg.hpp"
+
+namespace cinder { namespace nvg {
+
+class RendererSW;
+
+// A context that rasterizes on the CPU instead of through OpenGL. Draw calls are queued while the
+// frame is built and rasterized into the target surface by endFrame(), with the frame split into
+// screen tiles that are processed in parallel. The output matches the GL backend's, including its
+// anti-aliasing, and like a GL framebuffer the target holds premultiplied colors.
+class ContextSW : public Context {
+  RendererSW *mRenderer;
+
+public:
+  ContextSW(NVGcontext *ptr, Deleter deleter, RendererSW *renderer)
+  : Context(ptr, deleter), mRenderer{ renderer } {}
+
+  // Frames are rasterized into this surface. Its size should be the window size passed to
+  // beginFrame times the device pixel ratio. Only one target is active at a time.
+  void setTarget(const Surface8uRef &surface);
+  void setTarget(const Surface32fRef &surface);
+
+  // Fills the whole target with a color, like glClear.
+  void clear(const ColorAf &color = ColorAf::zero());
+
+  Image createImage(const Surface8u &surface, int imageFlags = 0);
+};
+
+// A thread count of 0 rasterizes with one thread per hardware core.
+ContextSW createContextSW(bool antiAlias = true, bool stencilStrokes = false,
+                          size_t numThreads = 0);
+
+}} // cinder::nvg
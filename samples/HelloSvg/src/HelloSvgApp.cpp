@@ -13,7 +13,9 @@ using namespace std;
 
 class HelloSvgApp : public App {
   shared_ptr<nvg::Context> mNanoVG;
+  nvg::FontHandle mFont;
   svg::DocRef mDoc;
+  nvg::PreparedSvg mPreparedDoc;
 
 public:
   void setup();
@@ -24,8 +26,11 @@ public:
 void HelloSvgApp::setup() {
   // Create a NanoVG context without anti-aliasing.
   mNanoVG = make_shared<nvg::Context>(nvg::createContextGL(false));
-  mNanoVG->createFont("Roboto", getAssetPath("Roboto-Regular.ttf"));
+  mFont = mNanoVG->createFont("Roboto", getAssetPath("Roboto-Regular.ttf"));
   mDoc = svg::Doc::create(loadAsset("rainbow_dash.svg"));
+  // Flatten the document once instead of walking its tree every frame. This happens on a worker
+  // thread, and the document is drawn once it's ready.
+  mPreparedDoc = nvg::prepareSvgAsync(mDoc);
 }
 
 void HelloSvgApp::update() {
@@ -39,8 +44,10 @@ void HelloSvgApp::draw() {
   mNanoVG->translate(getWindowCenter());
   mNanoVG->scale(vec2(0.75f * float(getWindowHeight()) / float(mDoc->getHeight())));
   mNanoVG->translate(-mDoc->getBounds().getCenter());
-  mNanoVG->fontFace("Roboto");
-  mNanoVG->draw(*mDoc);
+  mNanoVG->fontFace(mFont);
+  if (auto compiledDoc = mPreparedDoc.get()) {
+    mNanoVG->draw(*compiledDoc);
+  }
   mNanoVG->endFrame();
 }
 
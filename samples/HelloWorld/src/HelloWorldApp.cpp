@@ -19,6 +19,7 @@ public:
 
 private:
   std::shared_ptr<nvg::Context> mNanoVG;
+  nvg::FontHandle mFont;
   PolyLine2f mTriangle;
 };
 
@@ -28,9 +29,11 @@ void HelloWorldApp::setup() {
   // to either store this value or create a unique/shared_ptr. A unique_ptr
   // would be more appropriate here, but we're using make_shared for brevity.
   mNanoVG = std::make_shared<nvg::Context>(nvg::createContextGL());
+  // Merge the hue wheel's 64 fills into a single draw call.
+  mNanoVG->setBatching(true);
 
-  // Load a font
-  mNanoVG->createFont("roboto", getAssetPath("Roboto-Regular.ttf").string());
+  // Load a font. Keeping the handle lets draw() select it without looking up its name.
+  mFont = mNanoVG->createFont("roboto", getAssetPath("Roboto-Regular.ttf").string());
 
   // Create triangle PolyLine
   int numPts = 3;
@@ -106,7 +109,7 @@ void HelloWorldApp::draw() {
 
   // Draw Text
   vg.fontSize(50);
-  vg.fontFace("roboto");
+  vg.fontFace(mFont);
   vg.textAlign(NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
   vg.textLetterSpacing(-4.0);
   vg.fillColor(ColorAf{0.0f, 0.0f, 0.0f});
@@ -21,10 +21,8 @@ struct WindowData {
   : ctx{ make_shared<nvg::Context>(nvg::createContextGL()) },
     id{ id }
   {
-    // Load a font.
-    ctx->createFont("roboto", getAssetPath("Roboto-Regular.ttf").string());
-
-    // Create some geometry to draw.
+    // Create some geometry to draw. The font is registered once in setup(), and each window's
+    // context picks up the shared mapping of it the first time it draws text.
     int numVerts = Rand::randInt(8);
     float scale = 100;
     for (int i = 0; i < numVerts; ++i) {
@@ -45,6 +43,8 @@ public:
 };
 
 void MultiWindowApp::setup() {
+  nvg::FontRegistry::shared().registerFont("roboto", getAssetPath("Roboto-Regular.ttf"));
+
   getWindow()->setUserData(new WindowData(getNumWindows()));
   spawnWindow();
 }
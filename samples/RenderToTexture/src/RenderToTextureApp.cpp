@@ -23,6 +23,7 @@ class Shape {
   Path2d mPath;
   Colorf mColor;
   vec2 mPosition;
+  nvg::DisplayList mDisplayList;
 
 public:
   Shape(Path2d path, vec2 position) : mPath{ move(path) },
@@ -30,11 +31,18 @@ public:
     mColor{ randColor() } {
   }
 
-  void draw(nvg::Context& vg) const {
+  // The shape never changes, so its drawing commands are recorded once and replayed each frame.
+  void record(nvg::Context& vg) {
+    vg.beginRecording();
     vg.beginPath();
     vg.path2d(mPath);
     vg.fillColor(mColor);
     vg.fill();
+    mDisplayList = vg.endRecording();
+  }
+
+  void draw(nvg::Context& vg) const {
+    vg.replay(mDisplayList);
   }
 
   vec2 getPosition() {
@@ -124,7 +132,9 @@ void RenderToTextureApp::generateShapes() {
     auto path = generatePath(radius, numPoints);
     auto position = vec2{randFloat(), randFloat()} * vec2{getWindowSize()};
 
-    return make_shared<Shape>(path, position);
+    auto shape = make_shared<Shape>(path, position);
+    shape->record(*mCtx);
+    return shape;
   });
 
   // Generate texture proxies for each shape.
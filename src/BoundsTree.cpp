@@ -0,0 +1,104 @@
+#include "BoundsTree.hpp"
+
+#include <algorithm>
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+const uint32_t kLeafSize = 4;
+
+bool overlaps(const Rectf &a, const Rectf &b) {
+  return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+} // anon
+
+BoundsTree::BoundsTree(const std::vector<Rectf> &bounds) : mItems(bounds.size()) {
+  if (bounds.empty()) return;
+
+  for (uint32_t i = 0; i < mItems.size(); ++i) {
+    mItems[i] = i;
+  }
+  mNodes.reserve(bounds.size());
+  mNodes.resize(1);
+  build(bounds, 0, 0, uint32_t(bounds.size()));
+
+  mItemBounds.resize(mItems.size());
+  for (size_t i = 0; i < mItems.size(); ++i) {
+    mItemBounds[i] = bounds[mItems[i]];
+  }
+}
+
+// Fills in node index from items [begin, end). Children are added in pairs after it.
+void BoundsTree::build(const std::vector<Rectf> &bounds, uint32_t index, uint32_t begin,
+                       uint32_t end) {
+  Rectf box = bounds[mItems[begin]];
+  for (uint32_t i = begin + 1; i < end; ++i) {
+    const Rectf &b = bounds[mItems[i]];
+    box.x1 = std::min(box.x1, b.x1);
+    box.y1 = std::min(box.y1, b.y1);
+    box.x2 = std::max(box.x2, b.x2);
+    box.y2 = std::max(box.y2, b.y2);
+  }
+  mNodes[index].bounds = box;
+
+  if (end - begin <= kLeafSize) {
+    mNodes[index].first = begin;
+    mNodes[index].count = end - begin;
+    return;
+  }
+
+  bool splitX = box.x2 - box.x1 >= box.y2 - box.y1;
+  uint32_t mid = begin + (end - begin) / 2;
+  std::nth_element(mItems.begin() + begin, mItems.begin() + mid, mItems.begin() + end,
+                   [&](uint32_t a, uint32_t b) {
+                     const Rectf &ra = bounds[a], &rb = bounds[b];
+                     return splitX ? ra.x1 + ra.x2 < rb.x1 + rb.x2 : ra.y1 + ra.y2 < rb.y1 + rb.y2;
+                   });
+
+  uint32_t left = uint32_t(mNodes.size());
+  mNodes[index].first = left;
+  mNodes[index].count = 0;
+  mNodes.resize(mNodes.size() + 2);
+  build(bounds, left, begin, mid);
+  build(bounds, left + 1, mid, end);
+}
+
+BoundsTree BoundsTree::wrap(ArrayView<Node> nodes, ArrayView<uint32_t> items,
+                            ArrayView<Rectf> itemBounds) {
+  BoundsTree tree;
+  tree.mNodeData = nodes;
+  tree.mItemData = items;
+  tree.mItemBoundsData = itemBounds;
+  tree.mWrapped = true;
+  return tree;
+}
+
+void BoundsTree::query(const Rectf &rect, std::vector<uint32_t> &result) const {
+  auto nodes = getNodes();
+  auto items = getItems();
+  auto itemBounds = getItemBounds();
+  if (nodes.empty()) return;
+
+  // Median splits keep the depth under 32 for any item count that fits in a uint32_t.
+  uint32_t stack[64];
+  size_t size = 0;
+  stack[size++] = 0;
+
+  while (size) {
+    const Node &node = nodes[stack[--size]];
+    if (!overlaps(node.bounds, rect)) continue;
+
+    if (node.count) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        if (overlaps(itemBounds[i], rect)) result.push_back(items[i]);
+      }
+    } else {
+      stack[size++] = node.first;
+      stack[size++] = node.first + 1;
+    }
+  }
+}
+
+}} // cinder::nvg
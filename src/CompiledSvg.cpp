@@ -0,0 +1,986 @@
+#include "CompiledSvg.hpp"
+#include "ci_nanovg.hpp"
+#include "SvgRenderer.hpp"
+
+#include "cinder/svg/Svg.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+// Grows bounds to hold the corners of rect under transform m.
+void includeTransformed(Rectf &bounds, const Rectf &rect, const mat3 &m) {
+  const vec2 corners[4] = { vec2(rect.x1, rect.y1), vec2(rect.x2, rect.y1),
+                            vec2(rect.x2, rect.y2), vec2(rect.x1, rect.y2) };
+  for (auto &corner : corners) {
+    vec3 p = m * vec3(corner, 1.0f);
+    bounds.x1 = std::min(bounds.x1, p.x);
+    bounds.y1 = std::min(bounds.y1, p.y);
+    bounds.x2 = std::max(bounds.x2, p.x);
+    bounds.y2 = std::max(bounds.y2, p.y);
+  }
+}
+
+// Scale of the 2x2 part of m, as the square root of its area scale.
+float transformScale(const mat3 &m) {
+  return std::sqrt(std::abs(m[0][0] * m[1][1] - m[0][1] * m[1][0]));
+}
+
+float distanceToSegment(const vec2 &p, const vec2 &a, const vec2 &b) {
+  vec2 ab = b - a, ap = p - a;
+  float len2 = ab.x * ab.x + ab.y * ab.y;
+  float t = len2 > 0.0f ? std::max(0.0f, std::min(1.0f, (ap.x * ab.x + ap.y * ab.y) / len2)) : 0.0f;
+  vec2 d = ap - ab * t;
+  return std::sqrt(d.x * d.x + d.y * d.y);
+}
+
+// Appends the polyline run to out as LINETOs, dropping the points within tolerance of the line
+// between their neighbours (Ramer-Douglas-Peucker). The first point is the current pen position,
+// which has already been written.
+void simplifyRun(const std::vector<vec2> &run, float tolerance, std::vector<bool> &keep,
+                 std::vector<std::pair<size_t, size_t>> &stack, std::vector<float> &out) {
+  if (run.size() < 2) return;
+  keep.assign(run.size(), false);
+  keep.front() = keep.back() = true;
+
+  stack.clear();
+  stack.emplace_back(0, run.size() - 1);
+  while (!stack.empty()) {
+    size_t a = stack.back().first, b = stack.back().second;
+    stack.pop_back();
+    float maxDist = 0.0f;
+    size_t split = a;
+    for (size_t i = a + 1; i < b; ++i) {
+      float d = distanceToSegment(run[i], run[a], run[b]);
+      if (d > maxDist) {
+        maxDist = d;
+        split = i;
+      }
+    }
+    if (maxDist > tolerance) {
+      keep[split] = true;
+      stack.emplace_back(a, split);
+      stack.emplace_back(split, b);
+    }
+  }
+
+  for (size_t i = 1; i < run.size(); ++i) {
+    if (!keep[i]) continue;
+    out.push_back(float(CompiledSvg::LINETO));
+    out.push_back(run[i].x);
+    out.push_back(run[i].y);
+  }
+}
+
+// Appends the commands in [c, end) to out, with curves that stay within tolerance of their chord
+// turned into lines and runs of lines simplified.
+void simplifyCommands(const float *c, const float *end, float tolerance, std::vector<vec2> &run,
+                      std::vector<bool> &keep, std::vector<std::pair<size_t, size_t>> &stack,
+                      std::vector<float> &out) {
+  run.clear();
+  vec2 pen(0.0f);
+  while (c < end) {
+    switch (int(c[0])) {
+      case CompiledSvg::MOVETO:
+        simplifyRun(run, tolerance, keep, stack, out);
+        run.clear();
+        out.insert(out.end(), c, c + 3);
+        pen = vec2(c[1], c[2]);
+        c += 3;
+        break;
+      case CompiledSvg::LINETO:
+        if (run.empty()) run.push_back(pen);
+        pen = vec2(c[1], c[2]);
+        run.push_back(pen);
+        c += 3;
+        break;
+      case CompiledSvg::BEZIERTO: {
+        vec2 p(c[5], c[6]);
+        if (distanceToSegment(vec2(c[1], c[2]), pen, p) <= tolerance &&
+            distanceToSegment(vec2(c[3], c[4]), pen, p) <= tolerance) {
+          if (run.empty()) run.push_back(pen);
+          run.push_back(p);
+        } else {
+          simplifyRun(run, tolerance, keep, stack, out);
+          run.clear();
+          out.insert(out.end(), c, c + 7);
+        }
+        pen = p;
+        c += 7;
+        break;
+      }
+      case CompiledSvg::CLOSE:
+      default:
+        simplifyRun(run, tolerance, keep, stack, out);
+        run.clear();
+        out.push_back(c[0]);
+        c += 1;
+        break;
+    }
+  }
+  simplifyRun(run, tolerance, keep, stack, out);
+}
+
+// Binary files //
+
+const uint32_t kFileMagic = 0x5347564e; // "NVGS"
+const uint32_t kFileVersion = 1;
+const uint64_t kFileAlignment = 16;
+
+enum FileSectionType {
+  ELEMENTS,
+  COMMANDS,
+  TRANSFORMS,
+  PAINTS,
+  ELEMENT_BOUNDS,
+  TREE_NODES,
+  TREE_ITEMS,
+  TREE_ITEM_BOUNDS,
+  TEXT,
+  NUM_SECTIONS
+};
+
+// Sections hold count values of their array's type, starting at an offset that is a multiple of
+// kFileAlignment. The text section is a list of words, see encodeTextSpans().
+struct FileSection {
+  uint64_t offset, count;
+};
+
+struct FileHeader {
+  uint32_t magic, version;
+  // Sizes of the stored structs, to reject files from builds with another layout.
+  uint32_t elementSize, paintSize, nodeSize;
+  uint32_t numTextSpans;
+  float bounds[4];
+  FileSection sections[NUM_SECTIONS];
+};
+
+void appendString(std::vector<uint32_t> &words, const std::string &str) {
+  words.push_back(uint32_t(str.size()));
+  size_t pos = words.size();
+  words.resize(pos + (str.size() + 3) / 4, 0);
+  if (!str.empty()) std::memcpy(&words[pos], str.data(), str.size());
+}
+
+// Each span is its pen, rotation and font size as floats, followed by its string and its number
+// of font families and their names. Strings are a byte count and the bytes, padded to a word.
+std::vector<uint32_t> encodeTextSpans(const std::vector<CompiledSvg::TextSpan> &spans) {
+  std::vector<uint32_t> words;
+  for (const auto &span : spans) {
+    float values[4] = { span.pen.x, span.pen.y, span.rotation, span.fontSize };
+    size_t pos = words.size();
+    words.resize(pos + 4);
+    std::memcpy(&words[pos], values, sizeof(values));
+    appendString(words, span.str);
+    words.push_back(uint32_t(span.fontFamilies.size()));
+    for (const auto &family : span.fontFamilies) appendString(words, family);
+  }
+  return words;
+}
+
+bool readString(ArrayView<uint32_t> words, size_t &pos, std::string &str) {
+  if (pos >= words.size()) return false;
+  size_t size = words[pos++];
+  size_t numWords = (size + 3) / 4;
+  if (numWords > words.size() - pos) return false;
+  str.assign(reinterpret_cast<const char *>(words.data() + pos), size);
+  pos += numWords;
+  return true;
+}
+
+bool decodeTextSpans(ArrayView<uint32_t> words, size_t numSpans,
+                     std::vector<CompiledSvg::TextSpan> &spans) {
+  // Every span takes at least 6 words and every family 1, so corrupt counts fail before they
+  // allocate.
+  if (numSpans > words.size() / 6) return false;
+  spans.resize(numSpans);
+  size_t pos = 0;
+  for (auto &span : spans) {
+    if (words.size() - pos < 4) return false;
+    float values[4];
+    std::memcpy(values, words.data() + pos, sizeof(values));
+    pos += 4;
+    span.pen = vec2(values[0], values[1]);
+    span.rotation = values[2];
+    span.fontSize = values[3];
+    if (!readString(words, pos, span.str) || pos >= words.size()) return false;
+    size_t numFamilies = words[pos++];
+    if (numFamilies > words.size() - pos) return false;
+    span.fontFamilies.resize(numFamilies);
+    for (auto &family : span.fontFamilies) {
+      if (!readString(words, pos, family)) return false;
+    }
+  }
+  return pos == words.size();
+}
+
+template <typename T>
+bool mapSection(const FontRegistry::Blob &blob, const FileSection &section, ArrayView<T> &view) {
+  size_t size = blob.getSize();
+  if (section.offset % std::alignment_of<T>::value || section.offset > size ||
+      section.count > (size - section.offset) / sizeof(T)) {
+    return false;
+  }
+  view = ArrayView<T>(reinterpret_cast<const T *>(blob.getData() + section.offset),
+                      size_t(section.count));
+  return true;
+}
+
+} // anon
+
+// Walks the document once with the same state stacks as SvgRenderer, but instead of drawing it
+// appends flattened elements to a CompiledSvg.
+class SvgCompiler : public svg::Renderer {
+  CompiledSvg &mSvg;
+
+  std::vector<mat3> mMatrixStack;
+  int32_t mTransformIndex = -1;
+
+  std::vector<svg::Paint> mFillStack, mStrokeStack;
+  std::vector<float> mFillOpacityStack, mStrokeOpacityStack, mGroupOpacityStack;
+  std::vector<float> mStrokeWidthStack;
+  std::vector<int> mLineJoinStack, mLineCapStack;
+
+  std::vector<vec2> mTextPenStack;
+  std::vector<float> mTextRotationStack;
+
+  uint32_t currentTransform();
+  int32_t addPaint(const svg::Paint &paint, float opacity);
+
+  void beginShape();
+  void endShape();
+
+  void moveTo(const vec2 &p);
+  void lineTo(const vec2 &p);
+  void bezierTo(const vec2 &c1, const vec2 &c2, const vec2 &p);
+  void closePath();
+  void polyLine(const PolyLine2f &polyline);
+  void path2d(const Path2d &path);
+
+public:
+  SvgCompiler(CompiledSvg &svg);
+
+  void pushGroup(const svg::Group &group, float opacity) override;
+  void popGroup() override;
+
+  void drawPath(const svg::Path &path) override;
+  void drawPolyline(const svg::Polyline &polyline) override;
+  void drawPolygon(const svg::Polygon &polygon) override;
+  void drawLine(const svg::Line &line) override;
+  void drawRect(const svg::Rect &rect) override;
+  void drawCircle(const svg::Circle &circle) override;
+  void drawEllipse(const svg::Ellipse &ellipse) override;
+  void drawImage(const svg::Image &image) override {}
+  void drawTextSpan(const svg::TextSpan &span) override;
+
+  void pushMatrix(const mat3 &m) override;
+  void popMatrix() override;
+  void pushStyle(const svg::Style &style) override {};
+  void popStyle() override {};
+  void pushFill(const class svg::Paint &paint) override;
+  void popFill() override;
+  void pushStroke(const class svg::Paint &paint) override;
+  void popStroke() override;
+  void pushFillOpacity(float opacity) override;
+  void popFillOpacity() override;
+  void pushStrokeOpacity(float opacity) override;
+  void popStrokeOpacity() override;
+  void pushStrokeWidth(float width) override;
+  void popStrokeWidth() override;
+  void pushFillRule(svg::FillRule rule) override {}
+  void popFillRule() override {}
+  void pushLineCap(svg::LineCap lineCap) override;
+  void popLineCap() override;
+  void pushLineJoin(svg::LineJoin lineJoin) override;
+  void popLineJoin() override;
+
+  void pushTextPen(const vec2 &penPos) override;
+  void popTextPen() override;
+  void pushTextRotation(float rotation) override;
+  void popTextRotation() override;
+};
+
+SvgCompiler::SvgCompiler(CompiledSvg &svg) : mSvg{ svg } {
+  mMatrixStack.emplace_back(1);
+
+  mFillStack.push_back(svg::Paint(Color::black()));
+  mStrokeStack.push_back(svg::Paint());
+
+  mFillOpacityStack.push_back(1.0f);
+  mStrokeOpacityStack.push_back(1.0f);
+  mGroupOpacityStack.push_back(1.0f);
+  mStrokeWidthStack.push_back(1.0f);
+
+  pushLineCap(svg::LINE_CAP_BUTT);
+  pushLineJoin(svg::LINE_JOIN_MITER);
+
+  mTextPenStack.push_back(vec2());
+  mTextRotationStack.push_back(0.0f);
+}
+
+// Transforms are only added to the table when something is drawn with them, and runs of elements
+// under the same matrix share one entry.
+uint32_t SvgCompiler::currentTransform() {
+  if (mTransformIndex < 0) {
+    mTransformIndex = int32_t(mSvg.mTransforms.size());
+    mSvg.mTransforms.push_back(mMatrixStack.back());
+  }
+  return uint32_t(mTransformIndex);
+}
+
+int32_t SvgCompiler::addPaint(const svg::Paint &paint, float opacity) {
+  if (paint.isNone()) return -1;
+
+  NVGpaint nvgPaint;
+  if (!convertPaint(paint, opacity * mGroupOpacityStack.back(), nvgPaint)) return -1;
+  mSvg.mPaints.push_back(nvgPaint);
+  return int32_t(mSvg.mPaints.size() - 1);
+}
+
+void SvgCompiler::beginShape() {
+  CompiledSvg::Element el;
+  el.type = CompiledSvg::Element::SHAPE;
+  el.lineCap = uint8_t(mLineCapStack.back());
+  el.lineJoin = uint8_t(mLineJoinStack.back());
+  el.transform = currentTransform();
+  el.begin = el.end = uint32_t(mSvg.mCommands.size());
+  el.fill = addPaint(mFillStack.back(), mFillOpacityStack.back());
+  el.stroke = addPaint(mStrokeStack.back(), mStrokeOpacityStack.back());
+  el.strokeWidth = mStrokeWidthStack.back();
+  mSvg.mElements.push_back(el);
+}
+
+void SvgCompiler::endShape() {
+  auto &el = mSvg.mElements.back();
+  el.end = uint32_t(mSvg.mCommands.size());
+
+  // Shapes that are neither filled nor stroked are dropped along with their commands.
+  if (el.fill < 0 && el.stroke < 0) {
+    mSvg.mCommands.resize(el.begin);
+    mSvg.mElements.pop_back();
+  }
+}
+
+void SvgCompiler::moveTo(const vec2 &p) {
+  const float cmd[] = { float(CompiledSvg::MOVETO), p.x, p.y };
+  mSvg.mCommands.insert(mSvg.mCommands.end(), cmd, cmd + 3);
+}
+void SvgCompiler::lineTo(const vec2 &p) {
+  const float cmd[] = { float(CompiledSvg::LINETO), p.x, p.y };
+  mSvg.mCommands.insert(mSvg.mCommands.end(), cmd, cmd + 3);
+}
+void SvgCompiler::bezierTo(const vec2 &c1, const vec2 &c2, const vec2 &p) {
+  const float cmd[] = { float(CompiledSvg::BEZIERTO), c1.x, c1.y, c2.x, c2.y, p.x, p.y };
+  mSvg.mCommands.insert(mSvg.mCommands.end(), cmd, cmd + 7);
+}
+void SvgCompiler::closePath() {
+  mSvg.mCommands.push_back(float(CompiledSvg::CLOSE));
+}
+
+void SvgCompiler::polyLine(const PolyLine2f &polyline) {
+  auto &pts = polyline.getPoints();
+  if (pts.size() >= 2) {
+    moveTo(pts[0]);
+    for (auto i = begin(pts) + 1; i != end(pts); ++i) {
+      lineTo(*i);
+    }
+    if (polyline.isClosed()) closePath();
+  }
+}
+
+void SvgCompiler::path2d(const Path2d &path) {
+  const vec2 *prev = &path.getPoint(0);
+  moveTo(*prev);
+
+  size_t i = 1;
+  for (auto &seg : path.getSegments()) {
+    switch (seg) {
+      case Path2d::MOVETO:
+        prev = &path.getPoint(i++);
+        moveTo(*prev);
+        break;
+      case Path2d::LINETO:
+        prev = &path.getPoint(i++);
+        lineTo(*prev);
+        break;
+      case Path2d::QUADTO: {
+        // Raise quadratics to cubics here, as nvgQuadTo would on every draw.
+        const vec2 &c = path.getPoint(i), &p = path.getPoint(i + 1);
+        bezierTo(*prev + 2.0f / 3.0f * (c - *prev), p + 2.0f / 3.0f * (c - p), p);
+        prev = &p;
+        i += 2;
+        break;
+      }
+      case Path2d::CUBICTO:
+        bezierTo(path.getPoint(i), path.getPoint(i + 1), path.getPoint(i + 2));
+        prev = &path.getPoint(i + 2);
+        i += 3;
+        break;
+      case Path2d::CLOSE:
+        prev = &path.getPoint(0);
+        lineTo(*prev);
+        break;
+    }
+  }
+}
+
+
+void SvgCompiler::pushGroup(const svg::Group &group, float opacity) {
+  // NOTE: NanoVG has no layers, so group opacity is folded into the paints of each child. This
+  // differs from SVG where children overlap.
+  mGroupOpacityStack.push_back(mGroupOpacityStack.back() * opacity);
+}
+void SvgCompiler::popGroup() {
+  mGroupOpacityStack.pop_back();
+}
+
+void SvgCompiler::drawPath(const svg::Path &path) {
+  beginShape();
+  for (auto &contour : path.getShape2d().getContours()) {
+    path2d(contour);
+  }
+  endShape();
+}
+
+void SvgCompiler::drawPolyline(const svg::Polyline &polyline) {
+  beginShape();
+  polyLine(polyline.getPolyLine());
+  endShape();
+}
+
+void SvgCompiler::drawPolygon(const svg::Polygon &polygon) {
+  beginShape();
+  polyLine(polygon.getPolyLine());
+  endShape();
+}
+
+void SvgCompiler::drawLine(const svg::Line &line) {
+  beginShape();
+  moveTo(line.getPoint1());
+  lineTo(line.getPoint2());
+  endShape();
+}
+
+// Rects, circles and ellipses are emitted with the same points and winding as nvgRect and
+// nvgEllipse.
+
+void SvgCompiler::drawRect(const svg::Rect &rect) {
+  const auto &r = rect.getRect();
+  beginShape();
+  moveTo(r.getUpperLeft());
+  lineTo(r.getLowerLeft());
+  lineTo(r.getLowerRight());
+  lineTo(r.getUpperRight());
+  closePath();
+  endShape();
+}
+
+void SvgCompiler::drawCircle(const svg::Circle &circle) {
+  const auto &c = circle.getCenter();
+  float r = circle.getRadius();
+  const float k = 0.5522847493f * r;
+
+  beginShape();
+  moveTo(vec2(c.x - r, c.y));
+  bezierTo(vec2(c.x - r, c.y + k), vec2(c.x - k, c.y + r), vec2(c.x, c.y + r));
+  bezierTo(vec2(c.x + k, c.y + r), vec2(c.x + r, c.y + k), vec2(c.x + r, c.y));
+  bezierTo(vec2(c.x + r, c.y - k), vec2(c.x + k, c.y - r), vec2(c.x, c.y - r));
+  bezierTo(vec2(c.x - k, c.y - r), vec2(c.x - r, c.y - k), vec2(c.x - r, c.y));
+  closePath();
+  endShape();
+}
+
+void SvgCompiler::drawEllipse(const svg::Ellipse &ellipse) {
+  const auto &c = ellipse.getCenter();
+  float rx = ellipse.getRadiusX(), ry = ellipse.getRadiusY();
+  const float kx = 0.5522847493f * rx, ky = 0.5522847493f * ry;
+
+  beginShape();
+  moveTo(vec2(c.x - rx, c.y));
+  bezierTo(vec2(c.x - rx, c.y + ky), vec2(c.x - kx, c.y + ry), vec2(c.x, c.y + ry));
+  bezierTo(vec2(c.x + kx, c.y + ry), vec2(c.x + rx, c.y + ky), vec2(c.x + rx, c.y));
+  bezierTo(vec2(c.x + rx, c.y - ky), vec2(c.x + kx, c.y - ry), vec2(c.x, c.y - ry));
+  bezierTo(vec2(c.x - kx, c.y - ry), vec2(c.x - rx, c.y - ky), vec2(c.x - rx, c.y));
+  closePath();
+  endShape();
+}
+
+void SvgCompiler::drawTextSpan(const svg::TextSpan &span) {
+  CompiledSvg::Element el;
+  el.type = CompiledSvg::Element::TEXT;
+  el.lineCap = el.lineJoin = 0;
+  el.transform = currentTransform();
+  el.begin = uint32_t(mSvg.mTextSpans.size());
+  el.end = el.begin + 1;
+  el.stroke = -1;
+  el.strokeWidth = 0.0f;
+
+  ColorAf color = span.getFill().getColor();
+  color.a *= mGroupOpacityStack.back();
+  el.fill = int32_t(mSvg.mPaints.size());
+  mSvg.mPaints.push_back(colorPaint(toNVGcolor(color)));
+
+  CompiledSvg::TextSpan text;
+  text.str = span.getString();
+  text.fontFamilies = span.getFontFamilies();
+  text.pen = mTextPenStack.back();
+  text.rotation = toRadians(mTextRotationStack.back());
+  text.fontSize = convertFontSize(span);
+
+  mSvg.mTextSpans.push_back(std::move(text));
+  mSvg.mElements.push_back(el);
+}
+
+
+void SvgCompiler::pushMatrix(const mat3 &top) {
+  mMatrixStack.push_back(mMatrixStack.back() * top);
+  mTransformIndex = -1;
+}
+void SvgCompiler::popMatrix() {
+  mMatrixStack.pop_back();
+  mTransformIndex = -1;
+}
+
+void SvgCompiler::pushFill(const class svg::Paint &paint) {
+  mFillStack.push_back(paint);
+}
+void SvgCompiler::popFill() {
+  mFillStack.pop_back();
+}
+
+void SvgCompiler::pushStroke(const class svg::Paint &paint) {
+  mStrokeStack.push_back(paint);
+}
+void SvgCompiler::popStroke() {
+  mStrokeStack.pop_back();
+}
+
+void SvgCompiler::pushFillOpacity(float opacity) {
+  mFillOpacityStack.push_back(opacity);
+}
+void SvgCompiler::popFillOpacity() {
+  mFillOpacityStack.pop_back();
+}
+
+void SvgCompiler::pushStrokeOpacity(float opacity) {
+  mStrokeOpacityStack.push_back(opacity);
+}
+void SvgCompiler::popStrokeOpacity() {
+  mStrokeOpacityStack.pop_back();
+}
+
+void SvgCompiler::pushStrokeWidth(float width) {
+  mStrokeWidthStack.push_back(width);
+}
+void SvgCompiler::popStrokeWidth() {
+  mStrokeWidthStack.pop_back();
+}
+
+void SvgCompiler::pushLineCap(svg::LineCap lineCap) {
+  mLineCapStack.push_back(convertLineCap(lineCap));
+}
+void SvgCompiler::popLineCap() {
+  mLineCapStack.pop_back();
+}
+
+void SvgCompiler::pushLineJoin(svg::LineJoin lineJoin) {
+  mLineJoinStack.push_back(convertLineJoin(lineJoin));
+}
+void SvgCompiler::popLineJoin() {
+  mLineJoinStack.pop_back();
+}
+
+void SvgCompiler::pushTextPen(const vec2 &penPos) {
+  mTextPenStack.push_back(penPos);
+}
+void SvgCompiler::popTextPen() {
+  mTextPenStack.pop_back();
+}
+
+void SvgCompiler::pushTextRotation(float rotation) {
+  mTextRotationStack.push_back(rotation);
+}
+void SvgCompiler::popTextRotation() {
+  mTextRotationStack.pop_back();
+}
+
+
+CompiledSvg::CompiledSvg(const svg::Doc &doc) : mBounds{ doc.getBounds() } {
+  SvgCompiler compiler(*this);
+  doc.render(compiler);
+
+  mElements.shrink_to_fit();
+  mCommands.shrink_to_fit();
+  mTransforms.shrink_to_fit();
+  mPaints.shrink_to_fit();
+  mTextSpans.shrink_to_fit();
+
+  mElementBounds.reserve(mElements.size());
+  for (const auto &el : mElements) {
+    mElementBounds.push_back(calcElementBounds(el));
+  }
+  mBoundsTree = BoundsTree(mElementBounds);
+}
+
+Rectf CompiledSvg::calcElementBounds(const Element &el) const {
+  const float inf = std::numeric_limits<float>::max();
+  Rectf local(inf, inf, -inf, -inf);
+
+  if (el.type == Element::TEXT) {
+    const auto &span = mTextSpans[el.begin];
+    float em = span.fontSize;
+    Rectf box(span.pen.x - em, span.pen.y - em * 1.5f,
+              span.pen.x + em * (span.str.size() + 1), span.pen.y + em * 0.5f);
+
+    // Spans are drawn rotated about the origin.
+    mat3 rotation(1);
+    rotation[0][0] = rotation[1][1] = std::cos(span.rotation);
+    rotation[0][1] = std::sin(span.rotation);
+    rotation[1][0] = -rotation[0][1];
+    includeTransformed(local, box, rotation);
+  } else {
+    // Curves lie inside the hull of their control points.
+    for (const float *c = mCommands.data() + el.begin, *end = mCommands.data() + el.end;
+         c < end;) {
+      int numPoints = int(c[0]) == BEZIERTO ? 3 : int(c[0]) == CLOSE ? 0 : 1;
+      for (int i = 0; i < numPoints; ++i) {
+        local.x1 = std::min(local.x1, c[1 + i * 2]);
+        local.y1 = std::min(local.y1, c[2 + i * 2]);
+        local.x2 = std::max(local.x2, c[1 + i * 2]);
+        local.y2 = std::max(local.y2, c[2 + i * 2]);
+      }
+      c += 1 + numPoints * 2;
+    }
+    if (local.x1 > local.x2) return Rectf(0.0f, 0.0f, 0.0f, 0.0f);
+
+    if (el.stroke >= 0) {
+      float pad = el.strokeWidth * (el.lineJoin == NVG_MITER ? 5.0f : 0.75f);
+      local.x1 -= pad;
+      local.y1 -= pad;
+      local.x2 += pad;
+      local.y2 += pad;
+    }
+  }
+
+  Rectf bounds(inf, inf, -inf, -inf);
+  includeTransformed(bounds, local, mTransforms[el.transform]);
+  return bounds;
+}
+
+CompiledSvg CompiledSvg::load(const fs::path &path) {
+  auto file = std::make_shared<const FontRegistry::Blob>(path);
+  if (file->empty() || file->getSize() < sizeof(FileHeader)) return CompiledSvg();
+
+  FileHeader header;
+  std::memcpy(&header, file->getData(), sizeof(header));
+  if (header.magic != kFileMagic || header.version != kFileVersion ||
+      header.elementSize != sizeof(Element) || header.paintSize != sizeof(NVGpaint) ||
+      header.nodeSize != sizeof(BoundsTree::Node)) {
+    return CompiledSvg();
+  }
+
+  CompiledSvg svg;
+  ArrayView<BoundsTree::Node> nodes;
+  ArrayView<uint32_t> items, text;
+  ArrayView<Rectf> itemBounds;
+  const FileSection *sections = header.sections;
+  if (!mapSection(*file, sections[ELEMENTS], svg.mFileElements) ||
+      !mapSection(*file, sections[COMMANDS], svg.mFileCommands) ||
+      !mapSection(*file, sections[TRANSFORMS], svg.mFileTransforms) ||
+      !mapSection(*file, sections[PAINTS], svg.mFilePaints) ||
+      !mapSection(*file, sections[ELEMENT_BOUNDS], svg.mFileElementBounds) ||
+      !mapSection(*file, sections[TREE_NODES], nodes) ||
+      !mapSection(*file, sections[TREE_ITEMS], items) ||
+      !mapSection(*file, sections[TREE_ITEM_BOUNDS], itemBounds) ||
+      !mapSection(*file, sections[TEXT], text) ||
+      !decodeTextSpans(text, header.numTextSpans, svg.mTextSpans)) {
+    return CompiledSvg();
+  }
+
+  svg.mFile = file;
+  svg.mBounds = Rectf(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]);
+  svg.mBoundsTree = BoundsTree::wrap(nodes, items, itemBounds);
+  return svg.validate() ? svg : CompiledSvg();
+}
+
+bool CompiledSvg::validate() const {
+  auto elements = getElements();
+  auto commands = getCommands();
+  size_t numTransforms = getTransforms().size();
+  size_t numPaints = getPaints().size();
+
+  for (const auto &el : elements) {
+    if (el.transform >= numTransforms || el.fill < -1 || el.fill >= int64_t(numPaints) ||
+        el.stroke < -1 || el.stroke >= int64_t(numPaints)) {
+      return false;
+    }
+    if (el.type == Element::TEXT) {
+      if (el.begin >= mTextSpans.size() || el.fill < 0) return false;
+      continue;
+    }
+    if (el.type != Element::SHAPE || el.begin > el.end || el.end > commands.size()) return false;
+    for (size_t i = el.begin; i < el.end;) {
+      float cmd = commands[i];
+      if (!(cmd == MOVETO || cmd == LINETO || cmd == BEZIERTO || cmd == CLOSE)) return false;
+      size_t size = cmd == BEZIERTO ? 7 : cmd == CLOSE ? 1 : 3;
+      if (size > el.end - i) return false;
+      i += size;
+    }
+  }
+  // Compiled paints never reference images.
+  for (const auto &paint : getPaints()) {
+    if (paint.image != 0) return false;
+  }
+  if (getElementBounds().size() != elements.size()) return false;
+
+  // Children are always stored after their parents, which rules out cycles, so a node's depth is
+  // final before its children are visited. A node may be referenced more than once, and keeps its
+  // deepest path. The query stack holds at most one more node than the depth.
+  auto nodes = mBoundsTree.getNodes();
+  auto items = mBoundsTree.getItems();
+  if (mBoundsTree.getItemBounds().size() != items.size()) return false;
+  for (uint32_t item : items) {
+    if (item >= elements.size()) return false;
+  }
+  std::vector<uint8_t> depth(nodes.size(), 0);
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const auto &node = nodes[i];
+    if (node.count) {
+      if (node.first > items.size() || node.count > items.size() - node.first) return false;
+    } else {
+      if (node.first <= i || node.first >= nodes.size() - 1 || depth[i] >= 60) return false;
+      for (size_t c = node.first; c <= node.first + 1; ++c) {
+        depth[c] = std::max(depth[c], uint8_t(depth[i] + 1));
+      }
+    }
+  }
+  return true;
+}
+
+bool CompiledSvg::save(const fs::path &path) const {
+  auto nodes = mBoundsTree.getNodes();
+  auto items = mBoundsTree.getItems();
+  auto itemBounds = mBoundsTree.getItemBounds();
+  std::vector<uint32_t> text = encodeTextSpans(mTextSpans);
+
+  struct Array {
+    const void *data;
+    size_t count, size;
+  } arrays[NUM_SECTIONS] = {
+    { getElements().data(), getElements().size(), sizeof(Element) },
+    { getCommands().data(), getCommands().size(), sizeof(float) },
+    { getTransforms().data(), getTransforms().size(), sizeof(mat3) },
+    { getPaints().data(), getPaints().size(), sizeof(NVGpaint) },
+    { getElementBounds().data(), getElementBounds().size(), sizeof(Rectf) },
+    { nodes.data(), nodes.size(), sizeof(BoundsTree::Node) },
+    { items.data(), items.size(), sizeof(uint32_t) },
+    { itemBounds.data(), itemBounds.size(), sizeof(Rectf) },
+    { text.data(), text.size(), sizeof(uint32_t) },
+  };
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kFileMagic;
+  header.version = kFileVersion;
+  header.elementSize = sizeof(Element);
+  header.paintSize = sizeof(NVGpaint);
+  header.nodeSize = sizeof(BoundsTree::Node);
+  header.numTextSpans = uint32_t(mTextSpans.size());
+  header.bounds[0] = mBounds.x1;
+  header.bounds[1] = mBounds.y1;
+  header.bounds[2] = mBounds.x2;
+  header.bounds[3] = mBounds.y2;
+
+  auto align = [](uint64_t offset) {
+    return (offset + kFileAlignment - 1) / kFileAlignment * kFileAlignment;
+  };
+  uint64_t offset = align(sizeof(header));
+  for (int i = 0; i < NUM_SECTIONS; ++i) {
+    header.sections[i].offset = offset;
+    header.sections[i].count = arrays[i].count;
+    offset = align(offset + arrays[i].count * arrays[i].size);
+  }
+
+  std::ofstream file(path.string().c_str(), std::ios::binary);
+  if (!file.is_open()) return false;
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  uint64_t pos = sizeof(header);
+  const char padding[kFileAlignment] = {};
+  for (int i = 0; i < NUM_SECTIONS; ++i) {
+    file.write(padding, std::streamsize(header.sections[i].offset - pos));
+    size_t numBytes = arrays[i].count * arrays[i].size;
+    if (numBytes) file.write(static_cast<const char *>(arrays[i].data), numBytes);
+    pos = header.sections[i].offset + numBytes;
+  }
+  file.flush();
+  return bool(file);
+}
+
+void CompiledSvg::setLevelOfDetail(float minPixelSize, float tolerance) {
+  mLodMinPixelSize = std::max(0.0f, minPixelSize);
+  tolerance = std::max(0.0f, tolerance);
+  if (tolerance != mLodTolerance) mLodLevels.clear();
+  mLodTolerance = tolerance;
+}
+
+const CompiledSvg::LodLevel &CompiledSvg::getLodLevel(int level) const {
+  auto it = mLodLevels.find(level);
+  if (it != mLodLevels.end()) return it->second;
+
+  auto elements = getElements();
+  auto commands = getCommands();
+  auto transforms = getTransforms();
+
+  auto &lod = mLodLevels[level];
+  lod.commands.reserve(commands.size());
+  lod.ranges.reserve(elements.size() * 2);
+
+  // The level is used up to a scale of 2^level, so the tolerance is met at all scales it covers.
+  float tolerance = mLodTolerance / std::ldexp(1.0f, level);
+  std::vector<vec2> run;
+  std::vector<bool> keep;
+  std::vector<std::pair<size_t, size_t>> stack;
+  for (const auto &el : elements) {
+    uint32_t begin = uint32_t(lod.commands.size());
+    if (el.type == Element::SHAPE) {
+      const float *cmds = commands.data();
+      float scale = transformScale(transforms[el.transform]);
+      if (scale > 0.0f) {
+        simplifyCommands(cmds + el.begin, cmds + el.end, tolerance / scale, run, keep, stack,
+                         lod.commands);
+      } else {
+        lod.commands.insert(lod.commands.end(), cmds + el.begin, cmds + el.end);
+      }
+    }
+    lod.ranges.push_back(begin);
+    lod.ranges.push_back(uint32_t(lod.commands.size()));
+  }
+
+  // Not worth the memory if it saves little.
+  if (lod.commands.size() * 10 > commands.size() * 9) {
+    lod.commands = std::vector<float>();
+    lod.ranges = std::vector<uint32_t>();
+  } else {
+    lod.commands.shrink_to_fit();
+  }
+  return lod;
+}
+
+void CompiledSvg::resolveFonts(Context &ctx) const {
+  mFontContext = ctx.get();
+  mFonts.assign(mTextSpans.size(), FontHandle());
+  for (size_t i = 0; i < mTextSpans.size(); ++i) {
+    for (auto &family : mTextSpans[i].fontFamilies) {
+      mFonts[i] = ctx.getFontHandle(family);
+      if (mFonts[i].isValid()) break;
+    }
+  }
+}
+
+void CompiledSvg::draw(Context &ctx) const {
+  if (mFontContext != ctx.get()) resolveFonts(ctx);
+
+  ctx.save();
+
+  // Query the elements that can be seen, unless the whole document can.
+  Rectf visible = ctx.getVisibleBounds();
+  Rectf all = mBoundsTree.getBounds();
+  bool cull = visible.x1 > all.x1 || visible.y1 > all.y1 || visible.x2 < all.x2 ||
+              visible.y2 < all.y2;
+  if (cull) {
+    mVisible.clear();
+    mBoundsTree.query(visible, mVisible);
+    std::sort(mVisible.begin(), mVisible.end());
+  }
+  auto elements = getElements();
+  auto transforms = getTransforms();
+  auto paints = getPaints();
+  auto elementBounds = getElementBounds();
+  size_t count = cull ? mVisible.size() : elements.size();
+
+  // Device pixels per document unit, for the level of detail.
+  float scale = transformScale(ctx.currentTransform()) * ctx.getDevicePixelRatio();
+  const float *cmds = getCommands().data();
+  const uint32_t *ranges = nullptr;
+  if (mLodTolerance > 0.0f && scale > 0.0f) {
+    int level = int(std::ceil(std::log2(scale)));
+    const auto &lod = getLodLevel(std::max(-32, std::min(32, level)));
+    if (!lod.commands.empty()) {
+      cmds = lod.commands.data();
+      ranges = lod.ranges.data();
+    }
+  }
+
+  uint32_t transform = ~0u;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t index = cull ? mVisible[i] : i;
+    const auto &el = elements[index];
+    if (mLodMinPixelSize > 0.0f) {
+      const auto &b = elementBounds[index];
+      if (std::max(b.getWidth(), b.getHeight()) * scale < mLodMinPixelSize) continue;
+    }
+
+    // Elements are grouped in runs that share a transform, so each run is drawn inside one
+    // save / restore pair on top of the caller's transform.
+    if (el.transform != transform) {
+      if (transform != ~0u) ctx.restore();
+      ctx.save();
+      ctx.transform(transforms[el.transform]);
+      transform = el.transform;
+    }
+
+    if (el.type == Element::TEXT) {
+      const auto &span = mTextSpans[el.begin];
+      ctx.save();
+      ctx.rotate(span.rotation);
+      if (mFonts[el.begin].isValid()) ctx.fontFace(mFonts[el.begin]);
+      ctx.fontSize(span.fontSize);
+      ctx.fillPaint(paints[el.fill]);
+      ctx.textAlign(NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+      ctx.text(span.pen, span.str);
+      ctx.restore();
+      continue;
+    }
+
+    uint32_t begin = ranges ? ranges[index * 2] : el.begin;
+    uint32_t end = ranges ? ranges[index * 2 + 1] : el.end;
+    ctx.beginPath();
+    ctx.appendPath(cmds + begin, end - begin);
+
+    if (el.fill >= 0) {
+      ctx.fillPaint(paints[el.fill]);
+      ctx.fill();
+    }
+    if (el.stroke >= 0) {
+      ctx.strokePaint(paints[el.stroke]);
+      ctx.strokeWidth(el.strokeWidth);
+      ctx.lineCap(el.lineCap);
+      ctx.lineJoin(el.lineJoin);
+      ctx.stroke();
+    }
+  }
+
+  if (transform != ~0u) ctx.restore();
+  ctx.restore();
+}
+
+bool PreparedSvg::isReady() const {
+  return mFuture.valid() &&
+         mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+PreparedSvg prepareSvgAsync(svg::DocRef doc, ThreadPool &pool) {
+  auto future = pool.async([doc] { return std::make_shared<CompiledSvg>(*doc); });
+  return PreparedSvg(future.share());
+}
+
+}} // cinder::nvg
@@ -0,0 +1,630 @@
+#include "DisplayList.hpp"
+#include "ci_nanovg.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace cinder { namespace nvg {
+
+size_t DisplayList::pushString(const char *str, const char *end) {
+  // Offsets are stored as floats alongside the other arguments, which is exact up to 2^24.
+  size_t offset = mStrings.size();
+  assert(offset + (end - str) < (1u << 24));
+  mStrings.append(str, end);
+  mStrings.push_back('\0');
+  return offset;
+}
+
+float *DisplayList::pushPath(size_t count) {
+  // Run lengths are stored as floats too, so a run that would pass 2^24 starts a new one.
+  size_t size = mCommands.size();
+  bool extend = mPathRun != size_t(-1) && mPathRun + 2 + size_t(mCommands[mPathRun + 1]) == size &&
+                size_t(mCommands[mPathRun + 1]) + count < (1u << 24);
+  if (!extend) {
+    assert(count < (1u << 24));
+    mPathRun = size;
+    push(PATH, 0);
+    size += 2;
+  }
+  mCommands[mPathRun + 1] += float(count);
+  mCommands.resize(size + count);
+  return mCommands.data() + size;
+}
+
+DisplayList::DisplayList(DisplayList &&other)
+: mCommands{ std::move(other.mCommands) }, mPaints{ std::move(other.mPaints) },
+  mStrings{ std::move(other.mStrings) }, mPathRun{ other.mPathRun },
+  mPathPos{ other.mPathPos }, mHasPathPos{ other.mHasPathPos } {
+  other.clear();
+}
+
+DisplayList &DisplayList::operator=(DisplayList &&other) {
+  mCommands = std::move(other.mCommands);
+  mPaints = std::move(other.mPaints);
+  mStrings = std::move(other.mStrings);
+  mPathRun = other.mPathRun;
+  mPathPos = other.mPathPos;
+  mHasPathPos = other.mHasPathPos;
+  other.clear();
+  return *this;
+}
+
+void DisplayList::clear() {
+  mCommands.clear();
+  mPaints.clear();
+  mStrings.clear();
+  mPathRun = size_t(-1);
+  mHasPathPos = false;
+}
+
+size_t DisplayList::getNumBytes() const {
+  return mCommands.size() * sizeof(float) + mPaints.size() * sizeof(NVGpaint) + mStrings.size();
+}
+
+// PATH runs are appended to the context's path in one pass and every other call goes through
+// the context, so replays are tessellated, cached, deferred and counted in the frame stats like
+// the calls they were recorded from.
+void DisplayList::replay(Context &ctx, const mat3 &transform) const {
+  ctx.save();
+  ctx.transform(transform);
+  const mat3 base = ctx.currentTransform();
+
+  const char *strings = mStrings.data();
+  const float *c = mCommands.data(), *end = c + mCommands.size();
+
+  while (c < end) {
+    switch (int(c[0])) {
+      case BEGINPATH:
+        ctx.beginPath();
+        c += 1;
+        break;
+      case PATH: {
+        size_t count = size_t(c[1]);
+        ctx.appendPath(c + 2, count);
+        c += 2 + count;
+        break;
+      }
+      case QUADTO:
+        ctx.quadTo(c[1], c[2], c[3], c[4]);
+        c += 5;
+        break;
+      case ARCTO:
+        ctx.arcTo(c[1], c[2], c[3], c[4], c[5]);
+        c += 6;
+        break;
+      case ARC:
+        ctx.arc(c[1], c[2], c[3], c[4], c[5], int(c[6]));
+        c += 7;
+        break;
+      case RECT:
+        ctx.rect(c[1], c[2], c[3], c[4]);
+        c += 5;
+        break;
+      case ROUNDEDRECT:
+        ctx.roundedRect(c[1], c[2], c[3], c[4], c[5]);
+        c += 6;
+        break;
+      case ELLIPSE:
+        ctx.ellipse(c[1], c[2], c[3], c[4]);
+        c += 5;
+        break;
+      case CIRCLE:
+        ctx.circle(c[1], c[2], c[3]);
+        c += 4;
+        break;
+      case FILL:
+        ctx.fill();
+        c += 1;
+        break;
+      case STROKE:
+        ctx.stroke();
+        c += 1;
+        break;
+      case FILLCOLOR:
+        ctx.fillColor(nvgRGBAf(c[1], c[2], c[3], c[4]));
+        c += 5;
+        break;
+      case STROKECOLOR:
+        ctx.strokeColor(nvgRGBAf(c[1], c[2], c[3], c[4]));
+        c += 5;
+        break;
+      case FILLPAINT:
+        ctx.fillPaint(mPaints[size_t(c[1])]);
+        c += 2;
+        break;
+      case STROKEPAINT:
+        ctx.strokePaint(mPaints[size_t(c[1])]);
+        c += 2;
+        break;
+      case MITERLIMIT:
+        ctx.miterLimit(c[1]);
+        c += 2;
+        break;
+      case STROKEWIDTH:
+        ctx.strokeWidth(c[1]);
+        c += 2;
+        break;
+      case LINECAP:
+        ctx.lineCap(int(c[1]));
+        c += 2;
+        break;
+      case LINEJOIN:
+        ctx.lineJoin(int(c[1]));
+        c += 2;
+        break;
+      case COMPOSITEOPERATION:
+        ctx.globalCompositeOperation(int(c[1]));
+        c += 2;
+        break;
+      case COMPOSITEBLENDFUNC:
+        ctx.globalCompositeBlendFuncSeparate(int(c[1]), int(c[2]), int(c[3]), int(c[4]));
+        c += 5;
+        break;
+      case GLOBALALPHA:
+        ctx.globalAlpha(c[1]);
+        c += 2;
+        break;
+      case SHAPEANTIALIAS:
+        ctx.shapeAntiAlias(c[1] != 0.0f);
+        c += 2;
+        break;
+      case SAVE:
+        ctx.save();
+        c += 1;
+        break;
+      case RESTORE:
+        ctx.restore();
+        c += 1;
+        break;
+      case RESET:
+        ctx.reset();
+        ctx.setTransform(base);
+        c += 1;
+        break;
+      case RESETTRANSFORM:
+        ctx.setTransform(base);
+        c += 1;
+        break;
+      case TRANSFORM:
+        ctx.transform(mat3(c[1], c[2], 0.0f, c[3], c[4], 0.0f, c[5], c[6], 1.0f));
+        c += 7;
+        break;
+      case TRANSLATE:
+        ctx.translate(c[1], c[2]);
+        c += 3;
+        break;
+      case ROTATE:
+        ctx.rotate(c[1]);
+        c += 2;
+        break;
+      case SKEWX:
+        ctx.skewX(c[1]);
+        c += 2;
+        break;
+      case SKEWY:
+        ctx.skewY(c[1]);
+        c += 2;
+        break;
+      case SCALE:
+        ctx.scale(c[1], c[2]);
+        c += 3;
+        break;
+      case SCISSOR:
+        ctx.scissor(c[1], c[2], c[3], c[4]);
+        c += 5;
+        break;
+      case RESETSCISSOR:
+        ctx.resetScissor();
+        c += 1;
+        break;
+      case FONTSIZE:
+        ctx.fontSize(c[1]);
+        c += 2;
+        break;
+      case FONTBLUR:
+        ctx.fontBlur(c[1]);
+        c += 2;
+        break;
+      case FONTFACEID:
+        ctx.fontFaceId(int(c[1]));
+        c += 2;
+        break;
+      case FONTFACE:
+        ctx.fontFace(strings + size_t(c[1]));
+        c += 2;
+        break;
+      case LETTERSPACING:
+        ctx.textLetterSpacing(c[1]);
+        c += 2;
+        break;
+      case LINEHEIGHT:
+        ctx.textLineHeight(c[1]);
+        c += 2;
+        break;
+      case TEXTALIGN:
+        ctx.textAlign(int(c[1]));
+        c += 2;
+        break;
+      case TEXT: {
+        const char *str = strings + size_t(c[3]);
+        ctx.text(c[1], c[2], str, str + size_t(c[4]));
+        c += 5;
+        break;
+      }
+      case TEXTBOX: {
+        const char *str = strings + size_t(c[4]);
+        ctx.textBox(c[1], c[2], c[3], str, str + size_t(c[5]));
+        c += 6;
+        break;
+      }
+      default:
+        assert(false && "Corrupt display list");
+        c = end;
+        break;
+    }
+  }
+
+  ctx.restore();
+}
+
+// Global Compositing //
+
+void DisplayList::globalCompositeOperation(int op) {
+  push(COMPOSITEOPERATION, op);
+}
+void DisplayList::globalCompositeBlendFuncSeparate(int srcRGB, int dstRGB, int srcAlpha,
+                                                   int dstAlpha) {
+  push(COMPOSITEBLENDFUNC, srcRGB, dstRGB, srcAlpha, dstAlpha);
+}
+
+// State Handling //
+
+void DisplayList::save() {
+  push(SAVE);
+}
+void DisplayList::restore() {
+  push(RESTORE);
+}
+void DisplayList::reset() {
+  push(RESET);
+}
+
+// Render Styles //
+
+void DisplayList::strokeColor(const NVGcolor &color) {
+  push(STROKECOLOR, color.r, color.g, color.b, color.a);
+}
+void DisplayList::strokeColor(const ColorAf &color) {
+  push(STROKECOLOR, color.r, color.g, color.b, color.a);
+}
+void DisplayList::strokePaint(const NVGpaint &paint) {
+  push(STROKEPAINT, mPaints.size());
+  mPaints.push_back(paint);
+}
+void DisplayList::fillColor(const NVGcolor &color) {
+  push(FILLCOLOR, color.r, color.g, color.b, color.a);
+}
+void DisplayList::fillColor(const ColorAf &color) {
+  push(FILLCOLOR, color.r, color.g, color.b, color.a);
+}
+void DisplayList::fillPaint(const NVGpaint &paint) {
+  push(FILLPAINT, mPaints.size());
+  mPaints.push_back(paint);
+}
+
+void DisplayList::miterLimit(float limit) {
+  push(MITERLIMIT, limit);
+}
+void DisplayList::strokeWidth(float size) {
+  push(STROKEWIDTH, size);
+}
+void DisplayList::lineCap(int cap) {
+  push(LINECAP, cap);
+}
+void DisplayList::lineJoin(int join) {
+  push(LINEJOIN, join);
+}
+void DisplayList::globalAlpha(float alpha) {
+  push(GLOBALALPHA, alpha);
+}
+void DisplayList::shapeAntiAlias(bool enabled) {
+  push(SHAPEANTIALIAS, enabled ? 1 : 0);
+}
+
+// Transform //
+
+void DisplayList::resetTransform() {
+  push(RESETTRANSFORM);
+}
+void DisplayList::transform(const mat3 &mtx) {
+  push(TRANSFORM, mtx[0][0], mtx[0][1], mtx[1][0], mtx[1][1], mtx[2][0], mtx[2][1]);
+}
+void DisplayList::setTransform(const mat3 &mtx) {
+  resetTransform();
+  transform(mtx);
+}
+void DisplayList::translate(float x, float y) {
+  push(TRANSLATE, x, y);
+}
+void DisplayList::translate(const vec2 &translation) {
+  translate(translation.x, translation.y);
+}
+void DisplayList::rotate(float angle) {
+  push(ROTATE, angle);
+}
+void DisplayList::skewX(float angle) {
+  push(SKEWX, angle);
+}
+void DisplayList::skewY(float angle) {
+  push(SKEWY, angle);
+}
+void DisplayList::scale(float x, float y) {
+  push(SCALE, x, y);
+}
+void DisplayList::scale(const vec2 &s) {
+  scale(s.x, s.y);
+}
+
+// Scissoring //
+
+void DisplayList::scissor(float x, float y, float w, float h) {
+  push(SCISSOR, x, y, w, h);
+}
+void DisplayList::resetScissor() {
+  push(RESETSCISSOR);
+}
+
+// Paths //
+
+void DisplayList::beginPath() {
+  push(BEGINPATH);
+}
+void DisplayList::moveTo(float x, float y) {
+  const float cmd[] = { float(Tessellator::MOVETO), x, y };
+  std::copy(cmd, cmd + 3, pushPath(3));
+  mPathPos = vec2(x, y);
+  mHasPathPos = true;
+}
+void DisplayList::moveTo(const vec2 &p) {
+  moveTo(p.x, p.y);
+}
+void DisplayList::lineTo(float x, float y) {
+  const float cmd[] = { float(Tessellator::LINETO), x, y };
+  std::copy(cmd, cmd + 3, pushPath(3));
+  mPathPos = vec2(x, y);
+  mHasPathPos = true;
+}
+void DisplayList::lineTo(const vec2 &p) {
+  lineTo(p.x, p.y);
+}
+// Converted to a cubic the same way Context::quadTo does it, unless the list doesn't know where
+// the path is, in which case the context has to.
+void DisplayList::quadTo(float cx, float cy, float x, float y) {
+  if (!mHasPathPos) {
+    push(QUADTO, cx, cy, x, y);
+    mPathPos = vec2(x, y);
+    mHasPathPos = true;
+    return;
+  }
+  float x0 = mPathPos.x, y0 = mPathPos.y;
+  bezierTo(x0 + 2.0f / 3.0f * (cx - x0), y0 + 2.0f / 3.0f * (cy - y0),
+           x + 2.0f / 3.0f * (cx - x), y + 2.0f / 3.0f * (cy - y), x, y);
+}
+void DisplayList::quadTo(const vec2 &p1, const vec2 &p2) {
+  quadTo(p1.x, p1.y, p2.x, p2.y);
+}
+void DisplayList::bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+  const float cmd[] = { float(Tessellator::BEZIERTO), c1x, c1y, c2x, c2y, x, y };
+  std::copy(cmd, cmd + 7, pushPath(7));
+  mPathPos = vec2(x, y);
+  mHasPathPos = true;
+}
+void DisplayList::bezierTo(const vec2 &p1, const vec2 &p2, const vec2 &p3) {
+  bezierTo(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y);
+}
+void DisplayList::arcTo(float x1, float y1, float x2, float y2, float radius) {
+  push(ARCTO, x1, y1, x2, y2, radius);
+  mHasPathPos = false;
+}
+void DisplayList::arcTo(const vec2 &p1, const vec2 &p2, float radius) {
+  arcTo(p1.x, p1.y, p2.x, p2.y, radius);
+}
+void DisplayList::closePath() {
+  *pushPath(1) = float(Tessellator::CLOSE);
+}
+void DisplayList::pathWinding(int dir) {
+  const float cmd[] = { float(Tessellator::WINDING), float(dir) };
+  std::copy(cmd, cmd + 2, pushPath(2));
+}
+void DisplayList::arc(float cx, float cy, float r, float a0, float a1, int dir) {
+  push(ARC, cx, cy, r, a0, a1, dir);
+  mHasPathPos = false;
+}
+void DisplayList::arc(const vec2 &center, float r, float a0, float a1, int dir) {
+  arc(center.x, center.y, r, a0, a1, dir);
+}
+void DisplayList::rect(float x, float y, float w, float h) {
+  push(RECT, x, y, w, h);
+  mHasPathPos = false;
+}
+void DisplayList::rect(const Rectf &r) {
+  rect(r.getX1(), r.getY1(), r.getWidth(), r.getHeight());
+}
+void DisplayList::roundedRect(float x, float y, float w, float h, float r) {
+  push(ROUNDEDRECT, x, y, w, h, r);
+  mHasPathPos = false;
+}
+void DisplayList::roundedRect(const Rectf &rect, float r) {
+  roundedRect(rect.getX1(), rect.getY1(), rect.getWidth(), rect.getHeight(), r);
+}
+void DisplayList::ellipse(float cx, float cy, float rx, float ry) {
+  push(ELLIPSE, cx, cy, rx, ry);
+  mHasPathPos = false;
+}
+void DisplayList::ellipse(const vec2 &center, float rx, float ry) {
+  ellipse(center.x, center.y, rx, ry);
+}
+void DisplayList::circle(float cx, float cy, float r) {
+  push(CIRCLE, cx, cy, r);
+  mHasPathPos = false;
+}
+void DisplayList::circle(const vec2 &center, float radius) {
+  circle(center.x, center.y, radius);
+}
+
+void DisplayList::moveToLines(const vec2 *pts, size_t count, bool closed) {
+  if (count == 0) return;
+
+  float *dst = pushPath(count * 3 + (closed ? 1 : 0));
+  for (size_t i = 0; i < count; ++i, dst += 3) {
+    dst[0] = float(i == 0 ? Tessellator::MOVETO : Tessellator::LINETO);
+    dst[1] = pts[i].x;
+    dst[2] = pts[i].y;
+  }
+  if (closed) dst[0] = float(Tessellator::CLOSE);
+  mPathPos = pts[count - 1];
+  mHasPathPos = true;
+}
+void DisplayList::polyLines(const vec2 *pts, const size_t *counts, size_t numLines,
+                            bool closed) {
+  for (size_t i = 0; i < numLines; ++i) {
+    moveToLines(pts, counts[i], closed);
+    pts += counts[i];
+  }
+}
+void DisplayList::appendPath(const PathRef &path) {
+  auto &cmds = path.getCommands();
+  if (cmds.empty()) return;
+
+  std::copy(cmds.begin(), cmds.end(), pushPath(cmds.size()));
+  mPathPos = path.getEndPoint();
+  mHasPathPos = true;
+}
+void DisplayList::appendPath(const float *commands, size_t count) {
+  if (count == 0) return;
+
+  std::copy(commands, commands + count, pushPath(count));
+  if (const float *p = findEndPoint(commands, count)) {
+    mPathPos = vec2(p[0], p[1]);
+    mHasPathPos = true;
+  }
+}
+
+void DisplayList::fill() {
+  push(FILL);
+}
+void DisplayList::stroke() {
+  push(STROKE);
+}
+
+// Cinder Types //
+
+void DisplayList::polyLine(const PolyLine2f &polyline) {
+  auto &pts = polyline.getPoints();
+  if (pts.size() >= 2) {
+    moveToLines(pts.data(), pts.size(), polyline.isClosed());
+  }
+}
+void DisplayList::polyLines(const std::vector<PolyLine2f> &polylines) {
+  for (auto &polyline : polylines) {
+    polyLine(polyline);
+  }
+}
+
+// Same segments as Context::path2d.
+void DisplayList::path2d(const Path2d &path) {
+  if (path.getPoints().empty()) return;
+
+  moveTo(path.getPoint(0));
+
+  size_t i = 1;
+  for (auto &seg : path.getSegments()) {
+    switch (seg) {
+      case Path2d::MOVETO:
+        moveTo(path.getPoint(i++));
+        break;
+      case Path2d::LINETO:
+        lineTo(path.getPoint(i++));
+        break;
+      case Path2d::QUADTO:
+        quadTo(path.getPoint(i), path.getPoint(i + 1));
+        i += 2;
+        break;
+      case Path2d::CUBICTO:
+        bezierTo(path.getPoint(i), path.getPoint(i + 1), path.getPoint(i + 2));
+        i += 3;
+        break;
+      case Path2d::CLOSE:
+        lineTo(path.getPoint(0));
+        break;
+    }
+  }
+}
+void DisplayList::shape2d(const Shape2d &shape) {
+  for (auto &contour : shape.getContours()) {
+    path2d(contour);
+  }
+}
+
+// Text //
+
+void DisplayList::fontSize(float size) {
+  push(FONTSIZE, size);
+}
+void DisplayList::fontBlur(float blur) {
+  push(FONTBLUR, blur);
+}
+void DisplayList::fontFaceId(int font) {
+  push(FONTFACEID, font);
+}
+void DisplayList::fontFace(const std::string &font) {
+  push(FONTFACE, pushString(font.data(), font.data() + font.size()));
+}
+void DisplayList::fontFace(const char *font) {
+  push(FONTFACE, pushString(font, font + std::strlen(font)));
+}
+void DisplayList::fontFace(FontHandle font) {
+  fontFaceId(font.id);
+}
+
+void DisplayList::textLetterSpacing(float spacing) {
+  push(LETTERSPACING, spacing);
+}
+void DisplayList::textLineHeight(float lineHeight) {
+  push(LINEHEIGHT, lineHeight);
+}
+void DisplayList::textAlign(int align) {
+  push(TEXTALIGN, align);
+}
+
+void DisplayList::text(float x, float y, const std::string &str) {
+  text(x, y, str.data(), str.data() + str.size());
+}
+void DisplayList::text(const vec2 &p, const std::string &str) {
+  text(p.x, p.y, str);
+}
+void DisplayList::textBox(float x, float y, float breakRowWidth, const std::string &str) {
+  textBox(x, y, breakRowWidth, str.data(), str.data() + str.size());
+}
+void DisplayList::textBox(const vec2 &p, float breakRowWidth, const std::string &str) {
+  textBox(p.x, p.y, breakRowWidth, str);
+}
+
+void DisplayList::text(float x, float y, const char *str, const char *end) {
+  if (!end) end = str + std::strlen(str);
+  push(TEXT, x, y, pushString(str, end), end - str);
+}
+void DisplayList::text(const vec2 &p, const char *str, const char *end) {
+  text(p.x, p.y, str, end);
+}
+void DisplayList::textBox(float x, float y, float breakRowWidth, const char *str,
+                          const char *end) {
+  if (!end) end = str + std::strlen(str);
+  push(TEXTBOX, x, y, breakRowWidth, pushString(str, end), end - str);
+}
+void DisplayList::textBox(const vec2 &p, float breakRowWidth, const char *str, const char *end) {
+  textBox(p.x, p.y, breakRowWidth, str, end);
+}
+
+}} // cinder::nvg
@@ -0,0 +1,114 @@
+#include "FontRegistry.hpp"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cinder { namespace nvg {
+
+// Blob //
+
+#if defined(_WIN32)
+
+FontRegistry::Blob::Blob(const fs::path &path) {
+  HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return;
+
+  LARGE_INTEGER size;
+  HANDLE mapping = NULL;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  }
+  if (!mapping) {
+    CloseHandle(file);
+    return;
+  }
+
+  mData = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!mData) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return;
+  }
+
+  mSize = size_t(size.QuadPart);
+  mFile = file;
+  mMapping = mapping;
+}
+
+FontRegistry::Blob::~Blob() {
+  if (!mData) return;
+  UnmapViewOfFile(mData);
+  CloseHandle(mMapping);
+  CloseHandle(mFile);
+}
+
+#else
+
+FontRegistry::Blob::Blob(const fs::path &path) {
+  int fd = open(path.string().c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      mData = static_cast<const unsigned char *>(data);
+      mSize = size_t(st.st_size);
+    }
+  }
+
+  // The mapping keeps the file alive on its own.
+  close(fd);
+}
+
+FontRegistry::Blob::~Blob() {
+  if (mData) munmap(const_cast<unsigned char *>(mData), mSize);
+}
+
+#endif
+
+// FontRegistry //
+
+void FontRegistry::registerFont(const std::string &name, const fs::path &path) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto &entry = mEntries[name];
+  entry.path = path;
+  entry.blob.reset();
+}
+
+bool FontRegistry::contains(const std::string &name) const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mEntries.count(name) > 0;
+}
+
+FontRegistry::BlobRef FontRegistry::acquire(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mEntries.find(name);
+  if (it == mEntries.end()) return nullptr;
+
+  BlobRef blob = it->second.blob.lock();
+  if (!blob) {
+    blob = std::make_shared<const Blob>(it->second.path);
+    if (blob->empty()) return nullptr;
+    it->second.blob = blob;
+  }
+  return blob;
+}
+
+FontRegistry &FontRegistry::shared() {
+  static std::once_flag once;
+  static std::unique_ptr<FontRegistry> registry;
+  std::call_once(once, [] { registry.reset(new FontRegistry()); });
+  return *registry;
+}
+
+}} // cinder::nvg
@@ -0,0 +1,93 @@
+#include "FrameStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+size_t FrameStats::*const kCounts[] = {
+  &FrameStats::numCommands,  &FrameStats::numPoints,   &FrameStats::numPaths,
+  &FrameStats::numVertices,  &FrameStats::numFills,    &FrameStats::numStrokes,
+  &FrameStats::numTriangles, &FrameStats::numGlyphs,   &FrameStats::numAtlasUploads,
+  &FrameStats::numImageBinds, &FrameStats::numBatchedDraws, &FrameStats::numBatches
+};
+
+double FrameStats::*const kTimes[] = { &FrameStats::tessellationMs, &FrameStats::flushMs };
+
+// Sorts the values of one field and picks the one at rank, for every field.
+FrameStats pickRank(const std::vector<FrameStats> &frames, size_t rank) {
+  FrameStats result;
+  if (frames.empty()) return result;
+
+  std::vector<double> values(frames.size());
+  auto pick = [&]() {
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+  };
+
+  for (auto field : kCounts) {
+    for (size_t i = 0; i < frames.size(); ++i) values[i] = double(frames[i].*field);
+    result.*field = size_t(pick());
+  }
+  for (auto field : kTimes) {
+    for (size_t i = 0; i < frames.size(); ++i) values[i] = frames[i].*field;
+    result.*field = pick();
+  }
+  return result;
+}
+
+} // anon
+
+void FrameStatsHistory::add(const FrameStats &stats) {
+  if (mCapacity == 0) return;
+
+  if (mFrames.size() < mCapacity) {
+    mFrames.push_back(stats);
+  } else {
+    mFrames[mNext] = stats;
+  }
+  mNext = (mNext + 1) % mCapacity;
+}
+
+void FrameStatsHistory::clear() {
+  mFrames.clear();
+  mNext = 0;
+}
+
+FrameStats FrameStatsHistory::getMin() const {
+  return pickRank(mFrames, 0);
+}
+
+FrameStats FrameStatsHistory::getMax() const {
+  return pickRank(mFrames, mFrames.empty() ? 0 : mFrames.size() - 1);
+}
+
+FrameStats FrameStatsHistory::getAverage() const {
+  FrameStats result;
+  if (mFrames.empty()) return result;
+
+  double n = double(mFrames.size());
+  for (auto field : kCounts) {
+    double sum = 0.0;
+    for (auto &frame : mFrames) sum += double(frame.*field);
+    result.*field = size_t(sum / n + 0.5);
+  }
+  for (auto field : kTimes) {
+    double sum = 0.0;
+    for (auto &frame : mFrames) sum += frame.*field;
+    result.*field = sum / n;
+  }
+  return result;
+}
+
+FrameStats FrameStatsHistory::getPercentile(float percentile) const {
+  if (mFrames.empty()) return FrameStats();
+
+  float p = std::min(std::max(percentile, 0.0f), 100.0f);
+  size_t rank = size_t(std::ceil(p / 100.0f * mFrames.size()));
+  return pickRank(mFrames, rank > 0 ? rank - 1 : 0);
+}
+
+}} // cinder::nvg
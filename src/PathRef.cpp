@@ -0,0 +1,129 @@
+#include "PathRef.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+std::atomic<uint64_t> sNextId(1);
+
+} // anon
+
+PathRef::PathRef(const Path2d &path) {
+  encode(path);
+  finish();
+}
+
+PathRef::PathRef(const Shape2d &shape) {
+  for (auto &contour : shape.getContours()) {
+    encode(contour);
+  }
+  finish();
+}
+
+PathRef::PathRef(const PolyLine2f &polyline) {
+  encode(polyline);
+  finish();
+}
+
+PathRef::PathRef(PathRef &&other)
+: mCommands{ std::move(other.mCommands) }, mBounds{ other.mBounds },
+  mEndPoint{ other.mEndPoint }, mId{ other.mId } {
+  other.mId = 0;
+}
+
+PathRef &PathRef::operator=(PathRef &&other) {
+  mCommands = std::move(other.mCommands);
+  mBounds = other.mBounds;
+  mEndPoint = other.mEndPoint;
+  mId = other.mId;
+  other.mId = 0;
+  return *this;
+}
+
+void PathRef::encode(const Path2d &path) {
+  encode(path, mCommands, mEndPoint);
+}
+
+void PathRef::encode(const Path2d &path, std::vector<float> &commands, vec2 &endPoint) {
+  if (path.getPoints().empty()) return;
+
+  const vec2 *prev = &path.getPoint(0);
+  const float move[] = { float(MOVETO), prev->x, prev->y };
+  commands.insert(commands.end(), move, move + 3);
+
+  size_t i = 1;
+  for (auto &seg : path.getSegments()) {
+    switch (seg) {
+      case Path2d::MOVETO:
+      case Path2d::LINETO: {
+        prev = &path.getPoint(i++);
+        const float cmd[] = { float(seg == Path2d::MOVETO ? MOVETO : LINETO), prev->x, prev->y };
+        commands.insert(commands.end(), cmd, cmd + 3);
+        break;
+      }
+      case Path2d::QUADTO: {
+        const vec2 &c = path.getPoint(i), &p = path.getPoint(i + 1);
+        vec2 c1 = *prev + 2.0f / 3.0f * (c - *prev), c2 = p + 2.0f / 3.0f * (c - p);
+        const float cmd[] = { float(BEZIERTO), c1.x, c1.y, c2.x, c2.y, p.x, p.y };
+        commands.insert(commands.end(), cmd, cmd + 7);
+        prev = &p;
+        i += 2;
+        break;
+      }
+      case Path2d::CUBICTO: {
+        const vec2 &c1 = path.getPoint(i), &c2 = path.getPoint(i + 1), &p = path.getPoint(i + 2);
+        const float cmd[] = { float(BEZIERTO), c1.x, c1.y, c2.x, c2.y, p.x, p.y };
+        commands.insert(commands.end(), cmd, cmd + 7);
+        prev = &p;
+        i += 3;
+        break;
+      }
+      case Path2d::CLOSE:
+        commands.push_back(float(CLOSE));
+        prev = &path.getPoint(0);
+        break;
+    }
+  }
+
+  endPoint = *prev;
+}
+
+void PathRef::encode(const PolyLine2f &polyline) {
+  auto &pts = polyline.getPoints();
+  if (pts.size() < 2) return;
+
+  mCommands.reserve(mCommands.size() + pts.size() * 3 + 1);
+  for (size_t i = 0; i < pts.size(); ++i) {
+    mCommands.push_back(float(i == 0 ? MOVETO : LINETO));
+    mCommands.push_back(pts[i].x);
+    mCommands.push_back(pts[i].y);
+  }
+  if (polyline.isClosed()) mCommands.push_back(float(CLOSE));
+
+  mEndPoint = pts.back();
+}
+
+void PathRef::finish() {
+  if (mCommands.empty()) return;
+
+  mCommands.shrink_to_fit();
+  mId = (uint64_t(1) << 63) | sNextId++;
+
+  vec2 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+  for (size_t i = 0; i < mCommands.size();) {
+    int cmd = int(mCommands[i++]);
+    int npts = cmd == BEZIERTO ? 3 : cmd == CLOSE ? 0 : 1;
+    for (int j = 0; j < npts; ++j, i += 2) {
+      vec2 p(mCommands[i], mCommands[i + 1]);
+      lo = glm::min(lo, p);
+      hi = glm::max(hi, p);
+    }
+  }
+  mBounds = Rectf(lo, hi);
+}
+
+}} // cinder::nvg
@@ -0,0 +1,111 @@
+#include "StreamingPolyline.hpp"
+
+#include <algorithm>
+
+namespace cinder { namespace nvg {
+
+StreamingPolyline::StreamingPolyline(size_t capacity) : mCapacity{ capacity } {}
+
+void StreamingPolyline::append(const vec2 &point) {
+  // Repeated points would leave a segment without a direction.
+  if (!empty() && mPoints.back() == point) return;
+
+  mPoints.push_back(point);
+  mJoinBegins.push_back(0);
+  if (mCapacity && size() > mCapacity) setCapacity(mCapacity);
+}
+void StreamingPolyline::append(ArrayView<vec2> points) {
+  mPoints.reserve(mPoints.size() + points.size());
+  mJoinBegins.reserve(mPoints.size() + points.size());
+  for (auto &point : points) append(point);
+}
+
+void StreamingPolyline::clear() {
+  mPoints.clear();
+  mJoinBegins.clear();
+  mVerts.clear();
+  mHead.clear();
+  mFirst = mNumJoined = mCapBegin = 0;
+}
+
+void StreamingPolyline::setCapacity(size_t capacity) {
+  mCapacity = capacity;
+  if (!mCapacity || size() <= mCapacity) return;
+
+  mFirst = mPoints.size() - mCapacity;
+  // Erasing once as many points were dropped as are kept moves each point at most once on
+  // average.
+  if (mFirst >= size()) compact();
+}
+
+size_t StreamingPolyline::getStrokeBegin() const {
+  return mFirst + 1 < mNumJoined ? mJoinBegins[mFirst + 1] : mCapBegin;
+}
+
+void StreamingPolyline::compact() {
+  size_t begin = getStrokeBegin();
+  mVerts.erase(mVerts.begin(), mVerts.begin() + begin);
+  mCapBegin -= begin;
+  for (size_t i = mFirst + 1; i < mNumJoined; ++i) {
+    mJoinBegins[i] -= begin;
+  }
+
+  mPoints.erase(mPoints.begin(), mPoints.begin() + mFirst);
+  mJoinBegins.erase(mJoinBegins.begin(), mJoinBegins.begin() + mFirst);
+  mNumJoined = mNumJoined > mFirst ? mNumJoined - mFirst : 0;
+  mFirst = 0;
+}
+
+size_t StreamingPolyline::expand(const Tessellator &tess, const TessellationCache::Key &key,
+                                 const float *canonical, float fringe, int lineCap,
+                                 int lineJoin) {
+  if (!mExpanded || !(mKey == key) || mLineCap != lineCap || mLineJoin != lineJoin) {
+    mExpanded = true;
+    mKey = key;
+    std::copy(canonical, canonical + 6, mCanonical);
+    mLineCap = lineCap;
+    mLineJoin = lineJoin;
+    mVerts.clear();
+    mNumJoined = mCapBegin = 0;
+  }
+
+  const float *t = mCanonical;
+  auto transform = [t](float *dst, const vec2 &p) {
+    dst[0] = t[0] * p.x + t[2] * p.y + t[4];
+    dst[1] = t[1] * p.x + t[3] * p.y + t[5];
+  };
+
+  // New joins replace the old end cap. A join needs the point after it, so the last point only
+  // gets the end cap.
+  float halfWidth = key.strokeWidth * 0.5f;
+  size_t n = mPoints.size(), numExpanded = 0;
+  float pts[6];
+  mVerts.resize(mCapBegin);
+  for (size_t i = std::max(mNumJoined, mFirst + 1); i + 1 < n; ++i) {
+    transform(pts, mPoints[i - 1]);
+    transform(pts + 2, mPoints[i]);
+    transform(pts + 4, mPoints[i + 1]);
+    mJoinBegins[i] = mVerts.size();
+    tess.appendStrokeJoin(pts, halfWidth, fringe, lineJoin, key.miterLimit, mVerts);
+    numExpanded++;
+  }
+  mNumJoined = std::max(mNumJoined, n - 1);
+
+  mCapBegin = mVerts.size();
+  transform(pts, mPoints[n - 2]);
+  transform(pts + 2, mPoints[n - 1]);
+  tess.appendStrokeCap(pts, false, halfWidth, fringe, lineCap, mVerts);
+
+  // The start cap moves along with the first point, and is drawn as a strip of its own that
+  // ends where the rest begins.
+  transform(pts, mPoints[mFirst]);
+  transform(pts + 2, mPoints[mFirst + 1]);
+  mHead.clear();
+  tess.appendStrokeCap(pts, true, halfWidth, fringe, lineCap, mHead);
+  size_t begin = getStrokeBegin();
+  mHead.insert(mHead.end(), mVerts.begin() + begin, mVerts.begin() + begin + 2);
+
+  return numExpanded + 2;
+}
+
+}} // cinder::nvg
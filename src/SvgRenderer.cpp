@@ -3,10 +3,100 @@
 
 #include "nanovg.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 namespace cinder { namespace nvg {
 
-SvgRenderer::SvgRenderer(Context &ctx) : mCtx{ ctx } {
-  mMatrixStack.emplace_back(1);
+namespace {
+
+// Same as nvgLinearGradient, which does not need a context.
+NVGpaint linearGradientPaint(const vec2 &start, const vec2 &end, const NVGcolor &startColor,
+                             const NVGcolor &endColor) {
+  const float large = 1e5f;
+
+  NVGpaint p;
+  std::memset(&p, 0, sizeof(p));
+
+  vec2 dir = end - start;
+  float d = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+  dir = d > 0.0001f ? dir / d : vec2(0.0f, 1.0f);
+
+  p.xform[0] = dir.y;
+  p.xform[1] = -dir.x;
+  p.xform[2] = dir.x;
+  p.xform[3] = dir.y;
+  p.xform[4] = start.x - dir.x * large;
+  p.xform[5] = start.y - dir.y * large;
+
+  p.extent[0] = large;
+  p.extent[1] = large + d * 0.5f;
+  p.feather = std::max(1.0f, d);
+  p.innerColor = startColor;
+  p.outerColor = endColor;
+  return p;
+}
+
+} // anon
+
+// Conversions //
+
+NVGcolor toNVGcolor(const ColorAf &color) {
+  return nvgRGBAf(color.r, color.g, color.b, color.a);
+}
+
+NVGpaint colorPaint(const NVGcolor &color) {
+  NVGpaint p;
+  std::memset(&p, 0, sizeof(p));
+  nvgTransformIdentity(p.xform);
+  p.feather = 1.0f;
+  p.innerColor = p.outerColor = color;
+  return p;
+}
+
+int convertLineCap(svg::LineCap lineCap) {
+  return lineCap == svg::LINE_CAP_ROUND  ? NVG_ROUND :
+         lineCap == svg::LINE_CAP_SQUARE ? NVG_SQUARE : NVG_BUTT;
+}
+
+int convertLineJoin(svg::LineJoin lineJoin) {
+  return lineJoin == svg::LINE_JOIN_ROUND ? NVG_ROUND :
+         lineJoin == svg::LINE_JOIN_BEVEL ? NVG_BEVEL : NVG_MITER;
+}
+
+float convertFontSize(const svg::TextSpan &span) {
+  // TODO(ryan): This font size multiplier was just guessed based on how the test text looked and
+  // may not be correct. Check with other fonts / sizes.
+  return span.getFontSize().asUser() * 1.1666f;
+}
+
+bool convertPaint(const svg::Paint &paint, float opacity, NVGpaint &result) {
+  if (paint.isNone()) return false;
+
+  if (paint.isLinearGradient()) {
+    result = linearGradientPaint(paint.getCoords0(), paint.getCoords1(),
+                                 toNVGcolor(paint.getColor(0)), toNVGcolor(paint.getColor(1)));
+  }
+  else if (paint.isRadialGradient()) {
+    // TODO(ryan): Implement this.
+    return false;
+  }
+  else {
+    result = colorPaint(toNVGcolor(paint.getColor()));
+  }
+  result.innerColor.a *= opacity;
+  result.outerColor.a *= opacity;
+  return true;
+}
+
+// Renderer //
+
+// Document transforms are applied on top of the context's transform at construction.
+SvgRenderer::SvgRenderer(Context &ctx)
+: mCtx{ ctx }, mDefaultFont{ ctx.currentFontFaceId() },
+  mAppliedTransform{ ctx.currentTransform() } {
+  mMatrixStack.push_back(mAppliedTransform);
 
   mFillStack.push_back(svg::Paint(Color::black()));
   mStrokeStack.push_back(svg::Paint());
@@ -24,134 +114,145 @@ SvgRenderer::SvgRenderer(Context &ctx) : mCtx{ ctx } {
 
 
 bool SvgRenderer::prepareFill() {
-  const auto &paint = mFillStack.back();
-
-  if (paint.isNone()) {
-    return false;
-  }
-  else {
-    float opacity = mFillOpacityStack.back();
-
-    if (paint.isLinearGradient()) {
-      auto nvgPaint = mCtx.convert(paint);
-      nvgPaint.innerColor.a *= opacity;
-      nvgPaint.outerColor.a *= opacity;
-      mCtx.fillPaint(nvgPaint);
-    }
-    else if (paint.isRadialGradient()) {
-      // TODO(ryan): Implement this.
-      return false;
-    }
-    else {
-      ColorAf color = paint.getColor();
-      color.a *= opacity;
-      mCtx.fillColor(color);
-    }
-
-    return true;
-  }
+  NVGpaint paint;
+  if (!convertPaint(mFillStack.back(), mFillOpacityStack.back(), paint)) return false;
+  mCtx.fillPaint(paint);
+  return true;
 }
 
 bool SvgRenderer::prepareStroke() {
-  const auto &paint = mStrokeStack.back();
+  NVGpaint paint;
+  if (!convertPaint(mStrokeStack.back(), mStrokeOpacityStack.back(), paint)) return false;
+  mCtx.strokePaint(paint);
+  return true;
+}
 
-  if (paint.isNone()) {
-    return false;
+void SvgRenderer::fillAndStroke() {
+  if (prepareFill()) mCtx.fill();
+  if (prepareStroke()) {
+    applyStrokeState();
+    mCtx.stroke();
   }
-  else {
-    float opacity = mStrokeOpacityStack.back();
+}
 
-    if (paint.isLinearGradient()) {
-      auto nvgPaint = mCtx.convert(paint);
-      nvgPaint.innerColor.a *= opacity;
-      nvgPaint.outerColor.a *= opacity;
-      mCtx.strokePaint(nvgPaint);
-    }
-    else if (paint.isRadialGradient()) {
-      // TODO(ryan): Implement this.
-      return false;
-    }
-    else {
-      ColorAf color = paint.getColor();
-      color.a *= opacity;
-      mCtx.strokeColor(color);
-    }
+void SvgRenderer::applyTransform(const mat3 &transform) {
+  if (transform == mAppliedTransform) return;
+  mCtx.setTransform(transform);
+  mAppliedTransform = transform;
+}
 
-    return true;
+void SvgRenderer::applyStrokeState() {
+  if (mStrokeWidthStack.back() != mAppliedStrokeWidth) {
+    mAppliedStrokeWidth = mStrokeWidthStack.back();
+    mCtx.strokeWidth(mAppliedStrokeWidth);
+  }
+  if (mLineCapStack.back() != mAppliedLineCap) {
+    mAppliedLineCap = mLineCapStack.back();
+    mCtx.lineCap(mAppliedLineCap);
+  }
+  if (mLineJoinStack.back() != mAppliedLineJoin) {
+    mAppliedLineJoin = mLineJoinStack.back();
+    mCtx.lineJoin(mAppliedLineJoin);
   }
 }
 
-void SvgRenderer::fillAndStroke() {
-  if (prepareFill()) mCtx.fill();
-  if (prepareStroke()) mCtx.stroke();
+// Points are transformed as they are added, so the transform has to be in place first.
+void SvgRenderer::beginShape() {
+  applyTransform(mMatrixStack.back());
+  mCtx.beginPath();
 }
 
 
 void SvgRenderer::drawPath(const svg::Path &path) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.shape2d(path.getShape2d());
   fillAndStroke();
 }
 
 void SvgRenderer::drawPolyline(const svg::Polyline &polyline) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.polyLine(polyline.getPolyLine());
   fillAndStroke();
 }
 
 void SvgRenderer::drawPolygon(const svg::Polygon &polygon) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.polyLine(polygon.getPolyLine());
   fillAndStroke();
 }
 
 void SvgRenderer::drawLine(const svg::Line &line) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.moveTo(line.getPoint1());
   mCtx.lineTo(line.getPoint2());
   fillAndStroke();
 }
 
 void SvgRenderer::drawRect(const svg::Rect &rect) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.rect(rect.getRect());
   fillAndStroke();
 }
 
 void SvgRenderer::drawCircle(const svg::Circle &circle) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.circle(circle.getCenter(), circle.getRadius());
   fillAndStroke();
 }
 
 void SvgRenderer::drawEllipse(const svg::Ellipse &ellipse) {
-  mCtx.beginPath();
+  beginShape();
   mCtx.ellipse(ellipse.getCenter(), ellipse.getRadiusX(), ellipse.getRadiusY());
   fillAndStroke();
 }
 
+// Returns the first family the context has or can load from the FontRegistry.
+FontHandle SvgRenderer::resolveFont(const std::vector<std::string> &families) {
+  for (auto &family : families) {
+    auto it = std::find_if(mFonts.begin(), mFonts.end(),
+                           [&](const std::pair<std::string, FontHandle> &font) {
+                             return font.first == family;
+                           });
+    if (it == mFonts.end()) {
+      mFonts.emplace_back(family, mCtx.getFontHandle(family));
+      it = mFonts.end() - 1;
+    }
+    if (it->second.isValid()) return it->second;
+  }
+  return FontHandle();
+}
+
+// Spans are drawn under the current transform rotated by the text rotation, which is applied like
+// any other transform change instead of through a save / restore per span.
 void SvgRenderer::drawTextSpan(const svg::TextSpan &span) {
-  mCtx.save();
-  mCtx.rotate(toRadians(mTextRotationStack.back()));
+  float angle = toRadians(mTextRotationStack.back());
+  mat3 rotation(1);
+  rotation[0][0] = rotation[1][1] = std::cos(angle);
+  rotation[0][1] = std::sin(angle);
+  rotation[1][0] = -rotation[0][1];
+  applyTransform(mMatrixStack.back() * rotation);
 
-  // TODO(ryan): This font size multiplier was just guessed based on how the test text looked and
-  // may not be correct. Check with other fonts / sizes.
-  mCtx.fontSize(span.getFontSize().asUser() * 1.1666f);
+  // Spans in families the context doesn't have use the face the context had at construction,
+  // not that of the span before them.
+  FontHandle font = resolveFont(span.getFontFamilies());
+  mCtx.fontFaceId(font.isValid() ? font.id : mDefaultFont);
+
+  mCtx.fontSize(convertFontSize(span));
 
   mCtx.fillColor(span.getFill().getColor());
-  mCtx.textAlign(NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+  if (!mTextAlignApplied) {
+    mCtx.textAlign(NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+    mTextAlignApplied = true;
+  }
   mCtx.text(mTextPenStack.back(), span.getString());
-  mCtx.restore();
 }
 
 
 void SvgRenderer::pushMatrix(const mat3 &top) {
   mMatrixStack.push_back(mMatrixStack.back() * top);
-  mCtx.setTransform(mMatrixStack.back());
 }
 void SvgRenderer::popMatrix() {
   mMatrixStack.pop_back();
-  mCtx.setTransform(mMatrixStack.back());
 }
 
 void SvgRenderer::pushFill(const class svg::Paint &paint) {
@@ -184,11 +285,9 @@ void SvgRenderer::popStrokeOpacity() {
 
 void SvgRenderer::pushStrokeWidth(float width) {
   mStrokeWidthStack.push_back(width);
-  mCtx.strokeWidth(width);
 }
 void SvgRenderer::popStrokeWidth() {
   mStrokeWidthStack.pop_back();
-  mCtx.strokeWidth(mStrokeWidthStack.back());
 }
 
 void SvgRenderer::pushFillRule(svg::FillRule) {
@@ -197,25 +296,17 @@ void SvgRenderer::pushFillRule(svg::FillRule) {
 void SvgRenderer::popFillRule() {}
 
 void SvgRenderer::pushLineCap(svg::LineCap lineCap) {
-  int cap = lineCap == svg::LINE_CAP_ROUND  ? NVG_ROUND :
-            lineCap == svg::LINE_CAP_SQUARE ? NVG_SQUARE : NVG_BUTT;
-  mLineCapStack.push_back(cap);
-  mCtx.lineCap(cap);
+  mLineCapStack.push_back(convertLineCap(lineCap));
 }
 void SvgRenderer::popLineCap() {
   mLineCapStack.pop_back();
-  mCtx.lineCap(mLineCapStack.back());
 }
 
 void SvgRenderer::pushLineJoin(svg::LineJoin lineJoin) {
-  int join = lineJoin == svg::LINE_JOIN_ROUND ? NVG_ROUND :
-             lineJoin == svg::LINE_JOIN_BEVEL ? NVG_BEVEL : NVG_MITER;
-  mLineJoinStack.push_back(join);
-  mCtx.lineJoin(join);
+  mLineJoinStack.push_back(convertLineJoin(lineJoin));
 }
 void SvgRenderer::popLineJoin() {
   mLineJoinStack.pop_back();
-  mCtx.lineJoin(mLineJoinStack.back());
 }
 
 void SvgRenderer::pushTextPen(const vec2 &penPos) {
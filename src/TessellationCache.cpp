@@ -0,0 +1,159 @@
+#include "TessellationCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+// Scales within 1/64th of an octave of each other share entries, which keeps the error in stroke
+// widths and fringes under half a percent.
+const float kScaleBucketsPerOctave = 64.0f;
+
+inline void hashCombine(size_t &seed, size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+} // anon
+
+const int32_t TessellationCache::kGeneral;
+
+bool TessellationCache::Key::operator==(const Key &other) const {
+  return path == other.path && flags == other.flags && scale == other.scale &&
+         std::equal(linear, linear + 4, other.linear) && fringe == other.fringe &&
+         strokeWidth == other.strokeWidth && miterLimit == other.miterLimit;
+}
+
+size_t TessellationCache::KeyHash::operator()(const Key &key) const {
+  std::hash<float> hashFloat;
+  size_t seed = std::hash<uint64_t>()(key.path);
+  hashCombine(seed, key.flags);
+  hashCombine(seed, size_t(key.scale));
+  for (float v : key.linear) hashCombine(seed, hashFloat(v));
+  hashCombine(seed, hashFloat(key.fringe));
+  hashCombine(seed, hashFloat(key.strokeWidth));
+  hashCombine(seed, hashFloat(key.miterLimit));
+  return seed;
+}
+
+void TessellationCache::splitTransform(const float *t, Key &key, float *canonical,
+                                       float *remaining) {
+  float len0 = t[0] * t[0] + t[1] * t[1];
+  float len1 = t[2] * t[2] + t[3] * t[3];
+  float dot = t[0] * t[2] + t[1] * t[3];
+  float det = t[0] * t[3] - t[1] * t[2];
+  float tol = 1e-4f * std::max(len0, len1);
+
+  if (det != 0.0f && std::abs(len0 - len1) <= tol && std::abs(dot) <= tol) {
+    // Translation, rotation, uniform scale and possibly a mirror. Keep the bucketed scale and
+    // the mirror, which flips winding, and leave the rest for the remaining transform.
+    int32_t bucket = int32_t(std::floor(std::log2(std::sqrt(std::abs(det))) *
+                                        kScaleBucketsPerOctave + 0.5f));
+    float s = std::exp2(bucket / kScaleBucketsPerOctave);
+    float m = det < 0.0f ? -1.0f : 1.0f;
+
+    key.scale = bucket;
+    key.linear[0] = 1.0f;
+    key.linear[1] = key.linear[2] = 0.0f;
+    key.linear[3] = m;
+
+    canonical[0] = s;
+    canonical[1] = canonical[2] = 0.0f;
+    canonical[3] = s * m;
+    canonical[4] = canonical[5] = 0.0f;
+
+    remaining[0] = t[0] / s;
+    remaining[1] = t[1] / s;
+    remaining[2] = t[2] * m / s;
+    remaining[3] = t[3] * m / s;
+  } else {
+    key.scale = kGeneral;
+    std::copy(t, t + 4, key.linear);
+
+    std::copy(t, t + 4, canonical);
+    canonical[4] = canonical[5] = 0.0f;
+
+    remaining[0] = remaining[3] = 1.0f;
+    remaining[1] = remaining[2] = 0.0f;
+  }
+
+  remaining[4] = t[4];
+  remaining[5] = t[5];
+}
+
+TessellationCache::TessellationCache(TessellationCache &&other)
+: mEntries{ std::move(other.mEntries) }, mLru{ std::move(other.mLru) },
+  mNumBytes{ other.mNumBytes }, mByteBudget{ other.mByteBudget }, mHits{ other.mHits },
+  mMisses{ other.mMisses } {
+  other.mNumBytes = 0;
+}
+
+const Tessellation *TessellationCache::find(const Key &key) {
+  auto it = mEntries.find(key);
+  if (it == mEntries.end()) {
+    mMisses++;
+    return nullptr;
+  }
+
+  mHits++;
+  mLru.splice(mLru.begin(), mLru, it->second.lru);
+  return &it->second.tessellation;
+}
+
+const Tessellation *TessellationCache::insert(const Key &key, Tessellation &&tessellation) {
+  auto it = mEntries.find(key);
+  if (it != mEntries.end()) {
+    mNumBytes -= it->second.tessellation.getNumBytes();
+    it->second.tessellation = std::move(tessellation);
+    mLru.splice(mLru.begin(), mLru, it->second.lru);
+  } else {
+    mLru.push_front(key);
+    Entry entry;
+    entry.tessellation = std::move(tessellation);
+    entry.lru = mLru.begin();
+    it = mEntries.emplace(key, std::move(entry)).first;
+  }
+
+  mNumBytes += it->second.tessellation.getNumBytes();
+  evict();
+  return &it->second.tessellation;
+}
+
+// NOTE: The most recently used entry is never evicted, so the pointer insert() returns stays
+// valid even when that entry alone is over budget.
+void TessellationCache::evict() {
+  while (mNumBytes > mByteBudget && mLru.size() > 1) {
+    auto it = mEntries.find(mLru.back());
+    mNumBytes -= it->second.tessellation.getNumBytes();
+    mEntries.erase(it);
+    mLru.pop_back();
+  }
+}
+
+void TessellationCache::invalidate(uint64_t path) {
+  for (auto it = mLru.begin(); it != mLru.end();) {
+    if (it->path == path) {
+      auto entry = mEntries.find(*it);
+      mNumBytes -= entry->second.tessellation.getNumBytes();
+      mEntries.erase(entry);
+      it = mLru.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void TessellationCache::clear() {
+  mEntries.clear();
+  mLru.clear();
+  mNumBytes = 0;
+}
+
+void TessellationCache::setByteBudget(size_t bytes) {
+  mByteBudget = bytes;
+  evict();
+}
+
+}} // cinder::nvg
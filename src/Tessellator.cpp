@@ -0,0 +1,943 @@
+// Path flattening and fill and stroke expansion ported from nanovg.c, which is under this notice:
+//
+// Copyright (c) 2013 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "Tessellator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CI_NVG_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace cinder { namespace nvg {
+
+// NOTE: Everything below follows nanovg.c closely, including its constants, so output matches
+// what nvgFill / nvgStroke would have produced for the same commands.
+
+namespace {
+
+using Point = Tessellator::Point;
+
+const float kPi = 3.14159265358979323846264338327f;
+
+inline bool ptEquals(float x1, float y1, float x2, float y2, float tol) {
+  float dx = x2 - x1, dy = y2 - y1;
+  return dx * dx + dy * dy < tol * tol;
+}
+
+inline float normalize(float &x, float &y) {
+  float d = std::sqrt(x * x + y * y);
+  if (d > 1e-6f) {
+    float id = 1.0f / d;
+    x *= id;
+    y *= id;
+  }
+  return d;
+}
+
+inline float triarea2(float ax, float ay, float bx, float by, float cx, float cy) {
+  float abx = bx - ax, aby = by - ay;
+  float acx = cx - ax, acy = cy - ay;
+  return acx * aby - abx * acy;
+}
+
+inline void vset(NVGvertex *vtx, float x, float y, float u, float v) {
+  vtx->x = x;
+  vtx->y = y;
+  vtx->u = u;
+  vtx->v = v;
+}
+
+int curveDivs(float r, float arc, float tol) {
+  float da = std::acos(r / (r + tol)) * 2.0f;
+  return std::max(2, int(std::ceil(arc / da)));
+}
+
+float polyArea(const Point *pts, int npts) {
+  float area = 0;
+  for (int i = 2; i < npts; ++i) {
+    area += triarea2(pts[0].x, pts[0].y, pts[i - 1].x, pts[i - 1].y, pts[i].x, pts[i].y);
+  }
+  return area * 0.5f;
+}
+
+void chooseBevel(int bevel, const Point *p0, const Point *p1, float w, float *x0, float *y0,
+                 float *x1, float *y1) {
+  if (bevel) {
+    *x0 = p1->x + p0->dy * w;
+    *y0 = p1->y - p0->dx * w;
+    *x1 = p1->x + p1->dy * w;
+    *y1 = p1->y - p1->dx * w;
+  } else {
+    *x0 = p1->x + p1->dmx * w;
+    *y0 = p1->y + p1->dmy * w;
+    *x1 = p1->x + p1->dmx * w;
+    *y1 = p1->y + p1->dmy * w;
+  }
+}
+
+// Calculates the extrusion and join flags of p1, which follows p0.
+void calculateJoin(const Point *p0, Point *p1, float iw, int lineJoin, float miterLimit) {
+  float dlx0 = p0->dy, dly0 = -p0->dx;
+  float dlx1 = p1->dy, dly1 = -p1->dx;
+
+  // Calculate extrusions
+  p1->dmx = (dlx0 + dlx1) * 0.5f;
+  p1->dmy = (dly0 + dly1) * 0.5f;
+  float dmr2 = p1->dmx * p1->dmx + p1->dmy * p1->dmy;
+  if (dmr2 > 0.000001f) {
+    float scale = std::min(1.0f / dmr2, 600.0f);
+    p1->dmx *= scale;
+    p1->dmy *= scale;
+  }
+
+  // Clear flags, but keep the corner.
+  p1->flags = (p1->flags & Tessellator::PT_CORNER) ? Tessellator::PT_CORNER : 0;
+
+  // Keep track of left turns.
+  float cross = p1->dx * p0->dy - p0->dx * p1->dy;
+  if (cross > 0.0f) p1->flags |= Tessellator::PT_LEFT;
+
+  // Calculate if we should use bevel or miter for inner join.
+  float limit = std::max(1.01f, std::min(p0->len, p1->len) * iw);
+  if ((dmr2 * limit * limit) < 1.0f) p1->flags |= Tessellator::PT_INNERBEVEL;
+
+  // Check to see if the corner needs to be beveled.
+  if (p1->flags & Tessellator::PT_CORNER) {
+    if ((dmr2 * miterLimit * miterLimit) < 1.0f || lineJoin == NVG_BEVEL ||
+        lineJoin == NVG_ROUND) {
+      p1->flags |= Tessellator::PT_BEVEL;
+    }
+  }
+}
+
+NVGvertex *roundJoin(NVGvertex *dst, const Point *p0, const Point *p1, float lw, float rw,
+                     float lu, float ru, int ncap) {
+  float dlx0 = p0->dy, dly0 = -p0->dx;
+  float dlx1 = p1->dy, dly1 = -p1->dx;
+
+  if (p1->flags & Tessellator::PT_LEFT) {
+    float lx0, ly0, lx1, ly1;
+    chooseBevel(p1->flags & Tessellator::PT_INNERBEVEL, p0, p1, lw, &lx0, &ly0, &lx1, &ly1);
+    float a0 = std::atan2(-dly0, -dlx0);
+    float a1 = std::atan2(-dly1, -dlx1);
+    if (a1 > a0) a1 -= kPi * 2;
+
+    vset(dst++, lx0, ly0, lu, 1);
+    vset(dst++, p1->x - dlx0 * rw, p1->y - dly0 * rw, ru, 1);
+
+    int n = std::min(std::max(int(std::ceil(((a0 - a1) / kPi) * ncap)), 2), ncap);
+    for (int i = 0; i < n; ++i) {
+      float u = i / float(n - 1);
+      float a = a0 + u * (a1 - a0);
+      float rx = p1->x + std::cos(a) * rw;
+      float ry = p1->y + std::sin(a) * rw;
+      vset(dst++, p1->x, p1->y, 0.5f, 1);
+      vset(dst++, rx, ry, ru, 1);
+    }
+
+    vset(dst++, lx1, ly1, lu, 1);
+    vset(dst++, p1->x - dlx1 * rw, p1->y - dly1 * rw, ru, 1);
+  } else {
+    float rx0, ry0, rx1, ry1;
+    chooseBevel(p1->flags & Tessellator::PT_INNERBEVEL, p0, p1, -rw, &rx0, &ry0, &rx1, &ry1);
+    float a0 = std::atan2(dly0, dlx0);
+    float a1 = std::atan2(dly1, dlx1);
+    if (a1 < a0) a1 += kPi * 2;
+
+    vset(dst++, p1->x + dlx0 * rw, p1->y + dly0 * rw, lu, 1);
+    vset(dst++, rx0, ry0, ru, 1);
+
+    int n = std::min(std::max(int(std::ceil(((a1 - a0) / kPi) * ncap)), 2), ncap);
+    for (int i = 0; i < n; ++i) {
+      float u = i / float(n - 1);
+      float a = a0 + u * (a1 - a0);
+      float lx = p1->x + std::cos(a) * lw;
+      float ly = p1->y + std::sin(a) * lw;
+      vset(dst++, lx, ly, lu, 1);
+      vset(dst++, p1->x, p1->y, 0.5f, 1);
+    }
+
+    vset(dst++, p1->x + dlx1 * rw, p1->y + dly1 * rw, lu, 1);
+    vset(dst++, rx1, ry1, ru, 1);
+  }
+  return dst;
+}
+
+NVGvertex *bevelJoin(NVGvertex *dst, const Point *p0, const Point *p1, float lw, float rw,
+                     float lu, float ru) {
+  float rx0, ry0, rx1, ry1;
+  float lx0, ly0, lx1, ly1;
+  float dlx0 = p0->dy, dly0 = -p0->dx;
+  float dlx1 = p1->dy, dly1 = -p1->dx;
+
+  if (p1->flags & Tessellator::PT_LEFT) {
+    chooseBevel(p1->flags & Tessellator::PT_INNERBEVEL, p0, p1, lw, &lx0, &ly0, &lx1, &ly1);
+
+    vset(dst++, lx0, ly0, lu, 1);
+    vset(dst++, p1->x - dlx0 * rw, p1->y - dly0 * rw, ru, 1);
+
+    if (p1->flags & Tessellator::PT_BEVEL) {
+      vset(dst++, lx0, ly0, lu, 1);
+      vset(dst++, p1->x - dlx0 * rw, p1->y - dly0 * rw, ru, 1);
+
+      vset(dst++, lx1, ly1, lu, 1);
+      vset(dst++, p1->x - dlx1 * rw, p1->y - dly1 * rw, ru, 1);
+    } else {
+      rx0 = p1->x - p1->dmx * rw;
+      ry0 = p1->y - p1->dmy * rw;
+
+      vset(dst++, p1->x, p1->y, 0.5f, 1);
+      vset(dst++, p1->x - dlx0 * rw, p1->y - dly0 * rw, ru, 1);
+
+      vset(dst++, rx0, ry0, ru, 1);
+      vset(dst++, rx0, ry0, ru, 1);
+
+      vset(dst++, p1->x, p1->y, 0.5f, 1);
+      vset(dst++, p1->x - dlx1 * rw, p1->y - dly1 * rw, ru, 1);
+    }
+
+    vset(dst++, lx1, ly1, lu, 1);
+    vset(dst++, p1->x - dlx1 * rw, p1->y - dly1 * rw, ru, 1);
+  } else {
+    chooseBevel(p1->flags & Tessellator::PT_INNERBEVEL, p0, p1, -rw, &rx0, &ry0, &rx1, &ry1);
+
+    vset(dst++, p1->x + dlx0 * lw, p1->y + dly0 * lw, lu, 1);
+    vset(dst++, rx0, ry0, ru, 1);
+
+    if (p1->flags & Tessellator::PT_BEVEL) {
+      vset(dst++, p1->x + dlx0 * lw, p1->y + dly0 * lw, lu, 1);
+      vset(dst++, rx0, ry0, ru, 1);
+
+      vset(dst++, p1->x + dlx1 * lw, p1->y + dly1 * lw, lu, 1);
+      vset(dst++, rx1, ry1, ru, 1);
+    } else {
+      lx0 = p1->x + p1->dmx * lw;
+      ly0 = p1->y + p1->dmy * lw;
+
+      vset(dst++, p1->x + dlx0 * lw, p1->y + dly0 * lw, lu, 1);
+      vset(dst++, p1->x, p1->y, 0.5f, 1);
+
+      vset(dst++, lx0, ly0, lu, 1);
+      vset(dst++, lx0, ly0, lu, 1);
+
+      vset(dst++, p1->x + dlx1 * lw, p1->y + dly1 * lw, lu, 1);
+      vset(dst++, p1->x, p1->y, 0.5f, 1);
+    }
+
+    vset(dst++, p1->x + dlx1 * lw, p1->y + dly1 * lw, lu, 1);
+    vset(dst++, rx1, ry1, ru, 1);
+  }
+  return dst;
+}
+
+NVGvertex *buttCapStart(NVGvertex *dst, const Point *p, float dx, float dy, float w, float d,
+                        float aa, float u0, float u1) {
+  float px = p->x - dx * d, py = p->y - dy * d;
+  float dlx = dy, dly = -dx;
+  vset(dst++, px + dlx * w - dx * aa, py + dly * w - dy * aa, u0, 0);
+  vset(dst++, px - dlx * w - dx * aa, py - dly * w - dy * aa, u1, 0);
+  vset(dst++, px + dlx * w, py + dly * w, u0, 1);
+  vset(dst++, px - dlx * w, py - dly * w, u1, 1);
+  return dst;
+}
+
+NVGvertex *buttCapEnd(NVGvertex *dst, const Point *p, float dx, float dy, float w, float d,
+                      float aa, float u0, float u1) {
+  float px = p->x + dx * d, py = p->y + dy * d;
+  float dlx = dy, dly = -dx;
+  vset(dst++, px + dlx * w, py + dly * w, u0, 1);
+  vset(dst++, px - dlx * w, py - dly * w, u1, 1);
+  vset(dst++, px + dlx * w + dx * aa, py + dly * w + dy * aa, u0, 0);
+  vset(dst++, px - dlx * w + dx * aa, py - dly * w + dy * aa, u1, 0);
+  return dst;
+}
+
+NVGvertex *roundCapStart(NVGvertex *dst, const Point *p, float dx, float dy, float w, int ncap,
+                         float u0, float u1) {
+  float px = p->x, py = p->y;
+  float dlx = dy, dly = -dx;
+  for (int i = 0; i < ncap; ++i) {
+    float a = i / float(ncap - 1) * kPi;
+    float ax = std::cos(a) * w, ay = std::sin(a) * w;
+    vset(dst++, px - dlx * ax - dx * ay, py - dly * ax - dy * ay, u0, 1);
+    vset(dst++, px, py, 0.5f, 1);
+  }
+  vset(dst++, px + dlx * w, py + dly * w, u0, 1);
+  vset(dst++, px - dlx * w, py - dly * w, u1, 1);
+  return dst;
+}
+
+NVGvertex *roundCapEnd(NVGvertex *dst, const Point *p, float dx, float dy, float w, int ncap,
+                       float u0, float u1) {
+  float px = p->x, py = p->y;
+  float dlx = dy, dly = -dx;
+  vset(dst++, px + dlx * w, py + dly * w, u0, 1);
+  vset(dst++, px - dlx * w, py - dly * w, u1, 1);
+  for (int i = 0; i < ncap; ++i) {
+    float a = i / float(ncap - 1) * kPi;
+    float ax = std::cos(a) * w, ay = std::sin(a) * w;
+    vset(dst++, px, py, 0.5f, 1);
+    vset(dst++, px - dlx * ax + dx * ay, py - dly * ax + dy * ay, u0, 1);
+  }
+  return dst;
+}
+
+// The stroke around p1, which follows p0, as expandStroke() makes it.
+NVGvertex *strokeJoin(NVGvertex *dst, const Point *p0, const Point *p1, float w, float u0,
+                      float u1, int ncap, int lineJoin) {
+  if ((p1->flags & (Tessellator::PT_BEVEL | Tessellator::PT_INNERBEVEL)) != 0) {
+    if (lineJoin == NVG_ROUND) return roundJoin(dst, p0, p1, w, w, u0, u1, ncap);
+    return bevelJoin(dst, p0, p1, w, w, u0, u1);
+  }
+  vset(dst++, p1->x + (p1->dmx * w), p1->y + (p1->dmy * w), u0, 1);
+  vset(dst++, p1->x - (p1->dmx * w), p1->y - (p1->dmy * w), u1, 1);
+  return dst;
+}
+
+// The cap at p0 of a stroke starting from p0 towards p1.
+NVGvertex *strokeCapStart(NVGvertex *dst, const Point *p0, const Point *p1, float w, float aa,
+                          int lineCap, int ncap, float u0, float u1) {
+  float dx = p1->x - p0->x, dy = p1->y - p0->y;
+  normalize(dx, dy);
+  if (lineCap == NVG_BUTT) return buttCapStart(dst, p0, dx, dy, w, -aa * 0.5f, aa, u0, u1);
+  if (lineCap == NVG_SQUARE) return buttCapStart(dst, p0, dx, dy, w, w - aa, aa, u0, u1);
+  if (lineCap == NVG_ROUND) return roundCapStart(dst, p0, dx, dy, w, ncap, u0, u1);
+  return dst;
+}
+
+// The cap at p1 of a stroke ending at p1 coming from p0.
+NVGvertex *strokeCapEnd(NVGvertex *dst, const Point *p0, const Point *p1, float w, float aa,
+                        int lineCap, int ncap, float u0, float u1) {
+  float dx = p1->x - p0->x, dy = p1->y - p0->y;
+  normalize(dx, dy);
+  if (lineCap == NVG_BUTT) return buttCapEnd(dst, p1, dx, dy, w, -aa * 0.5f, aa, u0, u1);
+  if (lineCap == NVG_SQUARE) return buttCapEnd(dst, p1, dx, dy, w, w - aa, aa, u0, u1);
+  if (lineCap == NVG_ROUND) return roundCapEnd(dst, p1, dx, dy, w, ncap, u0, u1);
+  return dst;
+}
+
+// Sets up a point of a polyline of line segments, heading to the next point at (nx, ny).
+void setLinePoint(Point &p, float x, float y, float nx, float ny) {
+  p.x = x;
+  p.y = y;
+  p.dx = nx - x;
+  p.dy = ny - y;
+  p.len = normalize(p.dx, p.dy);
+  p.flags = Tessellator::PT_CORNER;
+}
+
+} // anon
+
+float getAverageScale(const float *t) {
+  float sx = std::sqrt(t[0] * t[0] + t[2] * t[2]);
+  float sy = std::sqrt(t[1] * t[1] + t[3] * t[3]);
+  return (sx + sy) * 0.5f;
+}
+
+void transformCommands(float *dst, const float *src, size_t count, const float *t) {
+  for (size_t i = 0; i < count;) {
+    int cmd = int(src[i]);
+    int npts = cmd == Tessellator::BEZIERTO ? 3 :
+               cmd == Tessellator::MOVETO || cmd == Tessellator::LINETO ? 1 : 0;
+    dst[i] = src[i];
+    ++i;
+    for (int j = 0; j < npts; ++j, i += 2) {
+      float x = src[i], y = src[i + 1];
+      dst[i] = x * t[0] + y * t[2] + t[4];
+      dst[i + 1] = x * t[1] + y * t[3] + t[5];
+    }
+    if (cmd == Tessellator::WINDING) {
+      dst[i] = src[i];
+      ++i;
+    }
+  }
+}
+
+const float *findEndPoint(const float *commands, size_t count) {
+  const float *point = nullptr;
+  for (size_t i = 0; i < count;) {
+    int cmd = int(commands[i]);
+    size_t n = cmd == Tessellator::BEZIERTO ? 7 :
+               cmd == Tessellator::MOVETO || cmd == Tessellator::LINETO ? 3 :
+               cmd == Tessellator::WINDING ? 2 : 1;
+    if (n >= 3) point = commands + i + n - 2;
+    i += n;
+  }
+  return point;
+}
+
+void transformVertices(NVGvertex *dst, const NVGvertex *src, size_t count, const float *t) {
+  size_t i = 0;
+
+#ifdef CI_NVG_SSE2
+  // One vertex per iteration: [x y u v] * [a d 1 1] + [y x u v] * [c b 0 0] + [e f 0 0].
+  static_assert(sizeof(NVGvertex) == 4 * sizeof(float), "NVGvertex is x, y, u, v");
+  const __m128 m0 = _mm_setr_ps(t[0], t[3], 1.0f, 1.0f);
+  const __m128 m1 = _mm_setr_ps(t[2], t[1], 0.0f, 0.0f);
+  const __m128 tr = _mm_setr_ps(t[4], t[5], 0.0f, 0.0f);
+  for (; i < count; ++i) {
+    __m128 p = _mm_loadu_ps(&src[i].x);
+    __m128 s = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 2, 0, 1));
+    __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, m0), _mm_mul_ps(s, m1)), tr);
+    _mm_storeu_ps(&dst[i].x, r);
+  }
+#endif
+
+  for (; i < count; ++i) {
+    const NVGvertex v = src[i];
+    vset(&dst[i], v.x * t[0] + v.y * t[2] + t[4], v.x * t[1] + v.y * t[3] + t[5], v.u, v.v);
+  }
+}
+
+void transformLineCommands(float *dst, const float *pts, size_t count, const float *t) {
+  const float cmd = float(Tessellator::LINETO);
+  size_t i = 0;
+
+#ifdef CI_NVG_SSE2
+  // Two points per iteration: [x0 y0 x1 y1] * [a d a d] + [y0 x0 y1 x1] * [c b c b] + [e f e f].
+  const __m128 m0 = _mm_setr_ps(t[0], t[3], t[0], t[3]);
+  const __m128 m1 = _mm_setr_ps(t[2], t[1], t[2], t[1]);
+  const __m128 tr = _mm_setr_ps(t[4], t[5], t[4], t[5]);
+  for (; i + 2 <= count; i += 2, pts += 4, dst += 6) {
+    __m128 p = _mm_loadu_ps(pts);
+    __m128 s = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, m0), _mm_mul_ps(s, m1)), tr);
+    dst[0] = cmd;
+    _mm_storel_pi(reinterpret_cast<__m64 *>(dst + 1), r);
+    dst[3] = cmd;
+    _mm_storeh_pi(reinterpret_cast<__m64 *>(dst + 4), r);
+  }
+#endif
+
+  for (; i < count; ++i, pts += 2, dst += 3) {
+    float x = pts[0], y = pts[1];
+    dst[0] = cmd;
+    dst[1] = x * t[0] + y * t[2] + t[4];
+    dst[2] = x * t[1] + y * t[3] + t[5];
+  }
+}
+
+void findMinMax(const float *values, size_t count, size_t &minIndex, size_t &maxIndex) {
+  float lo = values[0], hi = values[0];
+  size_t i = 1;
+  minIndex = maxIndex = 0;
+
+#ifdef CI_NVG_SSE2
+  // Four lanes keep their own first lowest and highest value with its index.
+  if (count >= 8 && count <= size_t(INT32_MAX)) {
+    __m128 vlo = _mm_loadu_ps(values), vhi = vlo;
+    __m128i idx = _mm_setr_epi32(0, 1, 2, 3), ilo = idx, ihi = idx;
+    const __m128i four = _mm_set1_epi32(4);
+    for (i = 4; i + 4 <= count; i += 4) {
+      __m128 v = _mm_loadu_ps(values + i);
+      idx = _mm_add_epi32(idx, four);
+      __m128 lt = _mm_cmplt_ps(v, vlo), gt = _mm_cmpgt_ps(v, vhi);
+      vlo = _mm_or_ps(_mm_and_ps(lt, v), _mm_andnot_ps(lt, vlo));
+      vhi = _mm_or_ps(_mm_and_ps(gt, v), _mm_andnot_ps(gt, vhi));
+      __m128i ilt = _mm_castps_si128(lt), igt = _mm_castps_si128(gt);
+      ilo = _mm_or_si128(_mm_and_si128(ilt, idx), _mm_andnot_si128(ilt, ilo));
+      ihi = _mm_or_si128(_mm_and_si128(igt, idx), _mm_andnot_si128(igt, ihi));
+    }
+
+    float los[4], his[4];
+    int32_t ilos[4], ihis[4];
+    _mm_storeu_ps(los, vlo);
+    _mm_storeu_ps(his, vhi);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ilos), ilo);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ihis), ihi);
+    lo = los[0];
+    hi = his[0];
+    minIndex = size_t(ilos[0]);
+    maxIndex = size_t(ihis[0]);
+    for (int lane = 1; lane < 4; ++lane) {
+      if (los[lane] < lo || (los[lane] == lo && size_t(ilos[lane]) < minIndex)) {
+        lo = los[lane];
+        minIndex = size_t(ilos[lane]);
+      }
+      if (his[lane] > hi || (his[lane] == hi && size_t(ihis[lane]) < maxIndex)) {
+        hi = his[lane];
+        maxIndex = size_t(ihis[lane]);
+      }
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    if (values[i] < lo) {
+      lo = values[i];
+      minIndex = i;
+    }
+    if (values[i] > hi) {
+      hi = values[i];
+      maxIndex = i;
+    }
+  }
+}
+
+// Tessellation //
+
+Tessellation::Tessellation(Tessellation &&other)
+: verts{ std::move(other.verts) }, paths{ std::move(other.paths) } {
+  std::copy(other.bounds, other.bounds + 4, bounds);
+}
+
+Tessellation &Tessellation::operator=(Tessellation &&other) {
+  verts = std::move(other.verts);
+  paths = std::move(other.paths);
+  std::copy(other.bounds, other.bounds + 4, bounds);
+  return *this;
+}
+
+void Tessellation::assign(const Tessellator &tess) {
+  const NVGvertex *src = tess.getVerts();
+  verts.assign(src, src + tess.getNumVerts());
+  paths.assign(tess.getPaths(), tess.getPaths() + tess.getNumPaths());
+  for (auto &path : paths) {
+    if (path.fill) path.fill = verts.data() + (path.fill - src);
+    if (path.stroke) path.stroke = verts.data() + (path.stroke - src);
+  }
+  std::copy(tess.getBounds(), tess.getBounds() + 4, bounds);
+}
+
+void Tessellation::assign(const Tessellation &src, const float *t) {
+  verts.resize(src.verts.size());
+  transformVertices(verts.data(), src.verts.data(), verts.size(), t);
+
+  paths.assign(src.paths.begin(), src.paths.end());
+  for (auto &path : paths) {
+    if (path.fill) path.fill = verts.data() + (path.fill - src.verts.data());
+    if (path.stroke) path.stroke = verts.data() + (path.stroke - src.verts.data());
+  }
+
+  // Transform the corners of the source bounds, so the result still contains every vertex.
+  const float *b = src.bounds;
+  const float corners[8] = { b[0], b[1], b[2], b[1], b[2], b[3], b[0], b[3] };
+  bounds[0] = bounds[1] = 1e6f;
+  bounds[2] = bounds[3] = -1e6f;
+  for (int i = 0; i < 8; i += 2) {
+    float x = corners[i] * t[0] + corners[i + 1] * t[2] + t[4];
+    float y = corners[i] * t[1] + corners[i + 1] * t[3] + t[5];
+    bounds[0] = std::min(bounds[0], x);
+    bounds[1] = std::min(bounds[1], y);
+    bounds[2] = std::max(bounds[2], x);
+    bounds[3] = std::max(bounds[3], y);
+  }
+}
+
+size_t Tessellation::getNumBytes() const {
+  return sizeof(*this) + verts.capacity() * sizeof(NVGvertex) + paths.capacity() * sizeof(NVGpath);
+}
+
+// Tessellator //
+
+Tessellator::Tessellator(Tessellator &&other)
+: mTessTol{ other.mTessTol }, mDistTol{ other.mDistTol }, mFringeWidth{ other.mFringeWidth },
+  mPoints{ std::move(other.mPoints) }, mPaths{ std::move(other.mPaths) },
+  mVerts{ std::move(other.mVerts) }, mNumVerts{ other.mNumVerts } {
+  std::copy(other.mBounds, other.mBounds + 4, mBounds);
+}
+
+void Tessellator::setDevicePixelRatio(float ratio) {
+  mTessTol = 0.25f / ratio;
+  mDistTol = 0.01f / ratio;
+  mFringeWidth = 1.0f / ratio;
+}
+
+void Tessellator::addPath() {
+  NVGpath path = {};
+  path.first = int(mPoints.size());
+  path.winding = NVG_CCW;
+  mPaths.push_back(path);
+}
+
+void Tessellator::addPoint(float x, float y, int flags) {
+  if (mPaths.empty()) return;
+  auto &path = mPaths.back();
+
+  if (path.count > 0 && !mPoints.empty()) {
+    auto &last = mPoints.back();
+    if (ptEquals(last.x, last.y, x, y, mDistTol)) {
+      last.flags |= uint8_t(flags);
+      return;
+    }
+  }
+
+  Point pt = {};
+  pt.x = x;
+  pt.y = y;
+  pt.flags = uint8_t(flags);
+  mPoints.push_back(pt);
+  path.count++;
+}
+
+void Tessellator::tessellateBezier(float x1, float y1, float x2, float y2, float x3, float y3,
+                                   float x4, float y4, int level, int type) {
+  if (level > 10) return;
+
+  float x12 = (x1 + x2) * 0.5f, y12 = (y1 + y2) * 0.5f;
+  float x23 = (x2 + x3) * 0.5f, y23 = (y2 + y3) * 0.5f;
+  float x34 = (x3 + x4) * 0.5f, y34 = (y3 + y4) * 0.5f;
+  float x123 = (x12 + x23) * 0.5f, y123 = (y12 + y23) * 0.5f;
+
+  float dx = x4 - x1, dy = y4 - y1;
+  float d2 = std::abs((x2 - x4) * dy - (y2 - y4) * dx);
+  float d3 = std::abs((x3 - x4) * dy - (y3 - y4) * dx);
+
+  if ((d2 + d3) * (d2 + d3) < mTessTol * (dx * dx + dy * dy)) {
+    addPoint(x4, y4, type);
+    return;
+  }
+
+  float x234 = (x23 + x34) * 0.5f, y234 = (y23 + y34) * 0.5f;
+  float x1234 = (x123 + x234) * 0.5f, y1234 = (y123 + y234) * 0.5f;
+
+  tessellateBezier(x1, y1, x12, y12, x123, y123, x1234, y1234, level + 1, 0);
+  tessellateBezier(x1234, y1234, x234, y234, x34, y34, x4, y4, level + 1, type);
+}
+
+void Tessellator::flatten(const float *commands, size_t count) {
+  mPoints.clear();
+  mPaths.clear();
+  mNumVerts = 0;
+
+  for (size_t i = 0; i < count;) {
+    const float *p = commands + i + 1;
+    switch (int(commands[i])) {
+      case MOVETO:
+        addPath();
+        addPoint(p[0], p[1], PT_CORNER);
+        i += 3;
+        break;
+      case LINETO:
+        addPoint(p[0], p[1], PT_CORNER);
+        i += 3;
+        break;
+      case BEZIERTO:
+        if (!mPoints.empty() && !mPaths.empty()) {
+          const auto &last = mPoints.back();
+          tessellateBezier(last.x, last.y, p[0], p[1], p[2], p[3], p[4], p[5], 0, PT_CORNER);
+        }
+        i += 7;
+        break;
+      case CLOSE:
+        if (!mPaths.empty()) mPaths.back().closed = 1;
+        i += 1;
+        break;
+      case WINDING:
+        if (!mPaths.empty()) mPaths.back().winding = int(p[0]);
+        i += 2;
+        break;
+      default:
+        i += 1;
+        break;
+    }
+  }
+
+  mBounds[0] = mBounds[1] = 1e6f;
+  mBounds[2] = mBounds[3] = -1e6f;
+
+  // Calculate the direction and length of line segments.
+  for (auto &path : mPaths) {
+    Point *pts = &mPoints[path.first];
+
+    // If the first and last points are the same, remove the last, mark as closed path.
+    Point *p0 = &pts[path.count - 1];
+    Point *p1 = &pts[0];
+    if (ptEquals(p0->x, p0->y, p1->x, p1->y, mDistTol)) {
+      path.count--;
+      p0 = &pts[path.count - 1];
+      path.closed = 1;
+    }
+
+    // Enforce winding.
+    if (path.count > 2) {
+      float area = polyArea(pts, path.count);
+      if ((path.winding == NVG_CCW && area < 0.0f) || (path.winding == NVG_CW && area > 0.0f)) {
+        std::reverse(pts, pts + path.count);
+      }
+    }
+
+    for (int i = 0; i < path.count; ++i) {
+      p0->dx = p1->x - p0->x;
+      p0->dy = p1->y - p0->y;
+      p0->len = normalize(p0->dx, p0->dy);
+
+      mBounds[0] = std::min(mBounds[0], p0->x);
+      mBounds[1] = std::min(mBounds[1], p0->y);
+      mBounds[2] = std::max(mBounds[2], p0->x);
+      mBounds[3] = std::max(mBounds[3], p0->y);
+
+      p0 = p1++;
+    }
+  }
+}
+
+void Tessellator::calculateJoins(float w, int lineJoin, float miterLimit) {
+  float iw = w > 0.0f ? 1.0f / w : 0.0f;
+
+  // Calculate which joins needs extra vertices to append, and gather vertex count.
+  for (auto &path : mPaths) {
+    Point *pts = &mPoints[path.first];
+    Point *p0 = &pts[path.count - 1];
+    Point *p1 = &pts[0];
+    int nleft = 0;
+
+    path.nbevel = 0;
+
+    for (int j = 0; j < path.count; ++j) {
+      calculateJoin(p0, p1, iw, lineJoin, miterLimit);
+
+      if (p1->flags & PT_LEFT) nleft++;
+      if ((p1->flags & (PT_BEVEL | PT_INNERBEVEL)) != 0) path.nbevel++;
+
+      p0 = p1++;
+    }
+
+    path.convex = (nleft == path.count) ? 1 : 0;
+  }
+}
+
+NVGvertex *Tessellator::allocVerts(size_t count) {
+  if (mVerts.size() < count) mVerts.resize(count);
+  return mVerts.data();
+}
+
+void Tessellator::expandFill(float w, int lineJoin, float miterLimit) {
+  float aa = mFringeWidth;
+  bool fringe = w > 0.0f;
+
+  calculateJoins(w, lineJoin, miterLimit);
+
+  // Calculate max vertex usage.
+  size_t cverts = 0;
+  for (const auto &path : mPaths) {
+    cverts += path.count + path.nbevel + 1;
+    if (fringe) cverts += (path.count + path.nbevel * 5 + 1) * 2; // plus one for loop
+  }
+
+  NVGvertex *verts = allocVerts(cverts), *base = verts;
+  bool convex = mPaths.size() == 1 && mPaths[0].convex;
+
+  for (auto &path : mPaths) {
+    Point *pts = &mPoints[path.first];
+    Point *p0, *p1;
+
+    // Calculate shape vertices.
+    float woff = 0.5f * aa;
+    NVGvertex *dst = verts;
+    path.fill = dst;
+
+    if (fringe) {
+      // Looping
+      p0 = &pts[path.count - 1];
+      p1 = &pts[0];
+      for (int j = 0; j < path.count; ++j) {
+        if (p1->flags & PT_BEVEL) {
+          float dlx0 = p0->dy, dly0 = -p0->dx;
+          float dlx1 = p1->dy, dly1 = -p1->dx;
+          if (p1->flags & PT_LEFT) {
+            vset(dst++, p1->x + p1->dmx * woff, p1->y + p1->dmy * woff, 0.5f, 1);
+          } else {
+            vset(dst++, p1->x + dlx0 * woff, p1->y + dly0 * woff, 0.5f, 1);
+            vset(dst++, p1->x + dlx1 * woff, p1->y + dly1 * woff, 0.5f, 1);
+          }
+        } else {
+          vset(dst++, p1->x + p1->dmx * woff, p1->y + p1->dmy * woff, 0.5f, 1);
+        }
+        p0 = p1++;
+      }
+    } else {
+      for (int j = 0; j < path.count; ++j) {
+        vset(dst++, pts[j].x, pts[j].y, 0.5f, 1);
+      }
+    }
+
+    path.nfill = int(dst - verts);
+    verts = dst;
+
+    // Calculate fringe
+    if (fringe) {
+      float lw = w + woff, rw = w - woff;
+      float lu = 0, ru = 1;
+      dst = verts;
+      path.stroke = dst;
+
+      // Create only half a fringe for convex shapes so that the shape can be rendered without
+      // stenciling.
+      if (convex) {
+        lw = woff; // This should generate the same vertex as fill inset above.
+        lu = 0.5f; // Set outline fade at middle.
+      }
+
+      // Looping
+      p0 = &pts[path.count - 1];
+      p1 = &pts[0];
+
+      for (int j = 0; j < path.count; ++j) {
+        if ((p1->flags & (PT_BEVEL | PT_INNERBEVEL)) != 0) {
+          dst = bevelJoin(dst, p0, p1, lw, rw, lu, ru);
+        } else {
+          vset(dst++, p1->x + (p1->dmx * lw), p1->y + (p1->dmy * lw), lu, 1);
+          vset(dst++, p1->x - (p1->dmx * rw), p1->y - (p1->dmy * rw), ru, 1);
+        }
+        p0 = p1++;
+      }
+
+      // Loop it
+      vset(dst++, verts[0].x, verts[0].y, lu, 1);
+      vset(dst++, verts[1].x, verts[1].y, ru, 1);
+
+      path.nstroke = int(dst - verts);
+      verts = dst;
+    } else {
+      path.stroke = nullptr;
+      path.nstroke = 0;
+    }
+  }
+
+  mNumVerts = size_t(verts - base);
+}
+
+void Tessellator::expandStroke(float w, float fringe, int lineCap, int lineJoin,
+                               float miterLimit) {
+  float aa = fringe;
+  float u0 = 0.0f, u1 = 1.0f;
+  int ncap = curveDivs(w, kPi, mTessTol); // Calculate divisions per half circle.
+
+  w += aa * 0.5f;
+
+  // Disable the gradient used for antialiasing when antialiasing is not used.
+  if (aa == 0.0f) {
+    u0 = 0.5f;
+    u1 = 0.5f;
+  }
+
+  calculateJoins(w, lineJoin, miterLimit);
+
+  // Calculate max vertex usage.
+  size_t cverts = 0;
+  for (const auto &path : mPaths) {
+    if (lineJoin == NVG_ROUND) {
+      cverts += (path.count + path.nbevel * (ncap + 2) + 1) * 2; // plus one for loop
+    } else {
+      cverts += (path.count + path.nbevel * 5 + 1) * 2; // plus one for loop
+    }
+    if (!path.closed) {
+      // space for caps
+      cverts += lineCap == NVG_ROUND ? (ncap * 2 + 2) * 2 : (3 + 3) * 2;
+    }
+  }
+
+  NVGvertex *verts = allocVerts(cverts), *base = verts;
+
+  for (auto &path : mPaths) {
+    Point *pts = &mPoints[path.first];
+    Point *p0, *p1;
+    int s, e;
+    bool loop = path.closed != 0;
+
+    path.fill = nullptr;
+    path.nfill = 0;
+
+    // Calculate fringe or stroke
+    NVGvertex *dst = verts;
+    path.stroke = dst;
+
+    if (loop) {
+      // Looping
+      p0 = &pts[path.count - 1];
+      p1 = &pts[0];
+      s = 0;
+      e = path.count;
+    } else {
+      // Add cap
+      p0 = &pts[0];
+      p1 = &pts[1];
+      s = 1;
+      e = path.count - 1;
+
+      dst = strokeCapStart(dst, p0, p1, w, aa, lineCap, ncap, u0, u1);
+    }
+
+    for (int j = s; j < e; ++j) {
+      dst = strokeJoin(dst, p0, p1, w, u0, u1, ncap, lineJoin);
+      p0 = p1++;
+    }
+
+    if (loop) {
+      // Loop it
+      vset(dst++, verts[0].x, verts[0].y, u0, 1);
+      vset(dst++, verts[1].x, verts[1].y, u1, 1);
+    } else {
+      // Add cap
+      dst = strokeCapEnd(dst, p0, p1, w, aa, lineCap, ncap, u0, u1);
+    }
+
+    path.nstroke = int(dst - verts);
+    verts = dst;
+  }
+
+  mNumVerts = size_t(verts - base);
+}
+
+void Tessellator::appendStrokeCap(const float *pts, bool start, float w, float fringe,
+                                  int lineCap, std::vector<NVGvertex> &out) const {
+  float aa = fringe;
+  int ncap = curveDivs(w, kPi, mTessTol);
+  float u0 = aa == 0.0f ? 0.5f : 0.0f, u1 = aa == 0.0f ? 0.5f : 1.0f;
+  w += aa * 0.5f;
+
+  Point p0, p1;
+  setLinePoint(p0, pts[0], pts[1], pts[2], pts[3]);
+  setLinePoint(p1, pts[2], pts[3], pts[2], pts[3]);
+
+  size_t size = out.size();
+  out.resize(size + ncap * 2 + 2);
+  NVGvertex *dst = out.data() + size;
+  if (start) {
+    dst = strokeCapStart(dst, &p0, &p1, w, aa, lineCap, ncap, u0, u1);
+  } else {
+    dst = strokeCapEnd(dst, &p0, &p1, w, aa, lineCap, ncap, u0, u1);
+  }
+  out.resize(size_t(dst - out.data()));
+}
+
+void Tessellator::appendStrokeJoin(const float *pts, float w, float fringe, int lineJoin,
+                                   float miterLimit, std::vector<NVGvertex> &out) const {
+  float aa = fringe;
+  int ncap = curveDivs(w, kPi, mTessTol);
+  float u0 = aa == 0.0f ? 0.5f : 0.0f, u1 = aa == 0.0f ? 0.5f : 1.0f;
+  w += aa * 0.5f;
+
+  Point p0, p1;
+  setLinePoint(p0, pts[0], pts[1], pts[2], pts[3]);
+  setLinePoint(p1, pts[2], pts[3], pts[4], pts[5]);
+  calculateJoin(&p0, &p1, w > 0.0f ? 1.0f / w : 0.0f, lineJoin, miterLimit);
+
+  size_t size = out.size();
+  out.resize(size + (lineJoin == NVG_ROUND ? (ncap + 2) * 2 : 12));
+  NVGvertex *dst = strokeJoin(out.data() + size, &p0, &p1, w, u0, u1, ncap, lineJoin);
+  out.resize(size_t(dst - out.data()));
+}
+
+}} // cinder::nvg
@@ -0,0 +1,101 @@
+#include "TextLayout.hpp"
+#include "ci_nanovg.hpp"
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+const int kHorizontalAlign = NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT;
+
+} // anon
+
+TextLayout::TextLayout(Context &ctx, const Style &style, const std::string &text,
+                       float breakWidth)
+: mStyle{ style }, mText{ text }, mBreakWidth{ breakWidth } {
+  NVGcontext *vg = ctx.get();
+  const char *str = mText.c_str(), *end = str + mText.size();
+  int halign = style.align & kHorizontalAlign;
+  int valign = style.align & ~kHorizontalAlign;
+
+  nvgSave(vg);
+  nvgResetTransform(vg);
+  nvgFontFaceId(vg, style.font.id);
+  nvgFontSize(vg, style.size);
+  nvgTextLetterSpacing(vg, style.letterSpacing);
+  nvgTextLineHeight(vg, style.lineHeight);
+  nvgTextAlign(vg, style.align);
+
+  if (breakWidth > 0.0f) {
+    // Same rows and offsets as nvgTextBox.
+    nvgTextBoxBounds(vg, 0.0f, 0.0f, breakWidth, str, end, &mBounds.x1);
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | valign);
+
+    float lineh;
+    nvgTextMetrics(vg, NULL, NULL, &lineh);
+
+    NVGtextRow rows[16];
+    float y = 0.0f;
+    int nrows;
+    while ((nrows = nvgTextBreakLines(vg, str, end, breakWidth, rows, 16)) > 0) {
+      for (int i = 0; i < nrows; ++i) {
+        const auto &row = rows[i];
+        float x = halign & NVG_ALIGN_CENTER ? breakWidth * 0.5f - row.width * 0.5f :
+                  halign & NVG_ALIGN_RIGHT ? breakWidth - row.width : 0.0f;
+        addRow(vg, row.start, row.end, x, y, row.width);
+        y += lineh * style.lineHeight;
+      }
+      str = rows[nrows - 1].next;
+    }
+  } else if (str != end) {
+    // Resolve the horizontal alignment up front so rows are always drawn left aligned.
+    float width = nvgTextBounds(vg, 0.0f, 0.0f, str, end, &mBounds.x1);
+    float x = halign & NVG_ALIGN_CENTER ? -width * 0.5f :
+              halign & NVG_ALIGN_RIGHT ? -width : 0.0f;
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | valign);
+    addRow(vg, str, end, x, 0.0f, width);
+  }
+
+  nvgRestore(vg);
+}
+
+TextLayout::TextLayout(TextLayout &&other)
+: mStyle{ other.mStyle }, mText{ std::move(other.mText) }, mBreakWidth{ other.mBreakWidth },
+  mRows{ std::move(other.mRows) }, mGlyphs{ std::move(other.mGlyphs) },
+  mBounds{ other.mBounds } {}
+
+TextLayout &TextLayout::operator=(TextLayout &&other) {
+  mStyle = other.mStyle;
+  mText = std::move(other.mText);
+  mBreakWidth = other.mBreakWidth;
+  mRows = std::move(other.mRows);
+  mGlyphs = std::move(other.mGlyphs);
+  mBounds = other.mBounds;
+  return *this;
+}
+
+void TextLayout::addRow(NVGcontext *vg, const char *begin, const char *end, float x, float y,
+                        float width) {
+  const char *str = mText.c_str();
+
+  Row row;
+  row.begin = uint32_t(begin - str);
+  row.end = uint32_t(end - str);
+  row.glyphBegin = uint32_t(mGlyphs.size());
+  row.x = x;
+  row.y = y;
+  row.width = width;
+
+  // There are never more glyphs than bytes.
+  std::vector<NVGglyphPosition> positions(end - begin);
+  int count = nvgTextGlyphPositions(vg, x, y, begin, end, positions.data(), int(positions.size()));
+  for (int i = 0; i < count; ++i) {
+    const auto &pos = positions[i];
+    Glyph glyph = { uint32_t(pos.str - str), pos.x, pos.minx, pos.maxx };
+    mGlyphs.push_back(glyph);
+  }
+
+  row.glyphEnd = uint32_t(mGlyphs.size());
+  mRows.push_back(row);
+}
+
+}} // cinder::nvg
@@ -0,0 +1,94 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace cinder { namespace nvg {
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  mThreads.reserve(numThreads);
+  for (size_t i = 0; i < numThreads; ++i) {
+    mThreads.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mCondition.notify_all();
+  for (auto &thread : mThreads) thread.join();
+}
+
+void ThreadPool::workerLoop() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+      if (mQueue.empty()) return;
+      task = std::move(mQueue.front());
+      mQueue.pop_front();
+    }
+    task();
+  }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue.push_back(std::move(task));
+  }
+  mCondition.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &fn) {
+  if (count == 0) return;
+  if (count == 1) return fn(0);
+
+  struct Job {
+    std::atomic<size_t> next, remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  auto job = std::make_shared<Job>();
+  job->next = 0;
+  job->remaining = count;
+
+  // NOTE: Helpers that only get scheduled after the work is finished will find no indices left
+  // and return without touching fn, so capturing it by reference is safe.
+  auto work = [job, count, &fn] {
+    for (size_t i; (i = job->next++) < count;) {
+      fn(i);
+      if (--job->remaining == 0) {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done.notify_all();
+      }
+    }
+  };
+
+  size_t numHelpers = std::min(count - 1, mThreads.size());
+  for (size_t i = 0; i < numHelpers; ++i) enqueue(work);
+
+  work();
+
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->done.wait(lock, [&] { return job->remaining == 0; });
+}
+
+void ThreadPool::parallelWorkers(const std::function<void(size_t)> &fn) {
+  parallelFor(mThreads.size() + 1, fn);
+}
+
+ThreadPool &ThreadPool::shared() {
+  static std::once_flag once;
+  static std::unique_ptr<ThreadPool> pool;
+  std::call_once(once, [] { pool.reset(new ThreadPool()); });
+  return *pool;
+}
+
+}} // cinder::nvg
@@ -0,0 +1,576 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace cinder { namespace nvg {
+
+// The file is a header followed by a stream of records, all made of 32-bit little-endian words.
+// Each record starts with its type, and byte data is padded to whole words. Paints, scissors,
+// composite operations and vertices are stored as their nanovg structs, which are all floats and
+// ints. Paths store nfill, nstroke, closed, nbevel, winding and convex, then their fill and stroke
+// vertices.
+
+namespace {
+
+const uint32_t kMagic = 0x5447564e; // "NVGT"
+const uint32_t kVersion = 1;
+
+enum RecordType {
+  RECORD_VIEWPORT,
+  RECORD_CANCEL,
+  RECORD_FLUSH,
+  RECORD_CREATETEXTURE,
+  RECORD_DELETETEXTURE,
+  RECORD_UPDATETEXTURE,
+  RECORD_FILL,
+  RECORD_STROKE,
+  RECORD_TRIANGLES
+};
+
+const size_t kPaintWords = sizeof(NVGpaint) / 4;
+const size_t kCompositeWords = sizeof(NVGcompositeOperationState) / 4;
+const size_t kScissorWords = sizeof(NVGscissor) / 4;
+const size_t kVertexWords = sizeof(NVGvertex) / 4;
+const size_t kStateWords = kPaintWords + kCompositeWords + kScissorWords + 1;
+const size_t kPathWords = 6;
+
+// Records are written out at the end of each frame, or earlier once this many words are pending.
+const size_t kBufferWords = 1 << 20;
+
+size_t numWords(size_t numBytes) {
+  return (numBytes + 3) / 4;
+}
+
+size_t bytesPerPixel(int type) {
+  return type == NVG_TEXTURE_RGBA ? 4 : 1;
+}
+
+template <typename T>
+T read(const std::vector<uint32_t> &words, size_t pos) {
+  T value;
+  std::memcpy(&value, &words[pos], sizeof(T));
+  return value;
+}
+
+std::mutex sCapturesMutex;
+std::vector<std::pair<void *, void *>> sCaptures;
+
+void *findCapture(void *uptr) {
+  std::lock_guard<std::mutex> lock(sCapturesMutex);
+  for (auto &entry : sCaptures) {
+    if (entry.first == uptr) return entry.second;
+  }
+  return nullptr;
+}
+
+} // anon
+
+// Trace Capture //
+
+TraceCapture::TraceCapture(Context &ctx, const fs::path &path)
+: mParams{ ctx.get() ? nvgInternalParams(ctx.get()) : nullptr },
+  mBackend(mParams ? *mParams : NVGparams()) {
+  // A null context has nothing to capture, and the capture stays closed.
+  if (!mParams) return;
+  mFile.open(path.string().c_str(), std::ios::binary);
+  if (!mFile.is_open()) return;
+
+  write(kMagic);
+  write(kVersion);
+  writeToFile();
+
+  {
+    std::lock_guard<std::mutex> lock(sCapturesMutex);
+    sCaptures.emplace_back(mParams->userPtr, this);
+  }
+  mParams->renderCreateTexture = createTextureHook;
+  mParams->renderDeleteTexture = deleteTextureHook;
+  mParams->renderUpdateTexture = updateTextureHook;
+  mParams->renderViewport = viewportHook;
+  mParams->renderCancel = cancelHook;
+  mParams->renderFlush = flushHook;
+  mParams->renderFill = fillHook;
+  mParams->renderStroke = strokeHook;
+  mParams->renderTriangles = trianglesHook;
+}
+
+TraceCapture::~TraceCapture() {
+  if (!mFile.is_open()) return;
+
+  mParams->renderCreateTexture = mBackend.renderCreateTexture;
+  mParams->renderDeleteTexture = mBackend.renderDeleteTexture;
+  mParams->renderUpdateTexture = mBackend.renderUpdateTexture;
+  mParams->renderViewport = mBackend.renderViewport;
+  mParams->renderCancel = mBackend.renderCancel;
+  mParams->renderFlush = mBackend.renderFlush;
+  mParams->renderFill = mBackend.renderFill;
+  mParams->renderStroke = mBackend.renderStroke;
+  mParams->renderTriangles = mBackend.renderTriangles;
+
+  {
+    std::lock_guard<std::mutex> lock(sCapturesMutex);
+    for (auto it = sCaptures.begin(); it != sCaptures.end(); ++it) {
+      if (it->second == this) {
+        sCaptures.erase(it);
+        break;
+      }
+    }
+  }
+  writeToFile();
+}
+
+void TraceCapture::writeBytes(const void *data, size_t numBytes) {
+  write(uint32_t(numBytes));
+  size_t pos = mBuffer.size();
+  mBuffer.resize(pos + numWords(numBytes), 0);
+  if (numBytes) std::memcpy(&mBuffer[pos], data, numBytes);
+}
+
+void TraceCapture::writeState(const NVGpaint *paint,
+                              const NVGcompositeOperationState &compositeOperation,
+                              const NVGscissor *scissor, float fringe) {
+  write(*paint);
+  write(compositeOperation);
+  write(*scissor);
+  write(fringe);
+}
+
+void TraceCapture::writePaths(const NVGpath *paths, int npaths) {
+  write(int32_t(npaths));
+  for (int i = 0; i < npaths; ++i) {
+    const NVGpath &path = paths[i];
+    const int32_t header[kPathWords] = { path.nfill,  path.nstroke, path.closed,
+                                         path.nbevel, path.winding, path.convex };
+    write(header);
+    size_t pos = mBuffer.size();
+    mBuffer.resize(pos + (path.nfill + path.nstroke) * kVertexWords);
+    if (path.nfill) std::memcpy(&mBuffer[pos], path.fill, path.nfill * sizeof(NVGvertex));
+    pos += path.nfill * kVertexWords;
+    if (path.nstroke) std::memcpy(&mBuffer[pos], path.stroke, path.nstroke * sizeof(NVGvertex));
+  }
+}
+
+void TraceCapture::writeToFile() {
+  if (mBuffer.empty()) return;
+  mFile.write(reinterpret_cast<const char *>(mBuffer.data()), mBuffer.size() * 4);
+  mFile.flush();
+  mNumBytes += mBuffer.size() * 4;
+  mBuffer.clear();
+}
+
+void TraceCapture::declareTexture(int image, int type) {
+  Texture texture = { type, 0, 0 };
+  if (!mBackend.renderGetTextureSize(mBackend.userPtr, image, &texture.width, &texture.height)) {
+    return;
+  }
+  mTextures[image] = texture;
+
+  const int32_t args[] = { image, type, texture.width, texture.height, 0 };
+  write(uint32_t(RECORD_CREATETEXTURE));
+  write(args);
+  writeBytes(nullptr, 0);
+}
+
+int TraceCapture::createTextureHook(void *uptr, int type, int w, int h, int imageFlags,
+                                    const unsigned char *data) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  int image = capture->mBackend.renderCreateTexture(uptr, type, w, h, imageFlags, data);
+  if (!image) return image;
+
+  Texture texture = { type, w, h };
+  capture->mTextures[image] = texture;
+
+  const int32_t args[] = { image, type, w, h, imageFlags };
+  capture->write(uint32_t(RECORD_CREATETEXTURE));
+  capture->write(args);
+  capture->writeBytes(data, data ? size_t(w) * h * bytesPerPixel(type) : 0);
+  return image;
+}
+
+int TraceCapture::deleteTextureHook(void *uptr, int image) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  if (capture->mTextures.erase(image)) {
+    capture->write(uint32_t(RECORD_DELETETEXTURE));
+    capture->write(int32_t(image));
+  }
+  return capture->mBackend.renderDeleteTexture(uptr, image);
+}
+
+// Only the updated rows and columns are stored. data holds the whole texture.
+int TraceCapture::updateTextureHook(void *uptr, int image, int x, int y, int w, int h,
+                                    const unsigned char *data) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  // A texture that predates the capture and is updated during it is nearly always the font atlas.
+  if (!capture->mTextures.count(image)) capture->declareTexture(image, NVG_TEXTURE_ALPHA);
+
+  auto it = capture->mTextures.find(image);
+  if (it != capture->mTextures.end() && x >= 0 && y >= 0 && x + w <= it->second.width &&
+      y + h <= it->second.height) {
+    size_t bpp = bytesPerPixel(it->second.type);
+    size_t rowBytes = size_t(w) * bpp, stride = size_t(it->second.width) * bpp;
+
+    const int32_t args[] = { image, x, y, w, h };
+    auto &buffer = capture->mBuffer;
+    capture->write(uint32_t(RECORD_UPDATETEXTURE));
+    capture->write(args);
+    capture->write(uint32_t(rowBytes * h));
+    size_t pos = buffer.size();
+    buffer.resize(pos + numWords(rowBytes * h), 0);
+    auto dst = reinterpret_cast<unsigned char *>(&buffer[pos]);
+    for (int row = 0; row < h; ++row) {
+      std::memcpy(dst + row * rowBytes, data + (y + row) * stride + x * bpp, rowBytes);
+    }
+  }
+  return capture->mBackend.renderUpdateTexture(uptr, image, x, y, w, h, data);
+}
+
+void TraceCapture::viewportHook(void *uptr, float width, float height, float devicePixelRatio) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  const float args[] = { width, height, devicePixelRatio };
+  capture->write(uint32_t(RECORD_VIEWPORT));
+  capture->write(args);
+  capture->mBackend.renderViewport(uptr, width, height, devicePixelRatio);
+}
+
+void TraceCapture::cancelHook(void *uptr) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  capture->write(uint32_t(RECORD_CANCEL));
+  capture->writeToFile();
+  capture->mBackend.renderCancel(uptr);
+}
+
+void TraceCapture::flushHook(void *uptr) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  capture->write(uint32_t(RECORD_FLUSH));
+  capture->writeToFile();
+  capture->mNumFrames++;
+  capture->mBackend.renderFlush(uptr);
+}
+
+void TraceCapture::fillHook(void *uptr, NVGpaint *paint,
+                            NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                            float fringe, const float *bounds, const NVGpath *paths, int npaths) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  if (paint->image && !capture->mTextures.count(paint->image)) {
+    capture->declareTexture(paint->image, NVG_TEXTURE_RGBA);
+  }
+  const float rect[] = { bounds[0], bounds[1], bounds[2], bounds[3] };
+  capture->write(uint32_t(RECORD_FILL));
+  capture->writeState(paint, compositeOperation, scissor, fringe);
+  capture->write(rect);
+  capture->writePaths(paths, npaths);
+  if (capture->mBuffer.size() >= kBufferWords) capture->writeToFile();
+
+  capture->mBackend.renderFill(uptr, paint, compositeOperation, scissor, fringe, bounds, paths,
+                               npaths);
+}
+
+void TraceCapture::strokeHook(void *uptr, NVGpaint *paint,
+                              NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                              float fringe, float strokeWidth, const NVGpath *paths,
+                              int npaths) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  if (paint->image && !capture->mTextures.count(paint->image)) {
+    capture->declareTexture(paint->image, NVG_TEXTURE_RGBA);
+  }
+  capture->write(uint32_t(RECORD_STROKE));
+  capture->writeState(paint, compositeOperation, scissor, fringe);
+  capture->write(strokeWidth);
+  capture->writePaths(paths, npaths);
+  if (capture->mBuffer.size() >= kBufferWords) capture->writeToFile();
+
+  capture->mBackend.renderStroke(uptr, paint, compositeOperation, scissor, fringe, strokeWidth,
+                                 paths, npaths);
+}
+
+void TraceCapture::trianglesHook(void *uptr, NVGpaint *paint,
+                                 NVGcompositeOperationState compositeOperation,
+                                 NVGscissor *scissor, const NVGvertex *verts, int nverts,
+                                 float fringe) {
+  auto capture = static_cast<TraceCapture *>(findCapture(uptr));
+  // Triangles are text, drawn from the alpha font atlas.
+  if (paint->image && !capture->mTextures.count(paint->image)) {
+    capture->declareTexture(paint->image, NVG_TEXTURE_ALPHA);
+  }
+  auto &buffer = capture->mBuffer;
+  capture->write(uint32_t(RECORD_TRIANGLES));
+  capture->writeState(paint, compositeOperation, scissor, fringe);
+  capture->write(int32_t(nverts));
+  size_t pos = buffer.size();
+  buffer.resize(pos + nverts * kVertexWords);
+  if (nverts) std::memcpy(&buffer[pos], verts, nverts * sizeof(NVGvertex));
+  if (buffer.size() >= kBufferWords) capture->writeToFile();
+
+  capture->mBackend.renderTriangles(uptr, paint, compositeOperation, scissor, verts, nverts,
+                                    fringe);
+}
+
+// Trace Replay //
+
+TraceReplay::TraceReplay(const fs::path &path) {
+  std::ifstream file(path.string().c_str(), std::ios::binary | std::ios::ate);
+  if (!file.is_open()) return;
+
+  size_t numBytes = size_t(file.tellg());
+  file.seekg(0);
+  mWords.resize(numBytes / 4);
+  file.read(reinterpret_cast<char *>(mWords.data()), mWords.size() * 4);
+  if (!file || mWords.size() < 2 || mWords[0] != kMagic || mWords[1] != kVersion) {
+    mWords.clear();
+    return;
+  }
+
+  // A frame runs from the end of the previous one through its flush, so texture work done
+  // between frames is played with the frame after it.
+  Frame frame = { 2, 2, vec2(0), 1.0f };
+  size_t pos = 2;
+  while (pos < mWords.size()) {
+    size_t size = recordSize(pos);
+    if (!size) break;
+
+    auto type = mWords[pos];
+    if (type == RECORD_VIEWPORT) {
+      frame.size = vec2(read<float>(mWords, pos + 1), read<float>(mWords, pos + 2));
+      frame.devicePixelRatio = read<float>(mWords, pos + 3);
+    }
+    pos += size;
+    if (type == RECORD_FLUSH) {
+      frame.end = pos;
+      mFrames.push_back(frame);
+      frame.begin = pos;
+    }
+  }
+  // Drop the unfinished tail.
+  mWords.resize(mFrames.empty() ? 0 : mFrames.back().end);
+}
+
+size_t TraceReplay::recordSize(size_t pos) const {
+  const size_t end = mWords.size();
+  auto fits = [&](size_t n) { return n <= end - pos; };
+
+  // Returns the size of the path list starting at p, or 0 if it doesn't fit.
+  auto pathsSize = [&](size_t p) -> size_t {
+    if (p >= end) return 0;
+    int32_t npaths = read<int32_t>(mWords, p);
+    if (npaths < 0) return 0;
+    size_t size = 1;
+    for (int32_t i = 0; i < npaths; ++i) {
+      if (kPathWords > end - p - size) return 0;
+      int32_t nfill = read<int32_t>(mWords, p + size);
+      int32_t nstroke = read<int32_t>(mWords, p + size + 1);
+      if (nfill < 0 || nstroke < 0) return 0;
+      size += kPathWords + (size_t(nfill) + size_t(nstroke)) * kVertexWords;
+      if (size > end - p) return 0;
+    }
+    return size;
+  };
+
+  switch (mWords[pos]) {
+  case RECORD_VIEWPORT: return fits(4) ? 4 : 0;
+  case RECORD_CANCEL:
+  case RECORD_FLUSH: return 1;
+  case RECORD_DELETETEXTURE: return fits(2) ? 2 : 0;
+  case RECORD_CREATETEXTURE:
+  case RECORD_UPDATETEXTURE: {
+    if (!fits(7)) return 0;
+    size_t size = 7 + numWords(mWords[pos + 6]);
+    return fits(size) ? size : 0;
+  }
+  case RECORD_FILL: {
+    size_t size = 1 + kStateWords + 4;
+    size_t paths = fits(size) ? pathsSize(pos + size) : 0;
+    return paths ? size + paths : 0;
+  }
+  case RECORD_STROKE: {
+    size_t size = 1 + kStateWords + 1;
+    size_t paths = fits(size) ? pathsSize(pos + size) : 0;
+    return paths ? size + paths : 0;
+  }
+  case RECORD_TRIANGLES: {
+    size_t size = 1 + kStateWords + 1;
+    if (!fits(size)) return 0;
+    int32_t nverts = read<int32_t>(mWords, pos + size - 1);
+    if (nverts < 0) return 0;
+    size += size_t(nverts) * kVertexWords;
+    return fits(size) ? size : 0;
+  }
+  default: return 0;
+  }
+}
+
+int TraceReplay::image(int traceImage) const {
+  auto it = mTextures.find(traceImage);
+  return it != mTextures.end() ? it->second.image : 0;
+}
+
+void TraceReplay::readState(size_t &pos, NVGpaint &paint,
+                            NVGcompositeOperationState &compositeOperation, NVGscissor &scissor,
+                            float &fringe) {
+  paint = read<NVGpaint>(mWords, pos);
+  paint.image = image(paint.image);
+  pos += kPaintWords;
+  compositeOperation = read<NVGcompositeOperationState>(mWords, pos);
+  pos += kCompositeWords;
+  scissor = read<NVGscissor>(mWords, pos);
+  pos += kScissorWords;
+  fringe = read<float>(mWords, pos++);
+}
+
+// Points the paths at the vertices in place, which are stored with the same layout.
+void TraceReplay::readPaths(size_t &pos, int npaths) {
+  mPaths.resize(npaths);
+  for (auto &path : mPaths) {
+    std::memset(&path, 0, sizeof(path));
+    path.nfill = read<int32_t>(mWords, pos);
+    path.nstroke = read<int32_t>(mWords, pos + 1);
+    path.closed = char(read<int32_t>(mWords, pos + 2));
+    path.nbevel = read<int32_t>(mWords, pos + 3);
+    path.winding = read<int32_t>(mWords, pos + 4);
+    path.convex = read<int32_t>(mWords, pos + 5);
+    pos += kPathWords;
+    path.fill = path.nfill ? reinterpret_cast<NVGvertex *>(&mWords[pos]) : nullptr;
+    pos += path.nfill * kVertexWords;
+    path.stroke = path.nstroke ? reinterpret_cast<NVGvertex *>(&mWords[pos]) : nullptr;
+    pos += path.nstroke * kVertexWords;
+  }
+}
+
+void TraceReplay::playFrame(Context &ctx, size_t frame) {
+  NVGparams *params = nvgInternalParams(ctx.get());
+  void *uptr = params->userPtr;
+
+  NVGpaint paint;
+  NVGcompositeOperationState compositeOperation;
+  NVGscissor scissor;
+  float fringe;
+
+  size_t pos = mFrames[frame].begin;
+  while (pos < mFrames[frame].end) {
+    switch (mWords[pos++]) {
+    case RECORD_VIEWPORT: {
+      params->renderViewport(uptr, read<float>(mWords, pos), read<float>(mWords, pos + 1),
+                             read<float>(mWords, pos + 2));
+      pos += 3;
+      break;
+    }
+    case RECORD_CANCEL: params->renderCancel(uptr); break;
+    case RECORD_FLUSH: params->renderFlush(uptr); break;
+    case RECORD_CREATETEXTURE: {
+      int traceImage = read<int32_t>(mWords, pos), type = read<int32_t>(mWords, pos + 1);
+      int w = read<int32_t>(mWords, pos + 2), h = read<int32_t>(mWords, pos + 3);
+      int imageFlags = read<int32_t>(mWords, pos + 4);
+      size_t numBytes = mWords[pos + 5];
+      auto data = numBytes ? reinterpret_cast<const unsigned char *>(&mWords[pos + 6]) : nullptr;
+      pos += 6 + numWords(numBytes);
+      // Skip records a corrupt trace would have the backend read past their data for.
+      if (w <= 0 || h <= 0 || (numBytes && numBytes != size_t(w) * h * bytesPerPixel(type))) {
+        break;
+      }
+
+      // Reuse the texture from the last play when it matches, so loops don't churn textures.
+      auto it = mTextures.find(traceImage);
+      if (it != mTextures.end()) {
+        auto &texture = it->second;
+        if (texture.type == type && texture.width == w && texture.height == h) {
+          if (data) {
+            texture.data.assign(data, data + numBytes);
+            params->renderUpdateTexture(uptr, texture.image, 0, 0, w, h, texture.data.data());
+          }
+          break;
+        }
+        params->renderDeleteTexture(uptr, texture.image);
+        mTextures.erase(it);
+      }
+
+      Texture texture;
+      texture.image = params->renderCreateTexture(uptr, type, w, h, imageFlags, data);
+      texture.type = type;
+      texture.width = w;
+      texture.height = h;
+      if (data) {
+        texture.data.assign(data, data + numBytes);
+      } else {
+        texture.data.resize(size_t(w) * h * bytesPerPixel(type));
+      }
+      if (texture.image) mTextures[traceImage] = std::move(texture);
+      break;
+    }
+    case RECORD_DELETETEXTURE: {
+      auto it = mTextures.find(read<int32_t>(mWords, pos++));
+      if (it != mTextures.end()) {
+        params->renderDeleteTexture(uptr, it->second.image);
+        mTextures.erase(it);
+      }
+      break;
+    }
+    case RECORD_UPDATETEXTURE: {
+      int traceImage = read<int32_t>(mWords, pos);
+      int x = read<int32_t>(mWords, pos + 1), y = read<int32_t>(mWords, pos + 2);
+      int w = read<int32_t>(mWords, pos + 3), h = read<int32_t>(mWords, pos + 4);
+      size_t numBytes = mWords[pos + 5];
+      auto src = reinterpret_cast<const unsigned char *>(&mWords[pos + 6]);
+      pos += 6 + numWords(numBytes);
+
+      auto it = mTextures.find(traceImage);
+      if (it == mTextures.end()) break;
+      auto &texture = it->second;
+      size_t bpp = bytesPerPixel(texture.type);
+      size_t rowBytes = size_t(w) * bpp, stride = size_t(texture.width) * bpp;
+      if (x < 0 || y < 0 || w < 0 || h < 0 || x + w > texture.width || y + h > texture.height ||
+          numBytes != rowBytes * h) {
+        break;
+      }
+      for (int row = 0; row < h; ++row) {
+        std::memcpy(&texture.data[(y + row) * stride + x * bpp], src + row * rowBytes, rowBytes);
+      }
+      params->renderUpdateTexture(uptr, texture.image, x, y, w, h, texture.data.data());
+      break;
+    }
+    case RECORD_FILL: {
+      readState(pos, paint, compositeOperation, scissor, fringe);
+      const float *bounds = reinterpret_cast<const float *>(&mWords[pos]);
+      pos += 4;
+      int npaths = read<int32_t>(mWords, pos++);
+      readPaths(pos, npaths);
+      params->renderFill(uptr, &paint, compositeOperation, &scissor, fringe, bounds,
+                         mPaths.data(), npaths);
+      break;
+    }
+    case RECORD_STROKE: {
+      readState(pos, paint, compositeOperation, scissor, fringe);
+      float strokeWidth = read<float>(mWords, pos++);
+      int npaths = read<int32_t>(mWords, pos++);
+      readPaths(pos, npaths);
+      params->renderStroke(uptr, &paint, compositeOperation, &scissor, fringe, strokeWidth,
+                           mPaths.data(), npaths);
+      break;
+    }
+    case RECORD_TRIANGLES: {
+      readState(pos, paint, compositeOperation, scissor, fringe);
+      int nverts = read<int32_t>(mWords, pos++);
+      auto verts = reinterpret_cast<const NVGvertex *>(&mWords[pos]);
+      pos += nverts * kVertexWords;
+      params->renderTriangles(uptr, &paint, compositeOperation, &scissor, verts, nverts, fringe);
+      break;
+    }
+    }
+  }
+}
+
+void TraceReplay::play(Context &ctx) {
+  for (size_t i = 0; i < mFrames.size(); ++i) {
+    playFrame(ctx, i);
+  }
+}
+
+void TraceReplay::releaseTextures(Context &ctx) {
+  NVGparams *params = nvgInternalParams(ctx.get());
+  for (auto &entry : mTextures) {
+    params->renderDeleteTexture(params->userPtr, entry.second.image);
+  }
+  mTextures.clear();
+}
+
+}} // cinder::nvg
@@ -1,9 +1,549 @@
 #include "ci_nanovg.hpp"
 #include "SvgRenderer.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
 namespace cinder {
 namespace nvg {
 
+namespace {
+
+// Same as nanovg's NVG_MAX_STATES.
+const size_t kMaxStates = 32;
+const float kKappa90 = 0.5522847493f;
+const float kPi = 3.14159265358979323846264338327f;
+
+NVGcompositeOperationState compositeOperationState(int op) {
+  // Source and destination factors for each NVGcompositeOperation, in order.
+  static const int factors[][2] = {
+    { NVG_ONE, NVG_ONE_MINUS_SRC_ALPHA },           // NVG_SOURCE_OVER
+    { NVG_DST_ALPHA, NVG_ZERO },                    // NVG_SOURCE_IN
+    { NVG_ONE_MINUS_DST_ALPHA, NVG_ZERO },          // NVG_SOURCE_OUT
+    { NVG_DST_ALPHA, NVG_ONE_MINUS_SRC_ALPHA },     // NVG_ATOP
+    { NVG_ONE_MINUS_DST_ALPHA, NVG_ONE },           // NVG_DESTINATION_OVER
+    { NVG_ZERO, NVG_SRC_ALPHA },                    // NVG_DESTINATION_IN
+    { NVG_ZERO, NVG_ONE_MINUS_SRC_ALPHA },          // NVG_DESTINATION_OUT
+    { NVG_ONE_MINUS_DST_ALPHA, NVG_SRC_ALPHA },     // NVG_DESTINATION_ATOP
+    { NVG_ONE, NVG_ONE },                           // NVG_LIGHTER
+    { NVG_ONE, NVG_ZERO },                          // NVG_COPY
+    { NVG_ONE_MINUS_DST_ALPHA, NVG_ONE_MINUS_SRC_ALPHA }, // NVG_XOR
+  };
+
+  int sfactor = NVG_ONE, dfactor = NVG_ZERO;
+  if (op >= NVG_SOURCE_OVER && op <= NVG_XOR) {
+    sfactor = factors[op][0];
+    dfactor = factors[op][1];
+  }
+
+  NVGcompositeOperationState state = { sfactor, dfactor, sfactor, dfactor };
+  return state;
+}
+
+float distPtSeg(float x, float y, float px, float py, float qx, float qy) {
+  float pqx = qx - px, pqy = qy - py;
+  float dx = x - px, dy = y - py;
+  float d = pqx * pqx + pqy * pqy;
+  float t = pqx * dx + pqy * dy;
+  if (d > 0) t /= d;
+  t = std::min(std::max(t, 0.0f), 1.0f);
+  dx = px + t * pqx - x;
+  dy = py + t * pqy - y;
+  return dx * dx + dy * dy;
+}
+
+enum CacheFlags { CACHE_STROKE = 0x01, CACHE_ANTIALIAS = 0x02 };
+
+// Colors per batching palette texture, which is 2 texels wide.
+const int kPaletteRows = 256;
+
+// Vertices the fill batch grows to with fillCircles() and friends before it goes to the backend.
+const size_t kMaxShapeVertices = 1 << 18;
+
+// A vertex of a batched fill. Its u falls between the centers of the palette row's two texels,
+// the color at alpha 0 and at full alpha, so the backend's bilinear filtering blends them by
+// coverage.
+NVGvertex coverageVertex(float x, float y, float coverage, float paletteV) {
+  NVGvertex vtx = { x, y, (0.5f + coverage) * 0.5f, paletteV };
+  return vtx;
+}
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsedMs(const Clock::time_point &start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// VS2013 has no thread_local, but supports trivial thread local variables.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define CI_NVG_THREAD_LOCAL __declspec(thread)
+#else
+#define CI_NVG_THREAD_LOCAL thread_local
+#endif
+
+// Backend monitors, looked up by backend user pointer from the hooks. The registry only changes
+// when contexts are created or destroyed, which bumps the generation. Each thread remembers the
+// last monitor it found, so the hooks of a context drawn from one thread skip the lock.
+std::mutex sBackendMonitorsMutex;
+std::vector<std::pair<void *, void *>> sBackendMonitors;
+std::atomic<uint64_t> sBackendMonitorsGeneration(1);
+
+struct BackendMonitorCache {
+  void *uptr, *monitor;
+  uint64_t generation;
+};
+CI_NVG_THREAD_LOCAL BackendMonitorCache sLastBackendMonitor = { nullptr, nullptr, 0 };
+
+void *findBackendMonitor(void *uptr) {
+  auto &last = sLastBackendMonitor;
+  if (last.uptr == uptr && last.generation == sBackendMonitorsGeneration.load()) {
+    return last.monitor;
+  }
+
+  std::lock_guard<std::mutex> lock(sBackendMonitorsMutex);
+  for (auto &entry : sBackendMonitors) {
+    if (entry.first == uptr) {
+      last.uptr = uptr;
+      last.monitor = entry.second;
+      last.generation = sBackendMonitorsGeneration.load();
+      return entry.second;
+    }
+  }
+  return nullptr;
+}
+
+void renderTrianglesNoop(void *, NVGpaint *, NVGcompositeOperationState, NVGscissor *,
+                         const NVGvertex *, int, float) {}
+
+void appendUtf8(std::string &str, uint32_t cp) {
+  if (cp < 0x80) {
+    str += char(cp);
+  } else if (cp < 0x800) {
+    str += char(0xc0 | (cp >> 6));
+    str += char(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    str += char(0xe0 | (cp >> 12));
+    str += char(0x80 | ((cp >> 6) & 0x3f));
+    str += char(0x80 | (cp & 0x3f));
+  } else if (cp < 0x110000) {
+    str += char(0xf0 | (cp >> 18));
+    str += char(0x80 | ((cp >> 12) & 0x3f));
+    str += char(0x80 | ((cp >> 6) & 0x3f));
+    str += char(0x80 | (cp & 0x3f));
+  }
+}
+
+} // anon
+
+// Backend Monitor //
+
+// NOTE: nanovg creates the first atlas before the wrapper sees the context. It is the first
+// texture either backend creates, so it is picked up as image 1.
+Context::BackendMonitor::BackendMonitor(NVGparams *params) : params{ params }, backend(*params) {
+  if (backend.renderGetTextureSize(backend.userPtr, 1, &atlasStats.width, &atlasStats.height)) {
+    atlas = 1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sBackendMonitorsMutex);
+    sBackendMonitors.emplace_back(params->userPtr, this);
+    sBackendMonitorsGeneration++;
+  }
+  params->renderCreateTexture = createTextureHook;
+  params->renderUpdateTexture = updateTextureHook;
+  params->renderFill = fillHook;
+  params->renderStroke = strokeHook;
+  params->renderTriangles = trianglesHook;
+  params->renderFlush = flushHook;
+  params->renderCancel = cancelHook;
+}
+
+Context::BackendMonitor::~BackendMonitor() {
+  params->renderCreateTexture = backend.renderCreateTexture;
+  params->renderUpdateTexture = backend.renderUpdateTexture;
+  params->renderFill = backend.renderFill;
+  params->renderStroke = backend.renderStroke;
+  params->renderTriangles = backend.renderTriangles;
+  params->renderFlush = backend.renderFlush;
+  params->renderCancel = backend.renderCancel;
+  releasePalettes();
+
+  std::lock_guard<std::mutex> lock(sBackendMonitorsMutex);
+  for (auto it = sBackendMonitors.begin(); it != sBackendMonitors.end(); ++it) {
+    if (it->second == this) {
+      sBackendMonitors.erase(it);
+      sBackendMonitorsGeneration++;
+      break;
+    }
+  }
+}
+
+int Context::BackendMonitor::createTextureHook(void *uptr, int type, int w, int h,
+                                               int imageFlags, const unsigned char *data) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  int image = monitor->backend.renderCreateTexture(uptr, type, w, h, imageFlags, data);
+
+  // Only the font atlas uses alpha textures. A new one means the old one filled up.
+  if (image && type == NVG_TEXTURE_ALPHA) {
+    auto &stats = monitor->atlasStats;
+    if (monitor->atlas) stats.numResets++;
+    monitor->atlas = image;
+    monitor->usedHeight = 0;
+    stats.width = w;
+    stats.height = h;
+    stats.occupancy = 0.0f;
+  }
+  return image;
+}
+
+int Context::BackendMonitor::updateTextureHook(void *uptr, int image, int x, int y, int w, int h,
+                                               const unsigned char *data) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  if (image == monitor->atlas) {
+    auto &stats = monitor->atlasStats;
+    monitor->usedHeight = std::max(monitor->usedHeight, y + h);
+    stats.occupancy = stats.height > 0 ? float(monitor->usedHeight) / stats.height : 0.0f;
+    stats.numUploads++;
+    stats.numUploadedBytes += size_t(w) * h;
+    monitor->frame.numAtlasUploads++;
+  }
+  return monitor->backend.renderUpdateTexture(uptr, image, x, y, w, h, data);
+}
+
+void Context::BackendMonitor::fillHook(void *uptr, NVGpaint *paint,
+                                       NVGcompositeOperationState compositeOperation,
+                                       NVGscissor *scissor, float fringe, const float *bounds,
+                                       const NVGpath *paths, int npaths) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  if (monitor->batching &&
+      monitor->batchFill(*paint, compositeOperation, *scissor, fringe, paths, npaths)) {
+    return;
+  }
+  monitor->flushBatch();
+
+  auto &frame = monitor->frame;
+  frame.numFills++;
+  frame.numPaths += npaths;
+  for (int i = 0; i < npaths; ++i) {
+    frame.numVertices += paths[i].nfill + paths[i].nstroke;
+  }
+  if (paint->image) frame.numImageBinds++;
+  monitor->backend.renderFill(uptr, paint, compositeOperation, scissor, fringe, bounds, paths,
+                              npaths);
+}
+
+void Context::BackendMonitor::strokeHook(void *uptr, NVGpaint *paint,
+                                         NVGcompositeOperationState compositeOperation,
+                                         NVGscissor *scissor, float fringe, float strokeWidth,
+                                         const NVGpath *paths, int npaths) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  if (monitor->batching && monitor->batchStroke(*paint, compositeOperation, *scissor, fringe,
+                                                strokeWidth, paths, npaths)) {
+    return;
+  }
+  monitor->flushBatch();
+
+  auto &frame = monitor->frame;
+  frame.numStrokes++;
+  frame.numPaths += npaths;
+  for (int i = 0; i < npaths; ++i) {
+    frame.numVertices += paths[i].nstroke;
+  }
+  if (paint->image) frame.numImageBinds++;
+  monitor->backend.renderStroke(uptr, paint, compositeOperation, scissor, fringe, strokeWidth,
+                                paths, npaths);
+}
+
+// nanovg only draws triangles for text, as one quad of 6 vertices per glyph.
+void Context::BackendMonitor::trianglesHook(void *uptr, NVGpaint *paint,
+                                            NVGcompositeOperationState compositeOperation,
+                                            NVGscissor *scissor, const NVGvertex *verts,
+                                            int nverts, float fringe) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  monitor->flushBatch();
+
+  auto &frame = monitor->frame;
+  frame.numTriangles++;
+  frame.numVertices += nverts;
+  frame.numGlyphs += nverts / 6;
+  if (paint->image) frame.numImageBinds++;
+  monitor->backend.renderTriangles(uptr, paint, compositeOperation, scissor, verts, nverts,
+                                   fringe);
+}
+
+void Context::BackendMonitor::flushHook(void *uptr) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  monitor->flushBatch();
+  monitor->backend.renderFlush(uptr);
+  monitor->resetPalettes();
+}
+
+void Context::BackendMonitor::cancelHook(void *uptr) {
+  auto monitor = static_cast<BackendMonitor *>(findBackendMonitor(uptr));
+  monitor->batchType = BATCH_NONE;
+  monitor->batchVerts.clear();
+  monitor->batchPaths.clear();
+  monitor->backend.renderCancel(uptr);
+  monitor->resetPalettes();
+}
+
+// Batching //
+
+bool Context::BackendMonitor::beginCoverageBatch(
+    const NVGpaint &paint, const NVGcompositeOperationState &compositeOperation,
+    const NVGscissor &scissor, float fringe, float &paletteV) {
+  if (paint.image != 0 ||
+      std::memcmp(&paint.innerColor, &paint.outerColor, sizeof(NVGcolor)) != 0) {
+    return false;
+  }
+
+  size_t paletteIndex;
+  int row;
+  if (!findPaletteRow(paint.innerColor, paletteIndex, row)) return false;
+  int image = palettes[paletteIndex].image;
+
+  if (batchType != BATCH_FILLS || batchPaint.image != image || batchFringe != fringe ||
+      std::memcmp(&batchCompositeOperation, &compositeOperation, sizeof(compositeOperation)) ||
+      std::memcmp(&batchScissor, &scissor, sizeof(scissor))) {
+    flushBatch();
+    batchType = BATCH_FILLS;
+    batchPaint = colorPaint(nvgRGBAf(1.0f, 1.0f, 1.0f, 1.0f));
+    batchPaint.image = image;
+    batchCompositeOperation = compositeOperation;
+    batchScissor = scissor;
+    batchFringe = fringe;
+  }
+
+  paletteV = (row + 0.5f) / kPaletteRows;
+  return true;
+}
+
+bool Context::BackendMonitor::batchFill(const NVGpaint &paint,
+                                        const NVGcompositeOperationState &compositeOperation,
+                                        const NVGscissor &scissor, float fringe,
+                                        const NVGpath *paths, int npaths) {
+  // Only what the backend would draw with its convex fast path.
+  float v;
+  if (npaths != 1 || !paths[0].convex ||
+      !beginCoverageBatch(paint, compositeOperation, scissor, fringe, v)) {
+    return false;
+  }
+
+  // Coverage as the backend's shader computes it for fills.
+  bool antiAlias = params->edgeAntiAlias != 0;
+  auto add = [&](const NVGvertex &src) {
+    float coverage = 1.0f;
+    if (antiAlias) {
+      coverage = std::min(std::max(1.0f - std::fabs(src.u * 2.0f - 1.0f), 0.0f), 1.0f) *
+                 std::min(std::max(src.v, 0.0f), 1.0f);
+    }
+    batchVerts.push_back(coverageVertex(src.x, src.y, coverage, v));
+  };
+
+  // The fill is a triangle fan and its fringe a triangle strip, whose odd triangles are flipped
+  // to keep the winding the backend culls by.
+  const NVGpath &path = paths[0];
+  for (int i = 1; i + 1 < path.nfill; ++i) {
+    add(path.fill[0]);
+    add(path.fill[i]);
+    add(path.fill[i + 1]);
+  }
+  for (int i = 0; i + 2 < path.nstroke; ++i) {
+    add(path.stroke[i + (i & 1)]);
+    add(path.stroke[i + 1 - (i & 1)]);
+    add(path.stroke[i + 2]);
+  }
+
+  frame.numBatchedDraws++;
+  return true;
+}
+
+bool Context::BackendMonitor::batchStroke(const NVGpaint &paint,
+                                          const NVGcompositeOperationState &compositeOperation,
+                                          const NVGscissor &scissor, float fringe,
+                                          float strokeWidth, const NVGpath *paths, int npaths) {
+  if (batchType != BATCH_STROKES || batchFringe != fringe || batchStrokeWidth != strokeWidth ||
+      std::memcmp(&batchPaint, &paint, sizeof(paint)) ||
+      std::memcmp(&batchCompositeOperation, &compositeOperation, sizeof(compositeOperation)) ||
+      std::memcmp(&batchScissor, &scissor, sizeof(scissor))) {
+    flushBatch();
+    batchType = BATCH_STROKES;
+    batchPaint = paint;
+    batchCompositeOperation = compositeOperation;
+    batchScissor = scissor;
+    batchFringe = fringe;
+    batchStrokeWidth = strokeWidth;
+  }
+
+  // Vertices are copied, since the caller's are gone after this returns. The paths hold offsets
+  // into batchVerts until the batch is flushed.
+  for (int i = 0; i < npaths; ++i) {
+    NVGpath path = paths[i];
+    path.fill = nullptr;
+    path.nfill = 0;
+    path.stroke = reinterpret_cast<NVGvertex *>(batchVerts.size());
+    batchVerts.insert(batchVerts.end(), paths[i].stroke, paths[i].stroke + paths[i].nstroke);
+    batchPaths.push_back(path);
+  }
+
+  frame.numBatchedDraws++;
+  return true;
+}
+
+bool Context::BackendMonitor::findPaletteRow(const NVGcolor &color, size_t &paletteIndex,
+                                             int &row) {
+  uint8_t rgba[4];
+  for (int i = 0; i < 4; ++i) {
+    rgba[i] = uint8_t(std::min(std::max(color.rgba[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+  }
+  uint32_t key;
+  std::memcpy(&key, rgba, 4);
+
+  auto it = paletteRows.find(key);
+  if (it != paletteRows.end()) {
+    paletteIndex = it->second.first;
+    row = it->second.second;
+    return true;
+  }
+
+  if (palette < palettes.size() && palettes[palette].numRows == kPaletteRows) palette++;
+  if (palette == palettes.size()) {
+    Palette pal;
+    pal.texels.assign(kPaletteRows * 2 * 4, 0);
+    pal.image = backend.renderCreateTexture(backend.userPtr, NVG_TEXTURE_RGBA, 2, kPaletteRows,
+                                            0, pal.texels.data());
+    pal.numRows = pal.numUploaded = 0;
+    if (!pal.image) return false;
+    palettes.push_back(std::move(pal));
+  }
+
+  // The color at alpha 0 and at its own alpha.
+  auto &pal = palettes[palette];
+  uint8_t *texel = &pal.texels[pal.numRows * 8];
+  std::memcpy(texel, rgba, 4);
+  std::memcpy(texel + 4, rgba, 4);
+  texel[3] = 0;
+
+  paletteIndex = palette;
+  row = pal.numRows++;
+  paletteRows[key] = std::make_pair(paletteIndex, row);
+  return true;
+}
+
+void Context::BackendMonitor::flushBatch() {
+  if (batchType == BATCH_FILLS) {
+    for (auto &pal : palettes) {
+      if (pal.image != batchPaint.image || pal.numUploaded == pal.numRows) continue;
+      backend.renderUpdateTexture(backend.userPtr, pal.image, 0, pal.numUploaded, 2,
+                                  pal.numRows - pal.numUploaded, pal.texels.data());
+      pal.numUploaded = pal.numRows;
+    }
+    backend.renderTriangles(backend.userPtr, &batchPaint, batchCompositeOperation, &batchScissor,
+                            batchVerts.data(), int(batchVerts.size()), batchFringe);
+    frame.numTriangles++;
+    frame.numBatches++;
+    frame.numVertices += batchVerts.size();
+  } else if (batchType == BATCH_STROKES) {
+    for (auto &path : batchPaths) {
+      path.stroke = batchVerts.data() + reinterpret_cast<size_t>(path.stroke);
+    }
+    backend.renderStroke(backend.userPtr, &batchPaint, batchCompositeOperation, &batchScissor,
+                         batchFringe, batchStrokeWidth, batchPaths.data(),
+                         int(batchPaths.size()));
+    frame.numStrokes++;
+    frame.numBatches++;
+    frame.numPaths += batchPaths.size();
+    frame.numVertices += batchVerts.size();
+    if (batchPaint.image) frame.numImageBinds++;
+  }
+
+  batchType = BATCH_NONE;
+  batchVerts.clear();
+  batchPaths.clear();
+}
+
+void Context::BackendMonitor::resetPalettes() {
+  for (auto &pal : palettes) pal.numRows = pal.numUploaded = 0;
+  palette = 0;
+  paletteRows.clear();
+}
+
+void Context::BackendMonitor::releasePalettes() {
+  for (auto &pal : palettes) backend.renderDeleteTexture(backend.userPtr, pal.image);
+  palettes.clear();
+  palette = 0;
+  paletteRows.clear();
+}
+
+// Palettes are kept when batching is switched off, since draws recorded by the backend this
+// frame may still use them. They are deleted with the context.
+void Context::setBatching(bool enabled) {
+  if (!mBackendMonitor) return;
+  if (!enabled) mBackendMonitor->flushBatch();
+  mBackendMonitor->batching = enabled;
+}
+
+const GlyphAtlasStats &Context::getGlyphAtlasStats() const {
+  static const GlyphAtlasStats kNoAtlas = GlyphAtlasStats();
+  return mBackendMonitor ? mBackendMonitor->atlasStats : kNoAtlas;
+}
+
+void Context::prewarmGlyphs(FontHandle font, const std::vector<float> &sizes,
+                            const std::vector<std::pair<uint32_t, uint32_t>> &codepointRanges) {
+  // Split into chunks so a single nvgText call never needs a huge vertex buffer.
+  const size_t chunkSize = 256;
+
+  std::vector<std::string> chunks(1);
+  size_t count = 0;
+  for (auto &range : codepointRanges) {
+    for (uint32_t cp = range.first; cp <= range.second; ++cp) {
+      if (cp >= 0xd800 && cp <= 0xdfff) continue; // Surrogates aren't codepoints.
+      if (count++ == chunkSize) {
+        chunks.emplace_back();
+        count = 1;
+      }
+      appendUtf8(chunks.back(), cp);
+    }
+  }
+
+  for (float size : sizes) {
+    for (auto &chunk : chunks) {
+      if (chunk.empty()) continue;
+      GlyphPrewarm prewarm = { font.id, size, chunk };
+      mGlyphPrewarms.push_back(std::move(prewarm));
+    }
+  }
+}
+
+// Draws the queued glyphs with the backend's triangle output switched off, which rasterizes them
+// into the atlas and uploads it without drawing anything.
+void Context::prewarmGlyphsNow() {
+  if (mGlyphPrewarms.empty()) return;
+
+  NVGcontext *vg = get();
+  NVGparams *params = nvgInternalParams(vg);
+  auto renderTriangles = params->renderTriangles;
+  params->renderTriangles = renderTrianglesNoop;
+
+  nvgSave(vg);
+  nvgResetTransform(vg);
+  nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE);
+  for (auto &prewarm : mGlyphPrewarms) {
+    nvgFontFaceId(vg, prewarm.font);
+    nvgFontSize(vg, prewarm.size);
+    nvgText(vg, 0.0f, 0.0f, prewarm.text.c_str(), prewarm.text.c_str() + prewarm.text.size());
+  }
+  nvgRestore(vg);
+
+  params->renderTriangles = renderTriangles;
+  mGlyphPrewarms.clear();
+}
+
 Image::Image(Image &&image) : mCtx{ image.mCtx }, id{ image.id } {
   image.mCtx = nullptr;
 }
@@ -21,7 +561,34 @@ Image::~Image() {
   if (mCtx) nvgDeleteImage(mCtx, id);
 }
 
-Context::Context(NVGcontext *ptr, Deleter deleter) : mPtr{ ptr, deleter } {}
+Context::Context(NVGcontext *ptr, Deleter deleter)
+: mPtr{ ptr, deleter }, mStates(1) {
+  // Backends return a null context when creation fails. Drawing on one does nothing.
+  if (ptr) mBackendMonitor.reset(new BackendMonitor(nvgInternalParams(ptr)));
+  resetState(mStates.back());
+}
+
+Context::Context(Context &&ctx)
+: mFontBlobs{ std::move(ctx.mFontBlobs) }, mPtr{ std::move(ctx.mPtr) },
+  mRecording{ std::move(ctx.mRecording) },
+  mStates{ std::move(ctx.mStates) }, mCommands{ std::move(ctx.mCommands) },
+  mCommandPos{ ctx.mCommandPos }, mPathKey{ ctx.mPathKey },
+  mTessellator{ std::move(ctx.mTessellator) },
+  mTessellationCache{ std::move(ctx.mTessellationCache) },
+  mDevicePixelRatio{ ctx.mDevicePixelRatio }, mViewSize{ ctx.mViewSize },
+  mInstanceCommands{ std::move(ctx.mInstanceCommands) },
+  mInstanceIndices{ std::move(ctx.mInstanceIndices) },
+  mInstanceTessellations{ std::move(ctx.mInstanceTessellations) },
+  mNumInstanceTessellations{ ctx.mNumInstanceTessellations },
+  mTessellationPool{ ctx.mTessellationPool },
+  mDeferred{ std::move(ctx.mDeferred) },
+  mDeferredTessellations{ std::move(ctx.mDeferredTessellations) },
+  mNumDeferred{ ctx.mNumDeferred }, mDeferredCommands{ std::move(ctx.mDeferredCommands) },
+  mBackendMonitor{ std::move(ctx.mBackendMonitor) }, mFrameStats{ ctx.mFrameStats },
+  mFrameStatsHistory{ std::move(ctx.mFrameStatsHistory) },
+  mGlyphPrewarms{ std::move(ctx.mGlyphPrewarms) } {
+  ctx.mNumDeferred = 0;
+}
 
 // svg::Paint to NVGpaint conversion.
 // Currently only works for 2-color linear gradients.
@@ -55,11 +622,12 @@ void Context::fillPaint(const svg::Paint &paint) {
 void Context::polyLine(const PolyLine2f &polyline) {
   auto &pts = polyline.getPoints();
   if (pts.size() >= 2) {
-    moveTo(pts[0]);
-    for (auto i = begin(pts) + 1; i != end(pts); ++i) {
-      lineTo(*i);
-    }
-    if (polyline.isClosed()) closePath();
+    moveToLines(pts.data(), pts.size(), polyline.isClosed());
+  }
+}
+void Context::polyLines(const std::vector<PolyLine2f> &polylines) {
+  for (auto &polyline : polylines) {
+    polyLine(polyline);
   }
 }
 
@@ -112,112 +680,339 @@ void Context::shape2d(const Shape2d &shape) {
 }
 
 void Context::draw(const svg::Doc &svg) {
-  SvgRenderer renderer(*this);
-  svg.render(renderer);
+  save();
+  {
+    SvgRenderer renderer(*this);
+    svg.render(renderer);
+  }
+  restore();
+}
+
+void Context::draw(const CompiledSvg &svg) {
+  svg.draw(*this);
+}
+
+// Recording //
+
+void Context::beginRecording() {
+  assert(!mRecording && "Recordings can not be nested");
+  mRecording.reset(new DisplayList());
+}
+
+DisplayList Context::endRecording() {
+  assert(mRecording && "endRecording() called without beginRecording()");
+  DisplayList list = std::move(*mRecording);
+  mRecording.reset();
+  return list;
+}
+
+void Context::replay(const DisplayList &list, const mat3 &transform) {
+  assert(!mRecording && "Display lists can not be replayed while recording");
+  list.replay(*this, transform);
+}
+
+void Context::submit(CommandBuffer &&buffer) {
+  assert(!mRecording && "Command buffers can not be submitted while recording");
+  buffer.replay(*this);
+  buffer.clear();
+}
+
+// Tessellation Cache //
+
+void Context::cachePath(uint64_t key) {
+  if (mRecording) return;
+  mPathKey = key;
+}
+
+void Context::tessellateCached(TessellationCache::Key &key, float strokeWidth,
+                               Tessellation &result) {
+  const auto &state = mStates.back();
+  float canonical[6], remaining[6], inverse[6];
+  TessellationCache::splitTransform(state.xform, key, canonical, remaining);
+
+  // Stroke widths are expanded in canonical space, so key on that rather than the exact width.
+  if (key.flags & CACHE_STROKE) {
+    float fringe = mTessellator.getFringeWidth();
+    key.strokeWidth = std::min(std::max(strokeWidth * getAverageScale(canonical), fringe), 200.0f);
+  }
+
+  const Tessellation *tess = mTessellationCache.find(key);
+  if (!tess) {
+    // Commands are stored transformed, so take the remaining transform back out of them.
+    nvgTransformInverse(inverse, remaining);
+    mCanonicalCommands.resize(mCommands.size());
+    transformCommands(mCanonicalCommands.data(), mCommands.data(), mCommands.size(), inverse);
+    mTessellator.flatten(mCanonicalCommands.data(), mCanonicalCommands.size());
+
+    float fringe = (key.flags & CACHE_ANTIALIAS) ? key.fringe : 0.0f;
+    if (key.flags & CACHE_STROKE) {
+      mTessellator.expandStroke(key.strokeWidth * 0.5f, fringe, state.lineCap, state.lineJoin,
+                                state.miterLimit);
+    } else {
+      mTessellator.expandFill(fringe, NVG_MITER, 2.4f);
+    }
+
+    mBackendMonitor->frame.numPoints += mTessellator.getNumPoints();
+
+    Tessellation entry;
+    entry.assign(mTessellator);
+    tess = mTessellationCache.insert(key, std::move(entry));
+  }
+
+  result.assign(*tess, remaining);
+}
+
+void Context::setTessellationPool(ThreadPool *pool) {
+  flushDeferred();
+  mTessellationPool = pool;
+}
+
+void Context::flushDeferred() {
+  if (mNumDeferred == 0) return;
+
+  mWorkerTessellators.resize(mTessellationPool->getNumThreads() + 1);
+  for (auto &tess : mWorkerTessellators) {
+    tess.setDevicePixelRatio(mDevicePixelRatio);
+  }
+
+  auto start = Clock::now();
+  std::atomic<size_t> next(0), numPoints(0);
+  mTessellationPool->parallelWorkers([&](size_t worker) {
+    Tessellator &tess = mWorkerTessellators[worker];
+    size_t points = 0;
+    for (size_t i = next++; i < mNumDeferred; i = next++) {
+      const PathDraw &draw = mDeferred[i];
+      if (draw.tessellated) continue;
+      points += expandPath(tess, draw, mDeferredCommands.data() + draw.begin,
+                           draw.end - draw.begin);
+      mDeferredTessellations[i].assign(tess);
+    }
+    numPoints += points;
+  });
+
+  auto &frame = mBackendMonitor->frame;
+  frame.numPoints += numPoints;
+  frame.tessellationMs += elapsedMs(start);
+
+  for (size_t i = 0; i < mNumDeferred; ++i) {
+    const auto &tess = mDeferredTessellations[i];
+    renderPath(mDeferred[i], tess.paths.data(), int(tess.paths.size()), tess.bounds);
+  }
+
+  mNumDeferred = 0;
+  mDeferredCommands.clear();
 }
 
 // Frame //
 
 void Context::beginFrame(int windowWidth, int windowHeight, float devicePixelRatio) {
+  if (mBackendMonitor) mBackendMonitor->frame = FrameStats();
   nvgBeginFrame(get(), windowWidth, windowHeight, devicePixelRatio);
+  mStates.resize(1);
+  resetState(mStates.back());
+  mTessellator.setDevicePixelRatio(devicePixelRatio);
+  mDevicePixelRatio = devicePixelRatio;
+  mViewSize = vec2(float(windowWidth), float(windowHeight));
+  prewarmGlyphsNow();
 }
 void Context::beginFrame(const ivec2 &windowSize, float devicePixelRatio) {
   beginFrame(windowSize.x, windowSize.y, devicePixelRatio);
 }
 void Context::cancelFrame() {
+  mNumDeferred = 0;
+  mDeferredCommands.clear();
   nvgCancelFrame(get());
 }
 void Context::endFrame() {
+  flushDeferred();
+
+  auto start = Clock::now();
   nvgEndFrame(get());
+  if (!mBackendMonitor) return;
+
+  auto &frame = mBackendMonitor->frame;
+  frame.flushMs = elapsedMs(start);
+  mFrameStats = frame;
+  mFrameStatsHistory.add(frame);
 }
 
 // Global Compositing //
 
 void Context::globalCompositeOperation(int op) {
+  if (mRecording) return mRecording->globalCompositeOperation(op);
   nvgGlobalCompositeOperation(get(), op);
+  mStates.back().compositeOperation = compositeOperationState(op);
 }
 void Context::globalCompositeBlendFunc(int sfactor, int dfactor) {
+  if (mRecording) {
+    return mRecording->globalCompositeBlendFuncSeparate(sfactor, dfactor, sfactor, dfactor);
+  }
   nvgGlobalCompositeBlendFunc(get(), sfactor, dfactor);
+  NVGcompositeOperationState op = { sfactor, dfactor, sfactor, dfactor };
+  mStates.back().compositeOperation = op;
 }
 void Context::globalCompositeBlendFuncSeparate(int srcRGB, int dstRGB, int srcAlpha, int dstAlpha) {
+  if (mRecording) {
+    return mRecording->globalCompositeBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+  }
   nvgGlobalCompositeBlendFuncSeparate(get(), srcRGB, dstRGB, srcAlpha, dstAlpha);
+  NVGcompositeOperationState op = { srcRGB, dstRGB, srcAlpha, dstAlpha };
+  mStates.back().compositeOperation = op;
 }
 
 // State Handling //
 
+// Same defaults as nvgReset.
+void Context::resetState(State &state) {
+  state.fill = colorPaint(nvgRGBA(255, 255, 255, 255));
+  state.stroke = colorPaint(nvgRGBA(0, 0, 0, 255));
+  state.compositeOperation = compositeOperationState(NVG_SOURCE_OVER);
+  state.alpha = 1.0f;
+  state.shapeAntiAlias = true;
+  state.strokeWidth = 1.0f;
+  state.miterLimit = 10.0f;
+  state.lineCap = NVG_BUTT;
+  state.lineJoin = NVG_MITER;
+  nvgTransformIdentity(state.xform);
+  std::memset(state.scissor.xform, 0, sizeof(state.scissor.xform));
+  state.scissor.extent[0] = state.scissor.extent[1] = -1.0f;
+  state.font = 0;
+}
+
 void Context::save() {
+  if (mRecording) return mRecording->save();
   nvgSave(get());
+  if (mStates.size() < kMaxStates) mStates.push_back(mStates.back());
 }
 void Context::restore() {
+  if (mRecording) return mRecording->restore();
   nvgRestore(get());
+  if (mStates.size() > 1) mStates.pop_back();
 }
 void Context::reset() {
+  if (mRecording) return mRecording->reset();
   nvgReset(get());
+  resetState(mStates.back());
 }
 
 // Render Styles //
 
 void Context::strokeColor(const NVGcolor &color) {
+  if (mRecording) return mRecording->strokeColor(color);
   nvgStrokeColor(get(), color);
+  mStates.back().stroke = colorPaint(color);
 }
 void Context::strokeColor(const ColorAf &color) {
   strokeColor(reinterpret_cast<const NVGcolor &>(color));
 }
 void Context::strokePaint(const NVGpaint &paint) {
+  if (mRecording) return mRecording->strokePaint(paint);
   nvgStrokePaint(get(), paint);
+  auto &state = mStates.back();
+  state.stroke = paint;
+  nvgTransformMultiply(state.stroke.xform, state.xform);
 }
 void Context::fillColor(const NVGcolor &color) {
+  if (mRecording) return mRecording->fillColor(color);
   nvgFillColor(get(), color);
+  mStates.back().fill = colorPaint(color);
 }
 void Context::fillColor(const ColorAf &color) {
   fillColor(reinterpret_cast<const NVGcolor &>(color));
 }
 void Context::fillPaint(const NVGpaint &paint) {
+  if (mRecording) return mRecording->fillPaint(paint);
   nvgFillPaint(get(), paint);
+  auto &state = mStates.back();
+  state.fill = paint;
+  nvgTransformMultiply(state.fill.xform, state.xform);
 }
 
 void Context::miterLimit(float limit) {
+  if (mRecording) return mRecording->miterLimit(limit);
   nvgMiterLimit(get(), limit);
+  mStates.back().miterLimit = limit;
 }
 void Context::strokeWidth(float size) {
+  if (mRecording) return mRecording->strokeWidth(size);
   nvgStrokeWidth(get(), size);
+  mStates.back().strokeWidth = size;
 }
 void Context::lineCap(int cap) {
+  if (mRecording) return mRecording->lineCap(cap);
   nvgLineCap(get(), cap);
+  mStates.back().lineCap = cap;
 }
 void Context::lineJoin(int join) {
+  if (mRecording) return mRecording->lineJoin(join);
   nvgLineJoin(get(), join);
+  mStates.back().lineJoin = join;
+}
+void Context::globalAlpha(float alpha) {
+  if (mRecording) return mRecording->globalAlpha(alpha);
+  nvgGlobalAlpha(get(), alpha);
+  mStates.back().alpha = alpha;
+}
+void Context::shapeAntiAlias(bool enabled) {
+  if (mRecording) return mRecording->shapeAntiAlias(enabled);
+  nvgShapeAntiAlias(get(), enabled);
+  mStates.back().shapeAntiAlias = enabled;
 }
 
 // Transform //
 
 void Context::resetTransform() {
+  if (mRecording) return mRecording->resetTransform();
   nvgResetTransform(get());
+  nvgTransformIdentity(mStates.back().xform);
 }
 void Context::transform(const mat3 &mtx) {
+  if (mRecording) return mRecording->transform(mtx);
   nvgTransform(get(), mtx[0][0], mtx[0][1], mtx[1][0], mtx[1][1], mtx[2][0], mtx[2][1]);
+  const float t[6] = { mtx[0][0], mtx[0][1], mtx[1][0], mtx[1][1], mtx[2][0], mtx[2][1] };
+  nvgTransformPremultiply(mStates.back().xform, t);
 }
 void Context::setTransform(const mat3 &mtx) {
   resetTransform();
   transform(mtx);
 }
 void Context::translate(float x, float y) {
+  if (mRecording) return mRecording->translate(x, y);
   nvgTranslate(get(), x, y);
+  float t[6];
+  nvgTransformTranslate(t, x, y);
+  nvgTransformPremultiply(mStates.back().xform, t);
 }
 void Context::translate(const vec2 &translation) {
   translate(translation.x, translation.y);
 }
 void Context::rotate(float angle) {
+  if (mRecording) return mRecording->rotate(angle);
   nvgRotate(get(), angle);
+  float t[6];
+  nvgTransformRotate(t, angle);
+  nvgTransformPremultiply(mStates.back().xform, t);
 }
 void Context::skewX(float angle) {
+  if (mRecording) return mRecording->skewX(angle);
   nvgSkewX(get(), angle);
+  float t[6];
+  nvgTransformSkewX(t, angle);
+  nvgTransformPremultiply(mStates.back().xform, t);
 }
 void Context::skewY(float angle) {
+  if (mRecording) return mRecording->skewY(angle);
   nvgSkewY(get(), angle);
+  float t[6];
+  nvgTransformSkewY(t, angle);
+  nvgTransformPremultiply(mStates.back().xform, t);
 }
 void Context::scale(float x, float y) {
+  if (mRecording) return mRecording->scale(x, y);
   nvgScale(get(), x, y);
+  float t[6];
+  nvgTransformScale(t, x, y);
+  nvgTransformPremultiply(mStates.back().xform, t);
 }
 void Context::scale(const vec2 &s) {
   scale(s.x, s.y);
@@ -229,6 +1024,49 @@ mat3 Context::currentTransform() {
   return mat3(m[0], m[1], 0.0f, m[2], m[3], 0.0f, m[4], m[5], 1.0f);
 }
 
+Rectf Context::getVisibleBounds() {
+  const float inf = std::numeric_limits<float>::max();
+  if (mRecording || mViewSize.x <= 0.0f || mViewSize.y <= 0.0f) return Rectf(-inf, -inf, inf, inf);
+
+  // The window, clipped to the scissor, in window space. The scissor is a rectangle of half size
+  // extent centered on its transform's origin, so its bounds come from the transform's axes.
+  const State &state = mStates.back();
+  float x1 = 0.0f, y1 = 0.0f, x2 = mViewSize.x, y2 = mViewSize.y;
+  if (state.scissor.extent[0] >= 0.0f) {
+    const float *t = state.scissor.xform;
+    float ex = state.scissor.extent[0], ey = state.scissor.extent[1];
+    float hw = std::abs(t[0]) * ex + std::abs(t[2]) * ey;
+    float hh = std::abs(t[1]) * ex + std::abs(t[3]) * ey;
+    x1 = std::max(x1, t[4] - hw);
+    y1 = std::max(y1, t[5] - hh);
+    x2 = std::min(x2, t[4] + hw);
+    y2 = std::min(y2, t[5] + hh);
+  }
+  if (x1 >= x2 || y1 >= y2) return Rectf(0.0f, 0.0f, 0.0f, 0.0f);
+
+  // Anti-aliasing fringes reach a pixel past the geometry.
+  float fringe = 1.0f / mDevicePixelRatio;
+  x1 -= fringe;
+  y1 -= fringe;
+  x2 += fringe;
+  y2 += fringe;
+
+  float inverse[6];
+  if (!nvgTransformInverse(inverse, state.xform)) return Rectf(0.0f, 0.0f, 0.0f, 0.0f);
+
+  const float corners[8] = { x1, y1, x2, y1, x2, y2, x1, y2 };
+  Rectf bounds(inf, inf, -inf, -inf);
+  for (int i = 0; i < 8; i += 2) {
+    float x, y;
+    nvgTransformPoint(&x, &y, inverse, corners[i], corners[i + 1]);
+    bounds.x1 = std::min(bounds.x1, x);
+    bounds.y1 = std::min(bounds.y1, y);
+    bounds.x2 = std::max(bounds.x2, x);
+    bounds.y2 = std::max(bounds.y2, y);
+  }
+  return bounds;
+}
+
 // Paints //
 
 NVGpaint Context::linearGradient(const vec2 &start, const vec2 &end, const ColorAf &c1,
@@ -256,89 +1094,898 @@ NVGpaint Context::imagePattern(float cx, float cy, float w, float h, float angle
 // Scissoring //
 
 void Context::scissor(float x, float y, float w, float h) {
+  if (mRecording) return mRecording->scissor(x, y, w, h);
   nvgScissor(get(), x, y, w, h);
+
+  auto &state = mStates.back();
+  w = std::max(0.0f, w);
+  h = std::max(0.0f, h);
+  nvgTransformIdentity(state.scissor.xform);
+  state.scissor.xform[4] = x + w * 0.5f;
+  state.scissor.xform[5] = y + h * 0.5f;
+  nvgTransformMultiply(state.scissor.xform, state.xform);
+  state.scissor.extent[0] = w * 0.5f;
+  state.scissor.extent[1] = h * 0.5f;
 }
 void Context::resetScissor() {
+  if (mRecording) return mRecording->resetScissor();
   nvgResetScissor(get());
+
+  auto &state = mStates.back();
+  std::memset(state.scissor.xform, 0, sizeof(state.scissor.xform));
+  state.scissor.extent[0] = state.scissor.extent[1] = -1.0f;
 }
 
 // Paths //
 
+void Context::appendCommands(float *vals, size_t count) {
+  int cmd = int(vals[0]);
+  if (cmd != Tessellator::CLOSE && cmd != Tessellator::WINDING) {
+    mCommandPos = vec2(vals[count - 2], vals[count - 1]);
+  }
+  transformCommands(vals, vals, count, mStates.back().xform);
+  mCommands.insert(mCommands.end(), vals, vals + count);
+}
+
 void Context::beginPath() {
-  nvgBeginPath(get());
+  if (mRecording) return mRecording->beginPath();
+  mCommands.clear();
+  mPathKey = 0;
 }
 void Context::moveTo(float x, float y) {
-  nvgMoveTo(get(), x, y);
+  if (mRecording) return mRecording->moveTo(x, y);
+  float vals[] = { float(Tessellator::MOVETO), x, y };
+  appendCommands(vals, 3);
 }
 void Context::moveTo(const vec2 &p) {
   moveTo(p.x, p.y);
 }
 void Context::lineTo(float x, float y) {
-  nvgLineTo(get(), x, y);
+  if (mRecording) return mRecording->lineTo(x, y);
+  float vals[] = { float(Tessellator::LINETO), x, y };
+  appendCommands(vals, 3);
 }
 void Context::lineTo(const vec2 &p) {
   lineTo(p.x, p.y);
 }
 void Context::quadTo(float cx, float cy, float x, float y) {
-  nvgQuadTo(get(), cx, cy, x, y);
+  if (mRecording) return mRecording->quadTo(cx, cy, x, y);
+  float x0 = mCommandPos.x, y0 = mCommandPos.y;
+  float vals[] = { float(Tessellator::BEZIERTO),
+                   x0 + 2.0f / 3.0f * (cx - x0), y0 + 2.0f / 3.0f * (cy - y0),
+                   x + 2.0f / 3.0f * (cx - x), y + 2.0f / 3.0f * (cy - y),
+                   x, y };
+  appendCommands(vals, 7);
 }
 void Context::quadTo(const vec2 &p1, const vec2 &p2) {
   quadTo(p1.x, p1.y, p2.x, p2.y);
 }
 void Context::bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
-  nvgBezierTo(get(), c1x, c1y, c2x, c2y, x, y);
+  if (mRecording) return mRecording->bezierTo(c1x, c1y, c2x, c2y, x, y);
+  float vals[] = { float(Tessellator::BEZIERTO), c1x, c1y, c2x, c2y, x, y };
+  appendCommands(vals, 7);
 }
 void Context::bezierTo(const vec2 &p1, const vec2 &p2, const vec2 &p3) {
   bezierTo(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y);
 }
 void Context::arcTo(float x1, float y1, float x2, float y2, float radius) {
-  nvgArcTo(get(), x1, y1, x2, y2, radius);
+  if (mRecording) return mRecording->arcTo(x1, y1, x2, y2, radius);
+  if (mCommands.empty()) return;
+
+  float x0 = mCommandPos.x, y0 = mCommandPos.y;
+  float distTol = mTessellator.getDistTol();
+
+  // Handle degenerate cases.
+  if (distPtSeg(x1, y1, x0, y0, x2, y2) < distTol * distTol || radius < distTol ||
+      glm::length(vec2(x1 - x0, y1 - y0)) < distTol ||
+      glm::length(vec2(x2 - x1, y2 - y1)) < distTol) {
+    lineTo(x1, y1);
+    return;
+  }
+
+  // Calculate tangential circle to lines (x0,y0)-(x1,y1) and (x1,y1)-(x2,y2).
+  vec2 d0 = glm::normalize(vec2(x0 - x1, y0 - y1));
+  vec2 d1 = glm::normalize(vec2(x2 - x1, y2 - y1));
+  float a = std::acos(d0.x * d1.x + d0.y * d1.y);
+  float d = radius / std::tan(a / 2.0f);
+
+  if (d > 10000.0f) {
+    lineTo(x1, y1);
+    return;
+  }
+
+  if (d1.x * d0.y - d0.x * d1.y > 0.0f) {
+    float cx = x1 + d0.x * d + d0.y * radius;
+    float cy = y1 + d0.y * d + -d0.x * radius;
+    arc(cx, cy, radius, std::atan2(d0.x, -d0.y), std::atan2(-d1.x, d1.y), NVG_CW);
+  } else {
+    float cx = x1 + d0.x * d + -d0.y * radius;
+    float cy = y1 + d0.y * d + d0.x * radius;
+    arc(cx, cy, radius, std::atan2(-d0.x, d0.y), std::atan2(d1.x, -d1.y), NVG_CCW);
+  }
 }
 void Context::arcTo(const vec2 &p1, const vec2 &p2, float radius) {
   arcTo(p1.x, p1.y, p2.x, p2.y, radius);
 }
 void Context::closePath() {
-  nvgClosePath(get());
+  if (mRecording) return mRecording->closePath();
+  float vals[] = { float(Tessellator::CLOSE) };
+  appendCommands(vals, 1);
 }
 void Context::pathWinding(int dir) {
-  nvgPathWinding(get(), dir);
+  if (mRecording) return mRecording->pathWinding(dir);
+  float vals[] = { float(Tessellator::WINDING), float(dir) };
+  appendCommands(vals, 2);
 }
 void Context::arc(float cx, float cy, float r, float a0, float a1, int dir) {
-  nvgArc(get(), cx, cy, r, a0, a1, dir);
+  if (mRecording) return mRecording->arc(cx, cy, r, a0, a1, dir);
+
+  // Clamp angles
+  float da = a1 - a0;
+  if (dir == NVG_CW) {
+    if (std::abs(da) >= kPi * 2) {
+      da = kPi * 2;
+    } else {
+      while (da < 0.0f) da += kPi * 2;
+    }
+  } else {
+    if (std::abs(da) >= kPi * 2) {
+      da = -kPi * 2;
+    } else {
+      while (da > 0.0f) da -= kPi * 2;
+    }
+  }
+
+  // Split arc into max 90 degree segments.
+  int ndivs = std::max(1, std::min(int(std::abs(da) / (kPi * 0.5f) + 0.5f), 5));
+  float hda = (da / float(ndivs)) / 2.0f;
+  float kappa = std::abs(4.0f / 3.0f * (1.0f - std::cos(hda)) / std::sin(hda));
+  if (dir == NVG_CCW) kappa = -kappa;
+
+  float vals[3 + 5 * 7];
+  size_t nvals = 0;
+  float px = 0, py = 0, ptanx = 0, ptany = 0;
+  for (int i = 0; i <= ndivs; ++i) {
+    float a = a0 + da * (i / float(ndivs));
+    float dx = std::cos(a), dy = std::sin(a);
+    float x = cx + dx * r, y = cy + dy * r;
+    float tanx = -dy * r * kappa, tany = dx * r * kappa;
+
+    if (i == 0) {
+      vals[nvals++] = float(mCommands.empty() ? Tessellator::MOVETO : Tessellator::LINETO);
+      vals[nvals++] = x;
+      vals[nvals++] = y;
+    } else {
+      vals[nvals++] = float(Tessellator::BEZIERTO);
+      vals[nvals++] = px + ptanx;
+      vals[nvals++] = py + ptany;
+      vals[nvals++] = x - tanx;
+      vals[nvals++] = y - tany;
+      vals[nvals++] = x;
+      vals[nvals++] = y;
+    }
+    px = x;
+    py = y;
+    ptanx = tanx;
+    ptany = tany;
+  }
+
+  appendCommands(vals, nvals);
 }
 void Context::arc(const vec2 &center, float r, float a0, float a1, int dir) {
   arc(center.x, center.y, r, a0, a1, dir);
 }
 void Context::rect(float x, float y, float w, float h) {
-  nvgRect(get(), x, y, w, h);
+  if (mRecording) return mRecording->rect(x, y, w, h);
+  float vals[] = { float(Tessellator::MOVETO), x, y,
+                   float(Tessellator::LINETO), x, y + h,
+                   float(Tessellator::LINETO), x + w, y + h,
+                   float(Tessellator::LINETO), x + w, y,
+                   float(Tessellator::CLOSE) };
+  appendCommands(vals, 13);
 }
 void Context::rect(const Rectf &r) {
   rect(r.getX1(), r.getY1(), r.getWidth(), r.getHeight());
 }
 void Context::roundedRect(float x, float y, float w, float h, float r) {
-  nvgRoundedRect(get(), x, y, w, h, r);
+  if (mRecording) return mRecording->roundedRect(x, y, w, h, r);
+  if (r < 0.1f) return rect(x, y, w, h);
+
+  float rx = std::min(r, std::abs(w) * 0.5f) * (w >= 0.0f ? 1.0f : -1.0f);
+  float ry = std::min(r, std::abs(h) * 0.5f) * (h >= 0.0f ? 1.0f : -1.0f);
+  float kx = rx * (1 - kKappa90), ky = ry * (1 - kKappa90);
+  float vals[] = { float(Tessellator::MOVETO), x, y + ry,
+                   float(Tessellator::LINETO), x, y + h - ry,
+                   float(Tessellator::BEZIERTO), x, y + h - ky, x + kx, y + h, x + rx, y + h,
+                   float(Tessellator::LINETO), x + w - rx, y + h,
+                   float(Tessellator::BEZIERTO), x + w - kx, y + h, x + w, y + h - ky, x + w,
+                   y + h - ry,
+                   float(Tessellator::LINETO), x + w, y + ry,
+                   float(Tessellator::BEZIERTO), x + w, y + ky, x + w - kx, y, x + w - rx, y,
+                   float(Tessellator::LINETO), x + rx, y,
+                   float(Tessellator::BEZIERTO), x + kx, y, x, y + ky, x, y + ry,
+                   float(Tessellator::CLOSE) };
+  appendCommands(vals, sizeof(vals) / sizeof(float));
 }
 void Context::roundedRect(const Rectf &rect, float r) {
   roundedRect(rect.getX1(), rect.getY1(), rect.getWidth(), rect.getHeight(), r);
 }
 void Context::ellipse(float cx, float cy, float rx, float ry) {
-  nvgEllipse(get(), cx, cy, rx, ry);
+  if (mRecording) return mRecording->ellipse(cx, cy, rx, ry);
+  float kx = rx * kKappa90, ky = ry * kKappa90;
+  float vals[] = { float(Tessellator::MOVETO), cx - rx, cy,
+                   float(Tessellator::BEZIERTO), cx - rx, cy + ky, cx - kx, cy + ry, cx, cy + ry,
+                   float(Tessellator::BEZIERTO), cx + kx, cy + ry, cx + rx, cy + ky, cx + rx, cy,
+                   float(Tessellator::BEZIERTO), cx + rx, cy - ky, cx + kx, cy - ry, cx, cy - ry,
+                   float(Tessellator::BEZIERTO), cx - kx, cy - ry, cx - rx, cy - ky, cx - rx, cy,
+                   float(Tessellator::CLOSE) };
+  appendCommands(vals, sizeof(vals) / sizeof(float));
 }
 void Context::ellipse(const vec2 &center, float rx, float ry) {
   ellipse(center.x, center.y, rx, ry);
 }
 void Context::circle(float cx, float cy, float r) {
-  nvgCircle(get(), cx, cy, r);
+  ellipse(cx, cy, r, r);
 }
 void Context::circle(const vec2 &center, float radius) {
   circle(center.x, center.y, radius);
 }
 
+void Context::moveToLines(const vec2 *pts, size_t count, bool closed) {
+  if (count == 0) return;
+
+  if (mRecording) return mRecording->moveToLines(pts, count, closed);
+
+  size_t offset = mCommands.size();
+  mCommands.resize(offset + count * 3 + (closed ? 1 : 0));
+  float *dst = mCommands.data() + offset;
+
+  static_assert(sizeof(vec2) == sizeof(float) * 2, "vec2 must be two packed floats");
+  transformLineCommands(dst, &pts[0].x, count, mStates.back().xform);
+  dst[0] = float(Tessellator::MOVETO);
+  if (closed) dst[count * 3] = float(Tessellator::CLOSE);
+
+  mCommandPos = pts[count - 1];
+}
+void Context::polyLines(const vec2 *pts, const size_t *counts, size_t numLines, bool closed) {
+  for (size_t i = 0; i < numLines; ++i) {
+    moveToLines(pts, counts[i], closed);
+    pts += counts[i];
+  }
+}
+
+void Context::timeSeries(const float *ys, size_t count, const Rectf &plotRect, float minY,
+                         float maxY) {
+  Rectf dataBounds(0.0f, minY, count > 1 ? float(count - 1) : 1.0f, maxY);
+  appendSeries(nullptr, ys, count, plotRect, dataBounds);
+}
+void Context::timeSeries(const float *xs, const float *ys, size_t count, const Rectf &plotRect,
+                         const Rectf &dataBounds) {
+  appendSeries(xs, ys, count, plotRect, dataBounds);
+}
+
+void Context::appendSeries(const float *xs, const float *ys, size_t count, const Rectf &plotRect,
+                           const Rectf &dataBounds) {
+  if (count == 0) return;
+
+  float dataWidth = dataBounds.getWidth(), dataHeight = dataBounds.getHeight();
+  float sx = dataWidth != 0.0f ? plotRect.getWidth() / dataWidth : 0.0f;
+  float sy = dataHeight != 0.0f ? plotRect.getHeight() / dataHeight : 0.0f;
+  auto sampleX = [&](size_t i) { return xs ? xs[i] : float(i); };
+  auto plot = [&](size_t i) {
+    mSeriesPoints.emplace_back(plotRect.x1 + (sampleX(i) - dataBounds.x1) * sx,
+                               plotRect.y2 - (ys[i] - dataBounds.y1) * sy);
+  };
+
+  // Device pixel columns across the plot, in data units.
+  const float *t = mStates.back().xform;
+  float pixels = std::abs(plotRect.getWidth()) * std::sqrt(t[0] * t[0] + t[1] * t[1]) *
+                 mDevicePixelRatio;
+  double columns = std::ceil(pixels);
+  double columnWidth = columns > 0.0 ? dataWidth / columns : 0.0;
+
+  mSeriesPoints.clear();
+  if (count <= columns * 4.0 || columnWidth <= 0.0) {
+    // Nothing to gain, or no columns to reduce into.
+    for (size_t i = 0; i < count; ++i) plot(i);
+  } else {
+    for (size_t begin = 0; begin < count;) {
+      // The column of the sample at begin, and the first sample past it. Columns are counted
+      // from dataBounds.x1 but samples outside the bounds are kept as well.
+      double column = std::floor((sampleX(begin) - dataBounds.x1) / columnWidth);
+      double next = dataBounds.x1 + (column + 1.0) * columnWidth;
+      size_t end;
+      if (xs) {
+        end = size_t(std::lower_bound(xs + begin + 1, xs + count, float(next)) - xs);
+      } else {
+        end = size_t(std::min(std::max(std::ceil(next), double(begin + 1)), double(count)));
+      }
+
+      size_t lo, hi;
+      findMinMax(ys + begin, end - begin, lo, hi);
+      size_t indices[4] = { begin, begin + std::min(lo, hi), begin + std::max(lo, hi), end - 1 };
+      for (int k = 0; k < 4; ++k) {
+        if (k == 0 || indices[k] != indices[k - 1]) plot(indices[k]);
+      }
+      begin = end;
+    }
+  }
+
+  moveToLines(mSeriesPoints.data(), mSeriesPoints.size());
+}
+
+void Context::appendPath(const PathRef &path) {
+  auto &cmds = path.getCommands();
+  if (cmds.empty()) return;
+
+  if (mRecording) return mRecording->appendPath(path);
+
+  size_t offset = mCommands.size();
+  mCommands.resize(offset + cmds.size());
+  transformCommands(mCommands.data() + offset, cmds.data(), cmds.size(), mStates.back().xform);
+  mCommandPos = path.getEndPoint();
+}
+void Context::appendPath(const float *commands, size_t count) {
+  if (count == 0) return;
+
+  if (mRecording) return mRecording->appendPath(commands, count);
+
+  size_t offset = mCommands.size();
+  mCommands.resize(offset + count);
+  transformCommands(mCommands.data() + offset, commands, count, mStates.back().xform);
+  if (const float *p = findEndPoint(commands, count)) mCommandPos = vec2(p[0], p[1]);
+}
+
+// Both follow nvgFill / nvgStroke, but tessellate with the wrapper's own tessellator (or take
+// vertices from the cache) and call the backend directly.
+
 void Context::fill() {
-  nvgFill(get());
+  if (mRecording) return mRecording->fill();
+  drawPath(false, currentFillPaint(), 0.0f);
 }
 void Context::stroke() {
-  nvgStroke(get());
+  if (mRecording) return mRecording->stroke();
+
+  float strokeWidth;
+  NVGpaint paint = currentStrokePaint(strokeWidth);
+  drawPath(true, paint, strokeWidth);
+}
+
+void Context::stroke(StreamingPolyline &polyline) {
+  if (polyline.size() < 2) return;
+
+  if (mRecording) {
+    // Recorded as a plain path, since the stroke depends on the transform at replay.
+    auto pts = polyline.getPoints();
+    mRecording->beginPath();
+    mRecording->moveToLines(pts.data(), pts.size());
+    return mRecording->stroke();
+  }
+  if (!mBackendMonitor) return;
+
+  // Drawn straight to the backend, after anything deferred before it.
+  if (mTessellationPool) flushDeferred();
+
+  const auto &state = mStates.back();
+  PathDraw draw = {};
+  draw.stroke = true;
+  draw.antiAlias = isShapeAntiAliased();
+  draw.tessellated = true;
+  draw.paint = currentStrokePaint(draw.strokeWidth);
+  draw.compositeOperation = state.compositeOperation;
+  draw.scissor = state.scissor;
+  draw.fringe = mTessellator.getFringeWidth();
+  draw.miterLimit = state.miterLimit;
+  draw.lineCap = state.lineCap;
+  draw.lineJoin = state.lineJoin;
+
+  // Keyed like a cached stroke, with the width expanded in canonical space.
+  TessellationCache::Key key = {};
+  key.flags = CACHE_STROKE | (state.lineCap << 4) | (state.lineJoin << 8) |
+              (draw.antiAlias ? CACHE_ANTIALIAS : 0);
+  key.fringe = draw.fringe;
+  key.miterLimit = state.miterLimit;
+  float canonical[6], remaining[6];
+  TessellationCache::splitTransform(state.xform, key, canonical, remaining);
+  key.strokeWidth = std::min(std::max(state.strokeWidth * getAverageScale(canonical),
+                                      draw.fringe), 200.0f);
+
+  auto &frame = mBackendMonitor->frame;
+  auto start = Clock::now();
+  frame.numPoints += polyline.expand(mTessellator, key, canonical,
+                                     draw.antiAlias ? draw.fringe : 0.0f, state.lineCap,
+                                     state.lineJoin);
+
+  // The start cap and the rest are two strips. They are drawn from the polyline's own vertices
+  // when the remaining transform is the identity, and copied with it applied otherwise.
+  size_t begin = polyline.getStrokeBegin();
+  size_t numHead = polyline.mHead.size(), numBody = polyline.mVerts.size() - begin;
+  NVGvertex *head = polyline.mHead.data(), *body = polyline.mVerts.data() + begin;
+  static const float kIdentity[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+  if (!std::equal(remaining, remaining + 6, kIdentity)) {
+    auto &verts = mTransformed.verts;
+    verts.resize(numHead + numBody);
+    transformVertices(verts.data(), head, numHead, remaining);
+    transformVertices(verts.data() + numHead, body, numBody, remaining);
+    head = verts.data();
+    body = verts.data() + numHead;
+  }
+
+  auto &paths = mTransformed.paths;
+  paths.assign(2, NVGpath());
+  paths[0].stroke = head;
+  paths[0].nstroke = int(numHead);
+  paths[1].stroke = body;
+  paths[1].nstroke = int(numBody);
+  frame.tessellationMs += elapsedMs(start);
+
+  renderPath(draw, paths.data(), int(paths.size()), mTransformed.bounds);
+}
+
+NVGpaint Context::currentStrokePaint(float &strokeWidth) const {
+  const auto &state = mStates.back();
+  NVGpaint paint = state.stroke;
+  float fringe = mTessellator.getFringeWidth();
+  strokeWidth = std::min(std::max(state.strokeWidth * getAverageScale(state.xform), 0.0f),
+                         200.0f);
+
+  if (strokeWidth < fringe) {
+    // If the stroke width is less than pixel size, use alpha to emulate coverage.
+    // Since coverage is area, scale by alpha*alpha.
+    float alpha = std::min(std::max(strokeWidth / fringe, 0.0f), 1.0f);
+    paint.innerColor.a *= alpha * alpha;
+    paint.outerColor.a *= alpha * alpha;
+    strokeWidth = fringe;
+  }
+  paint.innerColor.a *= state.alpha;
+  paint.outerColor.a *= state.alpha;
+  return paint;
+}
+NVGpaint Context::currentFillPaint() const {
+  const auto &state = mStates.back();
+  NVGpaint paint = state.fill;
+  paint.innerColor.a *= state.alpha;
+  paint.outerColor.a *= state.alpha;
+  return paint;
+}
+bool Context::isShapeAntiAliased() {
+  return mStates.back().shapeAntiAlias && nvgInternalParams(get())->edgeAntiAlias != 0;
+}
+
+void Context::drawPath(bool stroke, const NVGpaint &paint, float strokeWidth) {
+  if (!mBackendMonitor) return;
+
+  const auto &state = mStates.back();
+
+  PathDraw draw;
+  draw.stroke = stroke;
+  draw.antiAlias = isShapeAntiAliased();
+  draw.tessellated = false;
+  draw.paint = paint;
+  draw.compositeOperation = state.compositeOperation;
+  draw.scissor = state.scissor;
+  draw.fringe = mTessellator.getFringeWidth();
+  draw.strokeWidth = strokeWidth;
+  draw.miterLimit = state.miterLimit;
+  draw.lineCap = state.lineCap;
+  draw.lineJoin = state.lineJoin;
+  draw.begin = draw.end = 0;
+
+  auto &frame = mBackendMonitor->frame;
+  frame.numCommands += mCommands.size();
+
+  Tessellation *result = &mTransformed;
+  if (mTessellationPool) {
+    if (mNumDeferred == mDeferred.size()) {
+      mDeferred.emplace_back();
+      mDeferredTessellations.emplace_back();
+    }
+    result = &mDeferredTessellations[mNumDeferred];
+  }
+
+  if (mPathKey) {
+    TessellationCache::Key key = {};
+    key.path = mPathKey;
+    key.flags = (stroke ? CACHE_STROKE | (state.lineCap << 4) | (state.lineJoin << 8) : 0) |
+                (draw.antiAlias ? CACHE_ANTIALIAS : 0);
+    key.fringe = draw.fringe;
+    key.miterLimit = stroke ? state.miterLimit : 0.0f;
+
+    auto start = Clock::now();
+    tessellateCached(key, state.strokeWidth, *result);
+    frame.tessellationMs += elapsedMs(start);
+    draw.tessellated = true;
+  } else if (mTessellationPool) {
+    draw.begin = mDeferredCommands.size();
+    mDeferredCommands.insert(mDeferredCommands.end(), mCommands.begin(), mCommands.end());
+    draw.end = mDeferredCommands.size();
+  }
+
+  if (mTessellationPool) {
+    mDeferred[mNumDeferred++] = draw;
+  } else if (draw.tessellated) {
+    renderPath(draw, result->paths.data(), int(result->paths.size()), result->bounds);
+  } else {
+    auto start = Clock::now();
+    frame.numPoints += expandPath(mTessellator, draw, mCommands.data(), mCommands.size());
+    frame.tessellationMs += elapsedMs(start);
+    renderPath(draw, mTessellator.getPaths(), mTessellator.getNumPaths(),
+               mTessellator.getBounds());
+  }
+}
+
+size_t Context::expandPath(Tessellator &tess, const PathDraw &draw, const float *commands,
+                           size_t count) {
+  float fringe = draw.antiAlias ? draw.fringe : 0.0f;
+  tess.flatten(commands, count);
+  if (draw.stroke) {
+    tess.expandStroke(draw.strokeWidth * 0.5f, fringe, draw.lineCap, draw.lineJoin,
+                      draw.miterLimit);
+  } else {
+    tess.expandFill(fringe, NVG_MITER, 2.4f);
+  }
+  return tess.getNumPoints();
+}
+
+void Context::renderPath(const PathDraw &draw, const NVGpath *paths, int numPaths,
+                         const float *bounds) {
+  NVGparams *params = nvgInternalParams(get());
+  NVGpaint paint = draw.paint;
+  NVGscissor scissor = draw.scissor;
+  if (draw.stroke) {
+    params->renderStroke(params->userPtr, &paint, draw.compositeOperation, &scissor, draw.fringe,
+                         draw.strokeWidth, paths, numPaths);
+  } else {
+    params->renderFill(params->userPtr, &paint, draw.compositeOperation, &scissor, draw.fringe,
+                       bounds, paths, numPaths);
+  }
+}
+
+// Instancing //
+
+void Context::drawInstances(const PathRef &path, ArrayView<mat3> transforms,
+                            ArrayView<ColorAf> colors) {
+  assert(colors.empty() || colors.size() == transforms.size());
+  if (path.empty()) return;
+
+  if (mRecording) {
+    // Recorded as plain fills, since the tessellations depend on the transform at replay.
+    for (size_t i = 0; i < transforms.size(); ++i) {
+      mRecording->save();
+      mRecording->transform(transforms[i]);
+      mRecording->beginPath();
+      mRecording->appendPath(path);
+      if (!colors.empty()) mRecording->fillColor(colors[i]);
+      mRecording->fill();
+      mRecording->restore();
+    }
+    return;
+  }
+
+  auto &cmds = path.getCommands();
+  drawInstances(cmds.data(), cmds.size(), path.getId(), transforms, colors);
+}
+void Context::drawInstances(const Path2d &path, ArrayView<mat3> transforms,
+                            ArrayView<ColorAf> colors) {
+  if (mRecording) return drawInstances(PathRef(path), transforms, colors);
+
+  // Encoded into a reused buffer, and only cached for this call, so one-off paths don't fill
+  // the tessellation cache.
+  vec2 endPoint;
+  mInstanceCommands.clear();
+  PathRef::encode(path, mInstanceCommands, endPoint);
+  drawInstances(mInstanceCommands.data(), mInstanceCommands.size(), 0, transforms, colors);
+}
+
+void Context::drawInstances(const float *commands, size_t count, uint64_t pathKey,
+                            ArrayView<mat3> transforms, ArrayView<ColorAf> colors) {
+  if (count == 0 || transforms.empty() || !mBackendMonitor) return;
+
+  // Instances are drawn straight to the backend, after anything deferred before them.
+  if (mTessellationPool) flushDeferred();
+
+  const auto &state = mStates.back();
+  PathDraw draw = {};
+  draw.antiAlias = isShapeAntiAliased();
+  draw.tessellated = true;
+  draw.paint = currentFillPaint();
+  draw.compositeOperation = state.compositeOperation;
+  draw.scissor = state.scissor;
+  draw.fringe = mTessellator.getFringeWidth();
+  draw.miterLimit = state.miterLimit;
+  draw.lineCap = state.lineCap;
+  draw.lineJoin = state.lineJoin;
+
+  auto &frame = mBackendMonitor->frame;
+  auto start = Clock::now();
+  mInstanceIndices.clear();
+  mNumInstanceTessellations = 0;
+
+  for (size_t i = 0; i < transforms.size(); ++i) {
+    const mat3 &m = transforms[i];
+    float xform[6] = { m[0][0], m[0][1], m[1][0], m[1][1], m[2][0], m[2][1] };
+    nvgTransformMultiply(xform, state.xform);
+
+    TessellationCache::Key key = {};
+    float canonical[6], remaining[6];
+    TessellationCache::splitTransform(xform, key, canonical, remaining);
+    key.path = pathKey;
+    key.flags = draw.antiAlias ? CACHE_ANTIALIAS : 0;
+    key.fringe = draw.fringe;
+
+    const Tessellation *tess = tessellateInstance(commands, count, key, canonical);
+    mTransformed.assign(*tess, remaining);
+    if (!colors.empty()) {
+      draw.paint = colorPaint(reinterpret_cast<const NVGcolor &>(colors[i]));
+      draw.paint.innerColor.a *= state.alpha;
+      draw.paint.outerColor.a *= state.alpha;
+    }
+    renderPath(draw, mTransformed.paths.data(), int(mTransformed.paths.size()),
+               mTransformed.bounds);
+  }
+
+  frame.numCommands += count;
+  frame.tessellationMs += elapsedMs(start);
+}
+
+const Tessellation *Context::tessellateInstance(const float *commands, size_t count,
+                                                TessellationCache::Key &key,
+                                                const float *canonical) {
+  bool keep = key.scale != TessellationCache::kGeneral;
+  if (keep && key.path) {
+    if (const Tessellation *tess = mTessellationCache.find(key)) return tess;
+  } else if (keep) {
+    auto it = mInstanceIndices.find(key);
+    if (it != mInstanceIndices.end()) return &mInstanceTessellations[it->second];
+  }
+
+  mCanonicalCommands.resize(count);
+  transformCommands(mCanonicalCommands.data(), commands, count, canonical);
+  mTessellator.flatten(mCanonicalCommands.data(), count);
+  mTessellator.expandFill((key.flags & CACHE_ANTIALIAS) ? key.fringe : 0.0f, NVG_MITER, 2.4f);
+  mBackendMonitor->frame.numPoints += mTessellator.getNumPoints();
+
+  if (keep && key.path) {
+    Tessellation entry;
+    entry.assign(mTessellator);
+    return mTessellationCache.insert(key, std::move(entry));
+  }
+
+  // Unkept tessellations go in the next free entry without taking it, and are overwritten by the
+  // next instance.
+  if (mNumInstanceTessellations == mInstanceTessellations.size()) {
+    mInstanceTessellations.emplace_back();
+  }
+  auto &slot = mInstanceTessellations[mNumInstanceTessellations];
+  slot.assign(mTessellator);
+  if (keep) mInstanceIndices[key] = mNumInstanceTessellations++;
+  return &slot;
+}
+
+// Shapes //
+
+void Context::fillCircles(ArrayView<vec2> centers, float radius) {
+  if (centers.empty() || radius <= 0.0f) return;
+
+  float scale, v;
+  if (!beginShapes(scale, v)) {
+    stashPath();
+    for (size_t i = 0; i < centers.size(); ++i) {
+      beginPath();
+      circle(centers[i], radius);
+      fill();
+    }
+    return restorePath();
+  }
+
+  vec2 axisX(1.0f, 0.0f), axisY(0.0f, 1.0f);
+  const float *t = mStates.back().xform;
+  for (size_t i = 0; i < centers.size(); ++i) {
+    const vec2 &c = centers[i];
+    vec2 center(t[0] * c.x + t[2] * c.y + t[4], t[1] * c.x + t[3] * c.y + t[5]);
+    float r = radius * scale;
+    emitRoundedRect(center, axisX, axisY, r, r, r, false, v);
+  }
+  endShapes(centers.size());
+}
+void Context::fillCircles(ArrayView<vec2> centers, ArrayView<float> radii) {
+  assert(centers.size() == radii.size());
+  if (centers.empty()) return;
+
+  float scale, v;
+  if (!beginShapes(scale, v)) {
+    stashPath();
+    for (size_t i = 0; i < centers.size(); ++i) {
+      if (radii[i] <= 0.0f) continue;
+      beginPath();
+      circle(centers[i], radii[i]);
+      fill();
+    }
+    return restorePath();
+  }
+
+  vec2 axisX(1.0f, 0.0f), axisY(0.0f, 1.0f);
+  const float *t = mStates.back().xform;
+  for (size_t i = 0; i < centers.size(); ++i) {
+    if (radii[i] <= 0.0f) continue;
+    const vec2 &c = centers[i];
+    vec2 center(t[0] * c.x + t[2] * c.y + t[4], t[1] * c.x + t[3] * c.y + t[5]);
+    float r = radii[i] * scale;
+    emitRoundedRect(center, axisX, axisY, r, r, r, false, v);
+  }
+  endShapes(centers.size());
+}
+void Context::fillRects(ArrayView<Rectf> rects) {
+  fillRoundedRects(rects, 0.0f);
+}
+void Context::fillRoundedRects(ArrayView<Rectf> rects, float radius) {
+  if (rects.empty()) return;
+
+  float scale, v;
+  if (!beginShapes(scale, v)) {
+    stashPath();
+    for (size_t i = 0; i < rects.size(); ++i) {
+      beginPath();
+      roundedRect(rects[i], radius);
+      fill();
+    }
+    return restorePath();
+  }
+
+  // Rects are laid out along the transformed axes, which flip the winding when mirrored.
+  const float *t = mStates.back().xform;
+  vec2 axisX(t[0] / scale, t[1] / scale), axisY(t[2] / scale, t[3] / scale);
+  bool flip = t[0] * t[3] - t[1] * t[2] < 0.0f;
+  for (size_t i = 0; i < rects.size(); ++i) {
+    vec2 c = rects[i].getCenter();
+    vec2 center(t[0] * c.x + t[2] * c.y + t[4], t[1] * c.x + t[3] * c.y + t[5]);
+    float ex = std::abs(rects[i].getWidth()) * 0.5f, ey = std::abs(rects[i].getHeight()) * 0.5f;
+    // Matches roundedRect(), which draws a plain rect below a radius of 0.1.
+    float r = radius < 0.1f ? 0.0f : std::min(radius, std::min(ex, ey));
+    emitRoundedRect(center, axisX, axisY, ex * scale, ey * scale, r * scale, flip, v);
+  }
+  endShapes(rects.size());
+}
+
+bool Context::beginShapes(float &scale, float &paletteV) {
+  // The fallback's fills do nothing without a context.
+  if (mRecording || !mBackendMonitor) return false;
+
+  // Outlines are offset in screen space, so the transform may only rotate, scale uniformly,
+  // mirror and translate.
+  const float *t = mStates.back().xform;
+  float sx = t[0] * t[0] + t[1] * t[1], sy = t[2] * t[2] + t[3] * t[3];
+  float dot = t[0] * t[2] + t[1] * t[3];
+  float eps = std::max(sx, sy) * 1e-4f;
+  if (sx <= 0.0f || std::abs(sx - sy) > eps || std::abs(dot) > eps) return false;
+  scale = std::sqrt(sx);
+
+  // Shapes go to the backend right away, after anything deferred before them.
+  if (mTessellationPool) flushDeferred();
+  return beginShapeBatch(paletteV);
+}
+
+bool Context::beginShapeBatch(float &paletteV) {
+  const auto &state = mStates.back();
+  return mBackendMonitor->beginCoverageBatch(currentFillPaint(), state.compositeOperation,
+                                             state.scissor, mTessellator.getFringeWidth(),
+                                             paletteV);
+}
+
+void Context::endShapes(size_t count) {
+  auto &monitor = *mBackendMonitor;
+  monitor.frame.numBatchedDraws += count;
+  if (!monitor.batching) monitor.flushBatch();
+}
+
+void Context::emitRoundedRect(const vec2 &center, const vec2 &axisX, const vec2 &axisY, float ex,
+                              float ey, float radius, bool flip, float &paletteV) {
+  // Corners are divided like the tessellator divides round joins, with at most 64 segments per
+  // quarter, and at least 2 for circles. A radius of 0 leaves one point per corner.
+  bool circle = radius >= ex && radius >= ey;
+  int segments = 0;
+  if (radius > 0.0f) {
+    float da = std::acos(radius / (radius + mTessellator.getTessTol())) * 2.0f;
+    segments = std::min(std::max(int(std::ceil(kPi * 0.5f / std::max(da, 1e-3f))),
+                                 circle ? 2 : 1), 64);
+  }
+
+  // The unit directions of one quarter, from 0 to 90 degrees.
+  if (mCornerDirs.size() != size_t(segments) + 1) {
+    mCornerDirs.resize(segments + 1);
+    for (int i = 0; i <= segments; ++i) {
+      float a = segments ? kPi * 0.5f * i / segments : kPi * 0.25f;
+      mCornerDirs[i] = vec2(std::cos(a), std::sin(a));
+    }
+  }
+
+  // The inner outline is inset by half the fringe, or up to the middle of shapes thinner than
+  // the fringe, whose coverage is scaled down instead. The outer one is outset by half of it.
+  bool antiAlias = isShapeAntiAliased();
+  float half = antiAlias ? mTessellator.getFringeWidth() * 0.5f : 0.0f;
+  float inset = std::min(half, std::min(ex, ey));
+  float innerCoverage = 1.0f;
+  if (antiAlias && half > 0.0f) {
+    innerCoverage = std::min(ex / half, 1.0f) * std::min(ey / half, 1.0f);
+  }
+
+  // A circle's corners share their ends, so each quarter skips its first direction.
+  size_t first = circle && segments > 0 ? 1 : 0;
+  size_t numPoints = 4 * (mCornerDirs.size() - first);
+  mShapeInner.resize(numPoints);
+  mShapeOuter.resize(antiAlias ? numPoints : 0);
+
+  auto outline = [&](vec2 *dst, float hx, float hy, float r) {
+    float cx = hx - r, cy = hy - r;
+    for (int corner = 0; corner < 4; ++corner) {
+      for (size_t i = first; i < mCornerDirs.size(); ++i) {
+        // Quarters in order of increasing angle, rotated by 90 degrees each.
+        vec2 d = mCornerDirs[i];
+        float px, py;
+        switch (corner) {
+        case 0: px = cx + r * d.x; py = cy + r * d.y; break;
+        case 1: px = -cx - r * d.y; py = cy + r * d.x; break;
+        case 2: px = -cx - r * d.x; py = -cy - r * d.y; break;
+        default: px = cx + r * d.y; py = -cy - r * d.x; break;
+        }
+        *dst++ = center + axisX * px + axisY * py;
+      }
+    }
+  };
+  outline(mShapeInner.data(), ex - inset, ey - inset, std::max(radius - inset, 0.0f));
+  if (antiAlias) {
+    outline(mShapeOuter.data(), ex + half, ey + half, radius > 0.0f ? radius + half : 0.0f);
+  }
+
+  emitShape(center, innerCoverage, flip, paletteV);
+}
+
+void Context::emitShape(const vec2 &center, float innerCoverage, bool flip, float &paletteV) {
+  auto &monitor = *mBackendMonitor;
+  size_t n = mShapeInner.size();
+  bool antiAlias = !mShapeOuter.empty();
+  if (monitor.batchVerts.size() + n * (antiAlias ? 9 : 3) > kMaxShapeVertices) {
+    monitor.flushBatch();
+    beginShapeBatch(paletteV);
+  }
+
+  // Outlines run by increasing angle, so triangles take their points in reverse to keep the
+  // winding the backend culls by, unless the transform mirrors them.
+  auto &verts = monitor.batchVerts;
+  float v = paletteV;
+  auto triangle = [&](const vec2 &a, float ca, const vec2 &b, float cb, const vec2 &c, float cc) {
+    verts.push_back(coverageVertex(a.x, a.y, ca, v));
+    if (flip) {
+      verts.push_back(coverageVertex(c.x, c.y, cc, v));
+      verts.push_back(coverageVertex(b.x, b.y, cb, v));
+    } else {
+      verts.push_back(coverageVertex(b.x, b.y, cb, v));
+      verts.push_back(coverageVertex(c.x, c.y, cc, v));
+    }
+  };
+
+  for (size_t i = 0; i < n; ++i) {
+    size_t j = i + 1 < n ? i + 1 : 0;
+    triangle(center, innerCoverage, mShapeInner[j], innerCoverage, mShapeInner[i], innerCoverage);
+    if (antiAlias) {
+      triangle(mShapeInner[i], innerCoverage, mShapeInner[j], innerCoverage, mShapeOuter[j],
+               0.0f);
+      triangle(mShapeInner[i], innerCoverage, mShapeOuter[j], 0.0f, mShapeOuter[i], 0.0f);
+    }
+  }
+}
+
+void Context::stashPath() {
+  if (mRecording) return;
+  mStashedCommands.swap(mCommands);
+  mStashedCommandPos = mCommandPos;
+  mStashedPathKey = mPathKey;
+}
+void Context::restorePath() {
+  if (mRecording) return;
+  mCommands.swap(mStashedCommands);
+  mCommandPos = mStashedCommandPos;
+  mPathKey = mStashedPathKey;
 }
 
 // Text //
@@ -350,41 +1997,80 @@ int Context::createFont(const std::string &name, const std::string &filename) {
   return nvgCreateFont(get(), name.c_str(), filename.c_str());
 }
 int Context::findFont(const std::string &name) {
-  return nvgFindFont(get(), name.c_str());
+  return findFont(name.c_str());
+}
+int Context::findFont(const char *name) {
+  return nvgFindFont(get(), name);
+}
+int Context::createFontFromRegistry(const std::string &name) {
+  auto blob = FontRegistry::shared().acquire(name);
+  if (!blob) return -1;
+
+  // nanovg doesn't write to font data it was told not to free.
+  int font = nvgCreateFontMem(get(), name.c_str(), const_cast<unsigned char *>(blob->getData()),
+                              int(blob->getSize()), 0);
+  if (font >= 0) mFontBlobs.push_back(std::move(blob));
+  return font;
 }
 
 void Context::fontSize(float size) {
+  if (mRecording) return mRecording->fontSize(size);
   nvgFontSize(get(), size);
 }
 void Context::fontBlur(float blur) {
+  if (mRecording) return mRecording->fontBlur(blur);
   nvgFontBlur(get(), blur);
 }
 void Context::fontFaceId(int font) {
+  if (mRecording) return mRecording->fontFaceId(font);
   nvgFontFaceId(get(), font);
+  mStates.back().font = font;
 }
 void Context::fontFace(const std::string &font) {
-  nvgFontFace(get(), font.c_str());
+  fontFace(font.c_str());
+}
+void Context::fontFace(const char *font) {
+  if (mRecording) return mRecording->fontFace(font);
+  fontFaceId(getFontHandle(font).id);
+}
+void Context::fontFace(FontHandle font) {
+  fontFaceId(font.id);
+}
+
+FontHandle Context::getFontHandle(const std::string &name) {
+  return getFontHandle(name.c_str());
+}
+FontHandle Context::getFontHandle(const char *name) {
+  int font = nvgFindFont(get(), name);
+  if (font < 0) {
+    std::string str(name);
+    if (FontRegistry::shared().contains(str)) font = createFontFromRegistry(str);
+  }
+  return font;
 }
 
 void Context::textLetterSpacing(float spacing) {
+  if (mRecording) return mRecording->textLetterSpacing(spacing);
   nvgTextLetterSpacing(get(), spacing);
 }
 void Context::textLineHeight(float lineHeight) {
+  if (mRecording) return mRecording->textLineHeight(lineHeight);
   nvgTextLineHeight(get(), lineHeight);
 }
 void Context::textAlign(int align) {
+  if (mRecording) return mRecording->textAlign(align);
   nvgTextAlign(get(), align);
 }
 
 float Context::text(float x, float y, const std::string &str) {
-  return nvgText(get(), x, y, str.c_str(), NULL);
+  return text(x, y, str.data(), str.data() + str.size());
 }
 float Context::text(const vec2 &p, const std::string &str) {
   return text(p.x, p.y, str);
 }
 
 void Context::textBox(float x, float y, float breakRowWidth, const std::string &str) {
-  nvgTextBox(get(), x, y, breakRowWidth, str.c_str(), NULL);
+  textBox(x, y, breakRowWidth, str.data(), str.data() + str.size());
 }
 void Context::textBox(const vec2 &p, float breakRowWidth, const std::string &str) {
   textBox(p.x, p.y, breakRowWidth, str);
@@ -393,19 +2079,76 @@ void Context::textBox(const Rectf &rect, const std::string &str) {
   textBox(rect.getX1(), rect.getY1(), rect.getWidth(), str);
 }
 
+float Context::text(float x, float y, const char *str, const char *end) {
+  if (mRecording) {
+    mRecording->text(x, y, str, end);
+    return 0.0f;
+  }
+  flushDeferred();
+  return nvgText(get(), x, y, str, end);
+}
+float Context::text(const vec2 &p, const char *str, const char *end) {
+  return text(p.x, p.y, str, end);
+}
+
+void Context::textBox(float x, float y, float breakRowWidth, const char *str, const char *end) {
+  if (mRecording) return mRecording->textBox(x, y, breakRowWidth, str, end);
+  flushDeferred();
+  nvgTextBox(get(), x, y, breakRowWidth, str, end);
+}
+void Context::textBox(const vec2 &p, float breakRowWidth, const char *str, const char *end) {
+  textBox(p.x, p.y, breakRowWidth, str, end);
+}
+void Context::textBox(const Rectf &rect, const char *str, const char *end) {
+  textBox(rect.getX1(), rect.getY1(), rect.getWidth(), str, end);
+}
+
+void Context::text(const TextLayout &layout, const vec2 &p) {
+  if (layout.empty()) return;
+
+  const auto &style = layout.getStyle();
+  int align = NVG_ALIGN_LEFT |
+              (style.align & ~(NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT));
+  const char *str = layout.getText().c_str();
+
+  if (mRecording) {
+    mRecording->save();
+    mRecording->fontFace(style.font);
+    mRecording->fontSize(style.size);
+    mRecording->textLetterSpacing(style.letterSpacing);
+    mRecording->textLineHeight(style.lineHeight);
+    mRecording->textAlign(align);
+    for (auto &row : layout.getRows()) {
+      mRecording->text(p.x + row.x, p.y + row.y, str + row.begin, str + row.end);
+    }
+    mRecording->restore();
+    return;
+  }
+
+  flushDeferred();
+
+  NVGcontext *vg = get();
+  nvgSave(vg);
+  nvgFontFaceId(vg, style.font.id);
+  nvgFontSize(vg, style.size);
+  nvgTextLetterSpacing(vg, style.letterSpacing);
+  nvgTextLineHeight(vg, style.lineHeight);
+  nvgTextAlign(vg, align);
+  for (auto &row : layout.getRows()) {
+    nvgText(vg, p.x + row.x, p.y + row.y, str + row.begin, str + row.end);
+  }
+  nvgRestore(vg);
+}
+
 Rectf Context::textBounds(float x, float y, const std::string &str) {
-  Rectf bounds;
-  nvgTextBounds(get(), x, y, str.c_str(), NULL, &bounds.x1);
-  return bounds;
+  return textBounds(x, y, str.data(), str.data() + str.size());
 }
 Rectf Context::textBounds(const vec2 &p, const std::string &str) {
   return textBounds(p.x, p.y, str);
 }
 
 Rectf Context::textBoxBounds(float x, float y, float breakRowWidth, const std::string &str) {
-  Rectf bounds;
-  nvgTextBoxBounds(get(), x, y, breakRowWidth, str.c_str(), NULL, &bounds.x1);
-  return bounds;
+  return textBoxBounds(x, y, breakRowWidth, str.data(), str.data() + str.size());
 }
 Rectf Context::textBoxBounds(const vec2 &p, float breakRowWidth, const std::string &str) {
   return textBoxBounds(p.x, p.y, breakRowWidth, str);
@@ -414,5 +2157,28 @@ Rectf Context::textBoxBounds(const Rectf &rect, const std::string &str) {
   return textBoxBounds(rect.getX1(), rect.getY1(), rect.getWidth(), str);
 }
 
+Rectf Context::textBounds(float x, float y, const char *str, const char *end) {
+  Rectf bounds;
+  nvgTextBounds(get(), x, y, str, end, &bounds.x1);
+  return bounds;
+}
+Rectf Context::textBounds(const vec2 &p, const char *str, const char *end) {
+  return textBounds(p.x, p.y, str, end);
+}
+
+Rectf Context::textBoxBounds(float x, float y, float breakRowWidth, const char *str,
+                             const char *end) {
+  Rectf bounds;
+  nvgTextBoxBounds(get(), x, y, breakRowWidth, str, end, &bounds.x1);
+  return bounds;
+}
+Rectf Context::textBoxBounds(const vec2 &p, float breakRowWidth, const char *str,
+                             const char *end) {
+  return textBoxBounds(p.x, p.y, breakRowWidth, str, end);
+}
+Rectf Context::textBoxBounds(const Rectf &rect, const char *str, const char *end) {
+  return textBoxBounds(rect.getX1(), rect.getY1(), rect.getWidth(), str, end);
+}
+
 } // nvg
 } // cinder
@@ -0,0 +1,77 @@
+#include "ci_nanovg_null.hpp"
+
+#include <cstring>
+#include <map>
+
+namespace cinder { namespace nvg {
+
+namespace {
+
+struct RendererNull {
+  std::map<int, ivec2> textures;
+  int nextTexture = 1;
+};
+
+RendererNull *renderer(void *uptr) {
+  return static_cast<RendererNull *>(uptr);
+}
+
+int renderCreate(void *) {
+  return 1;
+}
+int renderCreateTexture(void *uptr, int, int w, int h, int, const unsigned char *) {
+  int image = renderer(uptr)->nextTexture++;
+  renderer(uptr)->textures[image] = ivec2(w, h);
+  return image;
+}
+int renderDeleteTexture(void *uptr, int image) {
+  return renderer(uptr)->textures.erase(image) ? 1 : 0;
+}
+int renderUpdateTexture(void *uptr, int image, int, int, int, int, const unsigned char *) {
+  return renderer(uptr)->textures.count(image) ? 1 : 0;
+}
+int renderGetTextureSize(void *uptr, int image, int *w, int *h) {
+  auto it = renderer(uptr)->textures.find(image);
+  if (it == renderer(uptr)->textures.end()) return 0;
+  *w = it->second.x;
+  *h = it->second.y;
+  return 1;
+}
+void renderViewport(void *, float, float, float) {}
+void renderCancel(void *) {}
+void renderFlush(void *) {}
+void renderFill(void *, NVGpaint *, NVGcompositeOperationState, NVGscissor *, float,
+                const float *, const NVGpath *, int) {}
+void renderStroke(void *, NVGpaint *, NVGcompositeOperationState, NVGscissor *, float, float,
+                  const NVGpath *, int) {}
+void renderTriangles(void *, NVGpaint *, NVGcompositeOperationState, NVGscissor *,
+                     const NVGvertex *, int, float) {}
+void renderDelete(void *uptr) {
+  delete renderer(uptr);
+}
+
+} // anonymous namespace
+
+Context createContextNull(bool antiAlias) {
+  NVGparams params;
+  std::memset(&params, 0, sizeof(params));
+  params.userPtr = new RendererNull();
+  params.edgeAntiAlias = antiAlias ? 1 : 0;
+  params.renderCreate = renderCreate;
+  params.renderCreateTexture = renderCreateTexture;
+  params.renderDeleteTexture = renderDeleteTexture;
+  params.renderUpdateTexture = renderUpdateTexture;
+  params.renderGetTextureSize = renderGetTextureSize;
+  params.renderViewport = renderViewport;
+  params.renderCancel = renderCancel;
+  params.renderFlush = renderFlush;
+  params.renderFill = renderFill;
+  params.renderStroke = renderStroke;
+  params.renderTriangles = renderTriangles;
+  params.renderDelete = renderDelete;
+
+  // NOTE: If creation fails nanovg has already deleted the renderer through renderDelete.
+  return { nvgCreateInternal(&params), nvgDeleteInternal };
+}
+
+}} // cinder::nvg
@@ -0,0 +1,1021 @@
+#include "ci_nanovg_sw.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace cinder { namespace nvg {
+
+// The rasterizer mirrors nanovg_gl.h as closely as it can: the same shader math, the same stencil
+// passes for concave fills and stencil strokes, back-face culling on everything but the stencil
+// pass, and blending on premultiplied colors. Each tile replays the frame's calls in order, so
+// tiles never share pixels and need no synchronisation.
+
+namespace sw {
+
+const int kTileSize = 64;
+
+enum ShaderType { SHADER_FILLGRAD, SHADER_FILLIMG, SHADER_IMG };
+enum CallType { CALL_FILL, CALL_CONVEXFILL, CALL_STROKE, CALL_TRIANGLES };
+enum Topology { TOPOLOGY_FAN, TOPOLOGY_STRIP, TOPOLOGY_LIST };
+
+struct Texture {
+  int type = 0, width = 0, height = 0, flags = 0;
+  std::vector<uint8_t> data;
+};
+
+struct Frag {
+  float scissorMat[6];
+  float paintMat[6];
+  float scissorExt[2];
+  float scissorScale[2];
+  float extent[2];
+  float radius, feather, strokeMult, strokeThr;
+  NVGcolor innerCol, outerCol;
+  int type, texType;
+  const Texture *tex;
+};
+
+struct PathRange {
+  int fillOffset, fillCount;
+  int strokeOffset, strokeCount;
+};
+
+struct Call {
+  CallType type;
+  int pathOffset, pathCount;
+  int triangleOffset, triangleCount;
+  int fragOffset;
+  NVGcompositeOperationState blend;
+  int x0, y0, x1, y1;
+};
+
+struct TileBuffer {
+  int x0, y0, width, height;
+  std::vector<NVGcolor> color;
+  std::vector<uint8_t> stencil;
+};
+
+inline float clamp01(float x) {
+  return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+inline NVGcolor premul(NVGcolor c) {
+  c.r *= c.a;
+  c.g *= c.a;
+  c.b *= c.a;
+  return c;
+}
+
+inline void xformPoint(const float *m, float x, float y, float &ox, float &oy) {
+  ox = m[0] * x + m[2] * y + m[4];
+  oy = m[1] * x + m[3] * y + m[5];
+}
+
+inline float sdroundrect(float px, float py, float ex, float ey, float rad) {
+  float dx = std::fabs(px) - (ex - rad);
+  float dy = std::fabs(py) - (ey - rad);
+  float ox = std::max(dx, 0.0f), oy = std::max(dy, 0.0f);
+  return std::min(std::max(dx, dy), 0.0f) + std::sqrt(ox * ox + oy * oy) - rad;
+}
+
+inline int wrapCoord(int i, int size, bool repeat) {
+  if (repeat) {
+    i %= size;
+    return i < 0 ? i + size : i;
+  }
+  return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+NVGcolor fetch(const Texture &tex, int x, int y) {
+  x = wrapCoord(x, tex.width, (tex.flags & NVG_IMAGE_REPEATX) != 0);
+  y = wrapCoord(y, tex.height, (tex.flags & NVG_IMAGE_REPEATY) != 0);
+
+  NVGcolor c;
+  if (tex.type == NVG_TEXTURE_RGBA) {
+    const uint8_t *p = &tex.data[(y * tex.width + x) * 4];
+    c.r = p[0] / 255.0f;
+    c.g = p[1] / 255.0f;
+    c.b = p[2] / 255.0f;
+    c.a = p[3] / 255.0f;
+  }
+  else {
+    // Alpha textures are single channel (GL_RED), which samples as (r, 0, 0, 1).
+    c.r = tex.data[y * tex.width + x] / 255.0f;
+    c.g = c.b = 0.0f;
+    c.a = 1.0f;
+  }
+  return c;
+}
+
+NVGcolor sample(const Texture &tex, float u, float v) {
+  float x = u * tex.width, y = v * tex.height;
+
+  if (tex.flags & NVG_IMAGE_NEAREST) {
+    return fetch(tex, int(std::floor(x)), int(std::floor(y)));
+  }
+
+  x -= 0.5f;
+  y -= 0.5f;
+  float fx0 = std::floor(x), fy0 = std::floor(y);
+  float tx = x - fx0, ty = y - fy0;
+  int x0 = int(fx0), y0 = int(fy0);
+
+  NVGcolor c00 = fetch(tex, x0, y0), c10 = fetch(tex, x0 + 1, y0);
+  NVGcolor c01 = fetch(tex, x0, y0 + 1), c11 = fetch(tex, x0 + 1, y0 + 1);
+
+  NVGcolor c;
+  for (int i = 0; i < 4; ++i) {
+    float top = c00.rgba[i] + (c10.rgba[i] - c00.rgba[i]) * tx;
+    float bottom = c01.rgba[i] + (c11.rgba[i] - c01.rgba[i]) * tx;
+    c.rgba[i] = top + (bottom - top) * ty;
+  }
+  return c;
+}
+
+inline NVGcolor convertTexel(NVGcolor c, int texType) {
+  if (texType == 1) {
+    c.r *= c.a;
+    c.g *= c.a;
+    c.b *= c.a;
+  }
+  else if (texType == 2) {
+    c.g = c.b = c.a = c.r;
+  }
+  return c;
+}
+
+inline float blendFactor(int factor, float src, float srcA, float dst, float dstA, bool alpha) {
+  switch (factor) {
+    case NVG_ZERO: return 0.0f;
+    case NVG_ONE: return 1.0f;
+    case NVG_SRC_COLOR: return src;
+    case NVG_ONE_MINUS_SRC_COLOR: return 1.0f - src;
+    case NVG_DST_COLOR: return dst;
+    case NVG_ONE_MINUS_DST_COLOR: return 1.0f - dst;
+    case NVG_SRC_ALPHA: return srcA;
+    case NVG_ONE_MINUS_SRC_ALPHA: return 1.0f - srcA;
+    case NVG_DST_ALPHA: return dstA;
+    case NVG_ONE_MINUS_DST_ALPHA: return 1.0f - dstA;
+    case NVG_SRC_ALPHA_SATURATE: return alpha ? 1.0f : std::min(srcA, 1.0f - dstA);
+  }
+  return 0.0f;
+}
+
+inline void blend(const NVGcompositeOperationState &op, const NVGcolor &src, NVGcolor &dst,
+                  bool clamp) {
+  if (op.srcRGB == NVG_ONE && op.dstRGB == NVG_ONE_MINUS_SRC_ALPHA &&
+      op.srcAlpha == NVG_ONE && op.dstAlpha == NVG_ONE_MINUS_SRC_ALPHA) {
+    float ia = 1.0f - src.a;
+    for (int i = 0; i < 4; ++i) dst.rgba[i] = src.rgba[i] + dst.rgba[i] * ia;
+  }
+  else {
+    NVGcolor d = dst;
+    for (int i = 0; i < 4; ++i) {
+      bool alpha = i == 3;
+      float sf = blendFactor(alpha ? op.srcAlpha : op.srcRGB, src.rgba[i], src.a, d.rgba[i], d.a,
+                             alpha);
+      float df = blendFactor(alpha ? op.dstAlpha : op.dstRGB, src.rgba[i], src.a, d.rgba[i], d.a,
+                             alpha);
+      dst.rgba[i] = src.rgba[i] * sf + d.rgba[i] * df;
+    }
+  }
+  if (clamp) {
+    for (int i = 0; i < 4; ++i) dst.rgba[i] = clamp01(dst.rgba[i]);
+  }
+}
+
+// Edge function of the directed edge p->q, evaluated at (x, y). Positive on the inside of a
+// triangle whose vertices are ordered so that edge(a, b, c) > 0.
+inline float edge(float px, float py, float qx, float qy, float x, float y) {
+  return (qx - px) * (y - py) - (qy - py) * (x - px);
+}
+
+// Top-left fill rule for pixel centers that land exactly on an edge.
+inline bool isTopLeft(float px, float py, float qx, float qy) {
+  float dx = qx - px, dy = qy - py;
+  return (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+}
+
+// Calls fn(index, u, v, x, y, front) for every pixel center of the tile covered by the triangle,
+// where index addresses the tile buffers, (u, v) is the interpolated texture coordinate and
+// (x, y) is the pixel center in device pixels.
+template <typename Fn>
+void rasterTriangle(const TileBuffer &tile, const NVGvertex *a, const NVGvertex *b,
+                    const NVGvertex *c, Fn &fn) {
+  float area = edge(a->x, a->y, b->x, b->y, c->x, c->y);
+  if (area == 0.0f) return;
+
+  // Front faces are counter-clockwise once GL flips y, which is clockwise in nanovg's coords.
+  bool front = area < 0.0f;
+  if (front) {
+    std::swap(b, c);
+    area = -area;
+  }
+
+  float minX = std::min(a->x, std::min(b->x, c->x)), maxX = std::max(a->x, std::max(b->x, c->x));
+  float minY = std::min(a->y, std::min(b->y, c->y)), maxY = std::max(a->y, std::max(b->y, c->y));
+
+  int x0 = std::max(tile.x0, int(std::ceil(minX - 0.5f)));
+  int x1 = std::min(tile.x0 + tile.width - 1, int(std::floor(maxX - 0.5f)));
+  int y0 = std::max(tile.y0, int(std::ceil(minY - 0.5f)));
+  int y1 = std::min(tile.y0 + tile.height - 1, int(std::floor(maxY - 0.5f)));
+  if (x0 > x1 || y0 > y1) return;
+
+  bool tl0 = isTopLeft(b->x, b->y, c->x, c->y);
+  bool tl1 = isTopLeft(c->x, c->y, a->x, a->y);
+  bool tl2 = isTopLeft(a->x, a->y, b->x, b->y);
+
+  // Per-pixel increments of the three edge functions along x.
+  float dw0 = -(c->y - b->y), dw1 = -(a->y - c->y), dw2 = -(b->y - a->y);
+  float invArea = 1.0f / area;
+
+  for (int y = y0; y <= y1; ++y) {
+    float py = y + 0.5f, px = x0 + 0.5f;
+    float w0 = edge(b->x, b->y, c->x, c->y, px, py);
+    float w1 = edge(c->x, c->y, a->x, a->y, px, py);
+    float w2 = edge(a->x, a->y, b->x, b->y, px, py);
+
+    int index = (y - tile.y0) * tile.width + (x0 - tile.x0);
+    for (int x = x0; x <= x1; ++x, ++index, w0 += dw0, w1 += dw1, w2 += dw2) {
+      if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+      if ((w0 == 0.0f && !tl0) || (w1 == 0.0f && !tl1) || (w2 == 0.0f && !tl2)) continue;
+
+      float l0 = w0 * invArea, l1 = w1 * invArea, l2 = w2 * invArea;
+      fn(index, l0 * a->u + l1 * b->u + l2 * c->u, l0 * a->v + l1 * b->v + l2 * c->v, x + 0.5f, py,
+         front);
+    }
+  }
+}
+
+template <typename Fn>
+void rasterPrimitives(const TileBuffer &tile, const NVGvertex *verts, int count, Topology topology,
+                      Fn &fn) {
+  switch (topology) {
+    case TOPOLOGY_FAN:
+      for (int i = 2; i < count; ++i) rasterTriangle(tile, &verts[0], &verts[i - 1], &verts[i], fn);
+      break;
+    case TOPOLOGY_STRIP:
+      // Odd triangles of a strip swap their first two vertices to keep a consistent winding.
+      for (int i = 2; i < count; ++i) {
+        if (i & 1) rasterTriangle(tile, &verts[i - 1], &verts[i - 2], &verts[i], fn);
+        else rasterTriangle(tile, &verts[i - 2], &verts[i - 1], &verts[i], fn);
+      }
+      break;
+    case TOPOLOGY_LIST:
+      for (int i = 2; i < count; i += 3) {
+        rasterTriangle(tile, &verts[i - 2], &verts[i - 1], &verts[i], fn);
+      }
+      break;
+  }
+}
+
+} // sw
+
+using namespace sw;
+
+class RendererSW {
+  bool mEdgeAntiAlias, mStencilStrokes;
+
+  std::unique_ptr<ThreadPool> mOwnPool;
+  ThreadPool *mPool;
+  std::vector<TileBuffer> mTileBuffers;
+
+  std::map<int, Texture> mTextures;
+  int mNextTextureId = 1;
+
+  float mDevicePixelRatio = 1.0f;
+
+  std::vector<Call> mCalls;
+  std::vector<PathRange> mPaths;
+  std::vector<NVGvertex> mVerts;
+  std::vector<Frag> mFrags;
+
+  Surface8uRef mTarget8u;
+  Surface32fRef mTarget32f;
+
+  const Texture *findTexture(int id) const {
+    auto it = mTextures.find(id);
+    return it == mTextures.end() ? nullptr : &it->second;
+  }
+
+  bool convertPaint(Frag &frag, const NVGpaint &paint, const NVGscissor &scissor, float width,
+                    float fringe, float strokeThr);
+
+  int appendVerts(const NVGvertex *verts, int count);
+  void updateBounds(Call &call, int offset, int count);
+  void appendPaths(Call &call, const NVGpath *paths, int npaths);
+  void resetFrame();
+
+  void shadeFragment(const Frag &frag, float u, float v, float x, float y,
+                     const NVGcompositeOperationState &op, NVGcolor &dst, bool clamp) const;
+  bool fragmentPasses(const Frag &frag, float u, float v) const;
+
+  void renderTile(TileBuffer &tile, bool clamp);
+  void loadTile(TileBuffer &tile) const;
+  void storeTile(const TileBuffer &tile) const;
+
+public:
+  RendererSW(bool antiAlias, bool stencilStrokes, size_t numThreads);
+
+  int targetWidth() const;
+  int targetHeight() const;
+
+  void setTarget(const Surface8uRef &surface);
+  void setTarget(const Surface32fRef &surface);
+  void clear(const ColorAf &color);
+
+  int createTexture(int type, int w, int h, int imageFlags, const unsigned char *data);
+  int deleteTexture(int image);
+  int updateTexture(int image, int x, int y, int w, int h, const unsigned char *data);
+  int getTextureSize(int image, int *w, int *h);
+  void viewport(float width, float height, float devicePixelRatio);
+  void cancel();
+  void flush();
+  void fill(NVGpaint *paint, NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+            float fringe, const float *bounds, const NVGpath *paths, int npaths);
+  void stroke(NVGpaint *paint, NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+              float fringe, float strokeWidth, const NVGpath *paths, int npaths);
+  void triangles(NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                 NVGscissor *scissor, const NVGvertex *verts, int nverts, float fringe);
+};
+
+RendererSW::RendererSW(bool antiAlias, bool stencilStrokes, size_t numThreads)
+: mEdgeAntiAlias{ antiAlias }, mStencilStrokes{ stencilStrokes } {
+  if (numThreads > 0) {
+    mOwnPool.reset(new ThreadPool(numThreads));
+    mPool = mOwnPool.get();
+  }
+  else {
+    mPool = &ThreadPool::shared();
+  }
+  mTileBuffers.resize(mPool->getNumThreads() + 1);
+  for (auto &tile : mTileBuffers) {
+    tile.color.resize(kTileSize * kTileSize);
+    tile.stencil.resize(kTileSize * kTileSize);
+  }
+}
+
+int RendererSW::targetWidth() const {
+  return mTarget8u ? mTarget8u->getWidth() : (mTarget32f ? mTarget32f->getWidth() : 0);
+}
+int RendererSW::targetHeight() const {
+  return mTarget8u ? mTarget8u->getHeight() : (mTarget32f ? mTarget32f->getHeight() : 0);
+}
+
+void RendererSW::setTarget(const Surface8uRef &surface) {
+  mTarget8u = surface;
+  mTarget32f.reset();
+}
+void RendererSW::setTarget(const Surface32fRef &surface) {
+  mTarget32f = surface;
+  mTarget8u.reset();
+}
+
+void RendererSW::clear(const ColorAf &color) {
+  NVGcolor c = premul(reinterpret_cast<const NVGcolor &>(color));
+  int w = targetWidth(), h = targetHeight();
+
+  mPool->parallelFor(size_t(h), [&](size_t y) {
+    if (mTarget8u) {
+      auto &s = *mTarget8u;
+      uint8_t *row = s.getData() + y * s.getRowBytes();
+      uint8_t inc = s.getPixelInc();
+      uint8_t r = uint8_t(clamp01(c.r) * 255.0f + 0.5f), g = uint8_t(clamp01(c.g) * 255.0f + 0.5f),
+              b = uint8_t(clamp01(c.b) * 255.0f + 0.5f), a = uint8_t(clamp01(c.a) * 255.0f + 0.5f);
+      for (int x = 0; x < w; ++x, row += inc) {
+        row[s.getRedOffset()] = r;
+        row[s.getGreenOffset()] = g;
+        row[s.getBlueOffset()] = b;
+        if (s.hasAlpha()) row[s.getAlphaOffset()] = a;
+      }
+    }
+    else {
+      auto &s = *mTarget32f;
+      float *row = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(s.getData()) +
+                                             y * s.getRowBytes());
+      uint8_t inc = s.getPixelInc();
+      for (int x = 0; x < w; ++x, row += inc) {
+        row[s.getRedOffset()] = c.r;
+        row[s.getGreenOffset()] = c.g;
+        row[s.getBlueOffset()] = c.b;
+        if (s.hasAlpha()) row[s.getAlphaOffset()] = c.a;
+      }
+    }
+  });
+}
+
+// Textures //
+
+int RendererSW::createTexture(int type, int w, int h, int imageFlags, const unsigned char *data) {
+  int id = mNextTextureId++;
+  auto &tex = mTextures[id];
+  tex.type = type;
+  tex.width = w;
+  tex.height = h;
+  tex.flags = imageFlags;
+  tex.data.assign(size_t(w) * h * (type == NVG_TEXTURE_RGBA ? 4 : 1), 0);
+  if (data) std::memcpy(tex.data.data(), data, tex.data.size());
+  return id;
+}
+
+int RendererSW::deleteTexture(int image) {
+  return mTextures.erase(image) > 0 ? 1 : 0;
+}
+
+int RendererSW::updateTexture(int image, int x, int y, int w, int h, const unsigned char *data) {
+  auto it = mTextures.find(image);
+  if (it == mTextures.end()) return 0;
+
+  // Like the GL backend, data points at the whole image and only the given rect is copied.
+  auto &tex = it->second;
+  size_t bpp = tex.type == NVG_TEXTURE_RGBA ? 4 : 1;
+  for (int row = y; row < y + h; ++row) {
+    size_t offset = (size_t(row) * tex.width + x) * bpp;
+    std::memcpy(&tex.data[offset], data + offset, w * bpp);
+  }
+  return 1;
+}
+
+int RendererSW::getTextureSize(int image, int *w, int *h) {
+  auto tex = findTexture(image);
+  if (!tex) return 0;
+  *w = tex->width;
+  *h = tex->height;
+  return 1;
+}
+
+// Recording //
+
+bool RendererSW::convertPaint(Frag &frag, const NVGpaint &paint, const NVGscissor &scissor,
+                              float width, float fringe, float strokeThr) {
+  std::memset(&frag, 0, sizeof(frag));
+
+  frag.innerCol = premul(paint.innerColor);
+  frag.outerCol = premul(paint.outerColor);
+
+  if (scissor.extent[0] < -0.5f || scissor.extent[1] < -0.5f) {
+    frag.scissorExt[0] = frag.scissorExt[1] = 1.0f;
+    frag.scissorScale[0] = frag.scissorScale[1] = 1.0f;
+  }
+  else {
+    nvgTransformInverse(frag.scissorMat, scissor.xform);
+    frag.scissorExt[0] = scissor.extent[0];
+    frag.scissorExt[1] = scissor.extent[1];
+    frag.scissorScale[0] =
+        std::sqrt(scissor.xform[0] * scissor.xform[0] + scissor.xform[2] * scissor.xform[2]) /
+        fringe;
+    frag.scissorScale[1] =
+        std::sqrt(scissor.xform[1] * scissor.xform[1] + scissor.xform[3] * scissor.xform[3]) /
+        fringe;
+  }
+
+  frag.extent[0] = paint.extent[0];
+  frag.extent[1] = paint.extent[1];
+  frag.strokeMult = (width * 0.5f + fringe * 0.5f) / fringe;
+  frag.strokeThr = strokeThr;
+
+  if (paint.image != 0) {
+    frag.tex = findTexture(paint.image);
+    if (!frag.tex) return false;
+
+    if (frag.tex->flags & NVG_IMAGE_FLIPY) {
+      float m1[6], m2[6];
+      nvgTransformTranslate(m1, 0.0f, frag.extent[1] * 0.5f);
+      nvgTransformMultiply(m1, paint.xform);
+      nvgTransformScale(m2, 1.0f, -1.0f);
+      nvgTransformMultiply(m2, m1);
+      nvgTransformTranslate(m1, 0.0f, -frag.extent[1] * 0.5f);
+      nvgTransformMultiply(m1, m2);
+      nvgTransformInverse(frag.paintMat, m1);
+    }
+    else {
+      nvgTransformInverse(frag.paintMat, paint.xform);
+    }
+
+    frag.type = SHADER_FILLIMG;
+    if (frag.tex->type == NVG_TEXTURE_RGBA) {
+      frag.texType = (frag.tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
+    }
+    else {
+      frag.texType = 2;
+    }
+  }
+  else {
+    frag.type = SHADER_FILLGRAD;
+    frag.radius = paint.radius;
+    frag.feather = paint.feather;
+    nvgTransformInverse(frag.paintMat, paint.xform);
+  }
+
+  return true;
+}
+
+int RendererSW::appendVerts(const NVGvertex *verts, int count) {
+  int offset = int(mVerts.size());
+  mVerts.resize(mVerts.size() + count);
+  for (int i = 0; i < count; ++i) {
+    auto &v = mVerts[offset + i];
+    v.x = verts[i].x * mDevicePixelRatio;
+    v.y = verts[i].y * mDevicePixelRatio;
+    v.u = verts[i].u;
+    v.v = verts[i].v;
+  }
+  return offset;
+}
+
+void RendererSW::updateBounds(Call &call, int offset, int count) {
+  for (int i = offset; i < offset + count; ++i) {
+    const auto &v = mVerts[i];
+    call.x0 = std::min(call.x0, int(std::floor(v.x)));
+    call.y0 = std::min(call.y0, int(std::floor(v.y)));
+    call.x1 = std::max(call.x1, int(std::ceil(v.x)));
+    call.y1 = std::max(call.y1, int(std::ceil(v.y)));
+  }
+}
+
+void RendererSW::appendPaths(Call &call, const NVGpath *paths, int npaths) {
+  call.pathOffset = int(mPaths.size());
+  call.pathCount = npaths;
+  call.x0 = call.y0 = std::numeric_limits<int>::max();
+  call.x1 = call.y1 = std::numeric_limits<int>::min();
+
+  for (int i = 0; i < npaths; ++i) {
+    const auto &path = paths[i];
+    PathRange range = {};
+    if (path.nfill > 0) {
+      range.fillOffset = appendVerts(path.fill, path.nfill);
+      range.fillCount = path.nfill;
+      updateBounds(call, range.fillOffset, range.fillCount);
+    }
+    if (path.nstroke > 0) {
+      range.strokeOffset = appendVerts(path.stroke, path.nstroke);
+      range.strokeCount = path.nstroke;
+      updateBounds(call, range.strokeOffset, range.strokeCount);
+    }
+    mPaths.push_back(range);
+  }
+}
+
+void RendererSW::viewport(float, float, float devicePixelRatio) {
+  mDevicePixelRatio = devicePixelRatio;
+}
+
+void RendererSW::fill(NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                      NVGscissor *scissor, float fringe, const float *bounds, const NVGpath *paths,
+                      int npaths) {
+  Call call;
+  call.type = CALL_FILL;
+  call.blend = compositeOperation;
+  call.triangleOffset = 0;
+  call.triangleCount = 4;
+
+  if (npaths == 1 && paths[0].convex) {
+    call.type = CALL_CONVEXFILL;
+    call.triangleCount = 0;
+  }
+
+  appendPaths(call, paths, npaths);
+
+  if (call.type == CALL_FILL) {
+    // Quad covering the fill's bounds, drawn as a strip to resolve the stencil.
+    NVGvertex quad[4] = { { bounds[2], bounds[3], 0.5f, 1.0f },
+                          { bounds[2], bounds[1], 0.5f, 1.0f },
+                          { bounds[0], bounds[3], 0.5f, 1.0f },
+                          { bounds[0], bounds[1], 0.5f, 1.0f } };
+    call.triangleOffset = appendVerts(quad, 4);
+    updateBounds(call, call.triangleOffset, 4);
+  }
+
+  Frag frag;
+  if (!convertPaint(frag, *paint, *scissor, fringe, fringe, -1.0f)) {
+    mPaths.resize(call.pathOffset);
+    return;
+  }
+
+  call.fragOffset = int(mFrags.size());
+  mFrags.push_back(frag);
+  mCalls.push_back(call);
+}
+
+void RendererSW::stroke(NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                        NVGscissor *scissor, float fringe, float strokeWidth, const NVGpath *paths,
+                        int npaths) {
+  Call call;
+  call.type = CALL_STROKE;
+  call.blend = compositeOperation;
+  call.triangleOffset = call.triangleCount = 0;
+  appendPaths(call, paths, npaths);
+
+  Frag frags[2];
+  if (!convertPaint(frags[0], *paint, *scissor, strokeWidth, fringe, -1.0f) ||
+      (mStencilStrokes &&
+       !convertPaint(frags[1], *paint, *scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f))) {
+    mPaths.resize(call.pathOffset);
+    return;
+  }
+
+  call.fragOffset = int(mFrags.size());
+  mFrags.push_back(frags[0]);
+  if (mStencilStrokes) mFrags.push_back(frags[1]);
+  mCalls.push_back(call);
+}
+
+void RendererSW::triangles(NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                           NVGscissor *scissor, const NVGvertex *verts, int nverts, float fringe) {
+  Call call;
+  call.type = CALL_TRIANGLES;
+  call.blend = compositeOperation;
+  call.pathOffset = call.pathCount = 0;
+  call.x0 = call.y0 = std::numeric_limits<int>::max();
+  call.x1 = call.y1 = std::numeric_limits<int>::min();
+  call.triangleOffset = appendVerts(verts, nverts);
+  call.triangleCount = nverts;
+  updateBounds(call, call.triangleOffset, nverts);
+
+  Frag frag;
+  if (!convertPaint(frag, *paint, *scissor, 1.0f, fringe, -1.0f)) return;
+  frag.type = SHADER_IMG;
+
+  call.fragOffset = int(mFrags.size());
+  mFrags.push_back(frag);
+  mCalls.push_back(call);
+}
+
+void RendererSW::resetFrame() {
+  mCalls.clear();
+  mPaths.clear();
+  mVerts.clear();
+  mFrags.clear();
+}
+
+void RendererSW::cancel() {
+  resetFrame();
+}
+
+// Rasterization //
+
+bool RendererSW::fragmentPasses(const Frag &frag, float u, float v) const {
+  if (frag.strokeThr < 0.0f || !mEdgeAntiAlias) return true;
+  float strokeAlpha =
+      std::min(1.0f, (1.0f - std::fabs(u * 2.0f - 1.0f)) * frag.strokeMult) * std::min(1.0f, v);
+  return strokeAlpha >= frag.strokeThr;
+}
+
+void RendererSW::shadeFragment(const Frag &frag, float u, float v, float x, float y,
+                               const NVGcompositeOperationState &op, NVGcolor &dst,
+                               bool clamp) const {
+  // Fragment position in view coordinates, which is what the GL shader's fpos holds.
+  float fx = x / mDevicePixelRatio, fy = y / mDevicePixelRatio;
+
+  float sx, sy;
+  xformPoint(frag.scissorMat, fx, fy, sx, sy);
+  sx = 0.5f - (std::fabs(sx) - frag.scissorExt[0]) * frag.scissorScale[0];
+  sy = 0.5f - (std::fabs(sy) - frag.scissorExt[1]) * frag.scissorScale[1];
+  float scissor = clamp01(sx) * clamp01(sy);
+  if (scissor <= 0.0f) return;
+
+  NVGcolor color;
+  if (frag.type == SHADER_IMG) {
+    color = convertTexel(sample(*frag.tex, u, v), frag.texType);
+    for (int i = 0; i < 4; ++i) color.rgba[i] *= scissor * frag.innerCol.rgba[i];
+  }
+  else {
+    float strokeAlpha = 1.0f;
+    if (mEdgeAntiAlias) {
+      strokeAlpha = std::min(1.0f, (1.0f - std::fabs(u * 2.0f - 1.0f)) * frag.strokeMult) *
+                    std::min(1.0f, v);
+    }
+
+    float px, py;
+    xformPoint(frag.paintMat, fx, fy, px, py);
+
+    if (frag.type == SHADER_FILLGRAD) {
+      float d = clamp01((sdroundrect(px, py, frag.extent[0], frag.extent[1], frag.radius) +
+                         frag.feather * 0.5f) / frag.feather);
+      for (int i = 0; i < 4; ++i) {
+        color.rgba[i] = frag.innerCol.rgba[i] + (frag.outerCol.rgba[i] - frag.innerCol.rgba[i]) * d;
+      }
+    }
+    else {
+      color = convertTexel(sample(*frag.tex, px / frag.extent[0], py / frag.extent[1]),
+                           frag.texType);
+      for (int i = 0; i < 4; ++i) color.rgba[i] *= frag.innerCol.rgba[i];
+    }
+
+    float coverage = strokeAlpha * scissor;
+    for (int i = 0; i < 4; ++i) color.rgba[i] *= coverage;
+  }
+
+  blend(op, color, dst, clamp);
+}
+
+void RendererSW::renderTile(TileBuffer &tile, bool clamp) {
+  int tx1 = tile.x0 + tile.width, ty1 = tile.y0 + tile.height;
+
+  for (const auto &call : mCalls) {
+    if (call.x1 < tile.x0 || call.x0 > tx1 || call.y1 < tile.y0 || call.y0 > ty1) continue;
+
+    const Frag &frag = mFrags[call.fragOffset];
+    const PathRange *paths = mPaths.data() + call.pathOffset;
+    const NVGvertex *verts = mVerts.data();
+
+    // Color pass with back-face culling and an optional stencil test.
+    // A negative stencil reference disables the stencil test.
+    auto shade = [&](const Frag *f, int stencilRef) {
+      return [&, f, stencilRef](int i, float u, float v, float x, float y, bool front) {
+        if (!front || (stencilRef >= 0 && tile.stencil[i] != stencilRef)) return;
+        shadeFragment(*f, u, v, x, y, call.blend, tile.color[i], clamp);
+      };
+    };
+
+    switch (call.type) {
+      case CALL_FILL: {
+        // Winding counts into the stencil, with culling disabled.
+        auto winding = [&](int i, float, float, float, float, bool front) {
+          tile.stencil[i] = uint8_t(tile.stencil[i] + (front ? 1 : -1));
+        };
+        for (int p = 0; p < call.pathCount; ++p) {
+          rasterPrimitives(tile, verts + paths[p].fillOffset, paths[p].fillCount, TOPOLOGY_FAN,
+                           winding);
+        }
+
+        // Anti-aliased fringes outside the filled area.
+        if (mEdgeAntiAlias) {
+          auto fringe = shade(&frag, 0);
+          for (int p = 0; p < call.pathCount; ++p) {
+            rasterPrimitives(tile, verts + paths[p].strokeOffset, paths[p].strokeCount,
+                             TOPOLOGY_STRIP, fringe);
+          }
+        }
+
+        // Cover the filled area and reset the stencil as we go.
+        auto cover = [&](int i, float u, float v, float x, float y, bool front) {
+          if (!front || tile.stencil[i] == 0) return;
+          shadeFragment(frag, u, v, x, y, call.blend, tile.color[i], clamp);
+          tile.stencil[i] = 0;
+        };
+        rasterPrimitives(tile, verts + call.triangleOffset, call.triangleCount, TOPOLOGY_STRIP,
+                         cover);
+        break;
+      }
+
+      case CALL_CONVEXFILL: {
+        auto draw = shade(&frag, -1);
+        for (int p = 0; p < call.pathCount; ++p) {
+          rasterPrimitives(tile, verts + paths[p].fillOffset, paths[p].fillCount, TOPOLOGY_FAN,
+                           draw);
+          rasterPrimitives(tile, verts + paths[p].strokeOffset, paths[p].strokeCount,
+                           TOPOLOGY_STRIP, draw);
+        }
+        break;
+      }
+
+      case CALL_STROKE: {
+        if (mStencilStrokes) {
+          // Solid interior without overlap, then anti-aliased edges, then clear the stencil.
+          const Frag &solidFrag = mFrags[call.fragOffset + 1];
+          auto solid = [&](int i, float u, float v, float x, float y, bool front) {
+            if (!front || tile.stencil[i] != 0 || !fragmentPasses(solidFrag, u, v)) return;
+            shadeFragment(solidFrag, u, v, x, y, call.blend, tile.color[i], clamp);
+            tile.stencil[i] = 1;
+          };
+          auto edges = shade(&frag, 0);
+          auto reset = [&](int i, float, float, float, float, bool front) {
+            if (front) tile.stencil[i] = 0;
+          };
+          for (int p = 0; p < call.pathCount; ++p) {
+            rasterPrimitives(tile, verts + paths[p].strokeOffset, paths[p].strokeCount,
+                             TOPOLOGY_STRIP, solid);
+          }
+          for (int p = 0; p < call.pathCount; ++p) {
+            rasterPrimitives(tile, verts + paths[p].strokeOffset, paths[p].strokeCount,
+                             TOPOLOGY_STRIP, edges);
+          }
+          for (int p = 0; p < call.pathCount; ++p) {
+            rasterPrimitives(tile, verts + paths[p].strokeOffset, paths[p].strokeCount,
+                             TOPOLOGY_STRIP, reset);
+          }
+        }
+        else {
+          auto draw = shade(&frag, -1);
+          for (int p = 0; p < call.pathCount; ++p) {
+            rasterPrimitives(tile, verts + paths[p].strokeOffset, paths[p].strokeCount,
+                             TOPOLOGY_STRIP, draw);
+          }
+        }
+        break;
+      }
+
+      case CALL_TRIANGLES: {
+        auto draw = shade(&frag, -1);
+        rasterPrimitives(tile, verts + call.triangleOffset, call.triangleCount, TOPOLOGY_LIST,
+                         draw);
+        break;
+      }
+    }
+  }
+}
+
+void RendererSW::loadTile(TileBuffer &tile) const {
+  for (int y = 0; y < tile.height; ++y) {
+    NVGcolor *dst = &tile.color[y * tile.width];
+    if (mTarget8u) {
+      auto &s = *mTarget8u;
+      const uint8_t *src =
+          s.getData() + (tile.y0 + y) * s.getRowBytes() + tile.x0 * s.getPixelInc();
+      for (int x = 0; x < tile.width; ++x, src += s.getPixelInc()) {
+        dst[x].r = src[s.getRedOffset()] / 255.0f;
+        dst[x].g = src[s.getGreenOffset()] / 255.0f;
+        dst[x].b = src[s.getBlueOffset()] / 255.0f;
+        dst[x].a = s.hasAlpha() ? src[s.getAlphaOffset()] / 255.0f : 1.0f;
+      }
+    }
+    else {
+      auto &s = *mTarget32f;
+      const float *src = reinterpret_cast<const float *>(
+          reinterpret_cast<const uint8_t *>(s.getData()) + (tile.y0 + y) * s.getRowBytes()) +
+          tile.x0 * s.getPixelInc();
+      for (int x = 0; x < tile.width; ++x, src += s.getPixelInc()) {
+        dst[x].r = src[s.getRedOffset()];
+        dst[x].g = src[s.getGreenOffset()];
+        dst[x].b = src[s.getBlueOffset()];
+        dst[x].a = s.hasAlpha() ? src[s.getAlphaOffset()] : 1.0f;
+      }
+    }
+  }
+  std::fill(tile.stencil.begin(), tile.stencil.begin() + tile.width * tile.height, 0);
+}
+
+void RendererSW::storeTile(const TileBuffer &tile) const {
+  for (int y = 0; y < tile.height; ++y) {
+    const NVGcolor *src = &tile.color[y * tile.width];
+    if (mTarget8u) {
+      auto &s = *mTarget8u;
+      uint8_t *dst = s.getData() + (tile.y0 + y) * s.getRowBytes() + tile.x0 * s.getPixelInc();
+      for (int x = 0; x < tile.width; ++x, dst += s.getPixelInc()) {
+        dst[s.getRedOffset()] = uint8_t(clamp01(src[x].r) * 255.0f + 0.5f);
+        dst[s.getGreenOffset()] = uint8_t(clamp01(src[x].g) * 255.0f + 0.5f);
+        dst[s.getBlueOffset()] = uint8_t(clamp01(src[x].b) * 255.0f + 0.5f);
+        if (s.hasAlpha()) dst[s.getAlphaOffset()] = uint8_t(clamp01(src[x].a) * 255.0f + 0.5f);
+      }
+    }
+    else {
+      auto &s = *mTarget32f;
+      float *dst = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(s.getData()) +
+                                             (tile.y0 + y) * s.getRowBytes()) +
+                   tile.x0 * s.getPixelInc();
+      for (int x = 0; x < tile.width; ++x, dst += s.getPixelInc()) {
+        dst[s.getRedOffset()] = src[x].r;
+        dst[s.getGreenOffset()] = src[x].g;
+        dst[s.getBlueOffset()] = src[x].b;
+        if (s.hasAlpha()) dst[s.getAlphaOffset()] = src[x].a;
+      }
+    }
+  }
+}
+
+void RendererSW::flush() {
+  int width = targetWidth(), height = targetHeight();
+
+  if (!mCalls.empty() && width > 0 && height > 0) {
+    int tilesX = (width + kTileSize - 1) / kTileSize;
+    int tilesY = (height + kTileSize - 1) / kTileSize;
+    int numTiles = tilesX * tilesY;
+    bool clamp = bool(mTarget8u);
+
+    std::atomic<int> nextTile(0);
+    mPool->parallelWorkers([&](size_t worker) {
+      TileBuffer &tile = mTileBuffers[worker];
+      for (int t; (t = nextTile++) < numTiles;) {
+        tile.x0 = (t % tilesX) * kTileSize;
+        tile.y0 = (t / tilesX) * kTileSize;
+        tile.width = std::min(kTileSize, width - tile.x0);
+        tile.height = std::min(kTileSize, height - tile.y0);
+
+        loadTile(tile);
+        renderTile(tile, clamp);
+        storeTile(tile);
+      }
+    });
+  }
+
+  resetFrame();
+}
+
+// NanoVG Callbacks //
+
+namespace {
+
+RendererSW *renderer(void *uptr) {
+  return static_cast<RendererSW *>(uptr);
+}
+
+int renderCreate(void *) {
+  return 1;
+}
+int renderCreateTexture(void *uptr, int type, int w, int h, int imageFlags,
+                        const unsigned char *data) {
+  return renderer(uptr)->createTexture(type, w, h, imageFlags, data);
+}
+int renderDeleteTexture(void *uptr, int image) {
+  return renderer(uptr)->deleteTexture(image);
+}
+int renderUpdateTexture(void *uptr, int image, int x, int y, int w, int h,
+                        const unsigned char *data) {
+  return renderer(uptr)->updateTexture(image, x, y, w, h, data);
+}
+int renderGetTextureSize(void *uptr, int image, int *w, int *h) {
+  return renderer(uptr)->getTextureSize(image, w, h);
+}
+void renderViewport(void *uptr, float width, float height, float devicePixelRatio) {
+  renderer(uptr)->viewport(width, height, devicePixelRatio);
+}
+void renderCancel(void *uptr) {
+  renderer(uptr)->cancel();
+}
+void renderFlush(void *uptr) {
+  renderer(uptr)->flush();
+}
+void renderFill(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                NVGscissor *scissor, float fringe, const float *bounds, const NVGpath *paths,
+                int npaths) {
+  renderer(uptr)->fill(paint, compositeOperation, scissor, fringe, bounds, paths, npaths);
+}
+void renderStroke(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                  NVGscissor *scissor, float fringe, float strokeWidth, const NVGpath *paths,
+                  int npaths) {
+  renderer(uptr)->stroke(paint, compositeOperation, scissor, fringe, strokeWidth, paths, npaths);
+}
+void renderTriangles(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                     NVGscissor *scissor, const NVGvertex *verts, int nverts, float fringe) {
+  renderer(uptr)->triangles(paint, compositeOperation, scissor, verts, nverts, fringe);
+}
+void renderDelete(void *uptr) {
+  delete renderer(uptr);
+}
+
+} // anonymous namespace
+
+ContextSW createContextSW(bool antiAlias, bool stencilStrokes, size_t numThreads) {
+  auto renderer = new RendererSW(antiAlias, stencilStrokes, numThreads);
+
+  NVGparams params;
+  std::memset(&params, 0, sizeof(params));
+  params.userPtr = renderer;
+  params.edgeAntiAlias = antiAlias ? 1 : 0;
+  params.renderCreate = renderCreate;
+  params.renderCreateTexture = renderCreateTexture;
+  params.renderDeleteTexture = renderDeleteTexture;
+  params.renderUpdateTexture = renderUpdateTexture;
+  params.renderGetTextureSize = renderGetTextureSize;
+  params.renderViewport = renderViewport;
+  params.renderCancel = renderCancel;
+  params.renderFlush = renderFlush;
+  params.renderFill = renderFill;
+  params.renderStroke = renderStroke;
+  params.renderTriangles = renderTriangles;
+  params.renderDelete = renderDelete;
+
+  // NOTE: If creation fails nanovg has already deleted the renderer through renderDelete.
+  NVGcontext *ctx = nvgCreateInternal(&params);
+  return { ctx, nvgDeleteInternal, ctx ? renderer : nullptr };
+}
+
+// ContextSW //
+
+void ContextSW::setTarget(const Surface8uRef &surface) {
+  mRenderer->setTarget(surface);
+}
+void ContextSW::setTarget(const Surface32fRef &surface) {
+  mRenderer->setTarget(surface);
+}
+
+void ContextSW::clear(const ColorAf &color) {
+  mRenderer->clear(color);
+}
+
+Image ContextSW::createImage(const Surface8u &surface, int imageFlags) {
+  int w = surface.getWidth(), h = surface.getHeight();
+  std::vector<uint8_t> rgba(size_t(w) * h * 4);
+
+  for (int y = 0; y < h; ++y) {
+    const uint8_t *src = surface.getData() + y * surface.getRowBytes();
+    uint8_t *dst = &rgba[size_t(y) * w * 4];
+    for (int x = 0; x < w; ++x, src += surface.getPixelInc(), dst += 4) {
+      dst[0] = src[surface.getRedOffset()];
+      dst[1] = src[surface.getGreenOffset()];
+      dst[2] = src[surface.getBlueOffset()];
+      dst[3] = surface.hasAlpha() ? src[surface.getAlphaOffset()] : 255;
+    }
+  }
+
+  return { get(), nvgCreateImageRGBA(get(), w, h, imageFlags, rgba.data()) };
+}
+
+}} // cinder::nvg